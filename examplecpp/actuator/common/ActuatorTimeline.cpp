@@ -0,0 +1,309 @@
+#include <errno.h>
+#include <time.h>
+#include <algorithm>
+
+#include "common/b2bassert.h"
+#include "common/B2BTime.h"
+#include "log/B2BLog.h"
+
+#include "ActuatorTimeline.h"
+
+ActuatorTimeline::ActuatorTimeline(const char *name) :
+	ThreadModule(name),
+	m_nextCue(0),
+	m_generation(0)
+{
+	pthread_mutex_init(&m_lock, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	ResetDispatchStats();
+}
+
+ActuatorTimeline::~ActuatorTimeline()
+{
+	Stop(NULL); // Stop our thread
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_lock);
+}
+
+void ActuatorTimeline::WakeWorker()
+{
+	pthread_mutex_lock(&m_lock);
+	pthread_cond_broadcast(&m_cond);
+	pthread_mutex_unlock(&m_lock);
+}
+
+ActuatorTimeline::TrackId ActuatorTimeline::AddTrack(const char *name,
+													const Dispatch &dispatch)
+{
+	b2bassert(name);
+	if (dispatch.empty()) {
+		B2BLog::Err(LogFilt::LM_ACTUATOR, "%s::AddTrack(%s): no dispatch",
+					Name(), name);
+		return TRACK_INVALID; // FAIL
+	}
+
+	Track track;
+	track.name = name;
+	track.dispatch = dispatch;
+
+	pthread_mutex_lock(&m_lock);
+	TrackId id = m_tracks.size();
+	m_tracks.push_back(track);
+	pthread_mutex_unlock(&m_lock);
+
+	return id;
+}
+
+/*static*/ bool ActuatorTimeline::DeadlineLess(const ScheduledCue &a,
+											   const ScheduledCue &b)
+{
+	if (a.deadlineNS != b.deadlineNS)
+		return a.deadlineNS < b.deadlineNS;
+	return a.order < b.order;
+}
+
+bool ActuatorTimeline::Play(const std::vector<Cue> &cues, uint64_t startNS,
+							const ExecuteListType::DoneDelegate &doneCallback)
+{
+	if (startNS == 0)
+		startNS = B2BTime::GetCurrTimeMonotonicNS() + START_LEAD_NS;
+
+	std::vector<ScheduledCue> scheduled(cues.size());
+	for (size_t i = 0; i < cues.size(); ++i) {
+		scheduled[i].deadlineNS = startNS + cues[i].offsetNS;
+		scheduled[i].order = i;
+		scheduled[i].cue = cues[i];
+	}
+	std::sort(scheduled.begin(), scheduled.end(), DeadlineLess);
+
+	pthread_mutex_lock(&m_lock);
+	for (size_t i = 0; i < cues.size(); ++i) {
+		if (cues[i].track >= m_tracks.size()) {
+			pthread_mutex_unlock(&m_lock);
+			B2BLog::Err(LogFilt::LM_ACTUATOR,
+						"%s::Play: cue %u has bad track %u",
+						Name(), (unsigned)i, (unsigned)cues[i].track);
+			return false; // FAIL
+		}
+	}
+
+	// Worker takes m_doneCallback when it dispatches the last cue, so
+	// it is only set while a timeline is playing
+	ExecuteListType::DoneDelegate replacedCallback = m_doneCallback;
+	m_cues.swap(scheduled);
+	m_nextCue = 0;
+	++m_generation;
+	m_doneCallback = doneCallback;
+	pthread_cond_broadcast(&m_cond);
+	pthread_mutex_unlock(&m_lock);
+
+	B2BLog::Debug(LogFilt::LM_ACTUATOR, "%s::Play: %u cues", Name(),
+				  (unsigned)cues.size());
+
+	if (!replacedCallback.empty())
+		replacedCallback(ExecuteListType::DONEREASON_NEWSTART);
+
+	if (cues.empty()) {
+		// Nothing to wait for.  Unless StopPlaying or Play took it.
+		pthread_mutex_lock(&m_lock);
+		ExecuteListType::DoneDelegate emptyCallback;
+		if (m_cues.empty()) {
+			emptyCallback = m_doneCallback;
+			m_doneCallback.clear();
+		}
+		pthread_mutex_unlock(&m_lock);
+		if (!emptyCallback.empty())
+			emptyCallback(ExecuteListType::DONEREASON_COMPLETE);
+	}
+
+	return true; // SUCCESS
+}
+
+void ActuatorTimeline::StopPlaying(ExecuteListType::DoneReason reason)
+{
+	pthread_mutex_lock(&m_lock);
+	ExecuteListType::DoneDelegate doneCallback = m_doneCallback;
+	m_doneCallback.clear();
+	m_cues.clear();
+	m_nextCue = 0;
+	++m_generation;
+	pthread_mutex_unlock(&m_lock);
+
+	if (!doneCallback.empty())
+		doneCallback(reason);
+}
+
+bool ActuatorTimeline::IsPlaying() const
+{
+	pthread_mutex_lock(&m_lock);
+	bool playing = (m_nextCue < m_cues.size());
+	pthread_mutex_unlock(&m_lock);
+
+	return playing;
+}
+
+bool ActuatorTimeline::SleepUntil(uint64_t deadlineNS)
+{
+	uint64_t wakeNS = deadlineNS;
+	bool reached = true;
+	uint64_t nowNS = B2BTime::GetCurrTimeMonotonicNS();
+	if (deadlineNS > nowNS + MAX_SLEEP_NS) {
+		// Look for a new timeline now and then
+		wakeNS = nowNS + MAX_SLEEP_NS;
+		reached = false;
+	}
+
+	struct timespec ts;
+	ts.tv_sec = wakeNS / 1000000000ULL;
+	ts.tv_nsec = wakeNS % 1000000000ULL;
+	int result;
+	while ((result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+									 NULL)) == EINTR)
+		; // signal, sleep rest of the way
+	if (result) {
+		B2BLog::Err(LogFilt::LM_ACTUATOR, "%s: clock_nanosleep FAIL: %d",
+					Name(), result);
+		return false; // FAIL: Worker tries again
+	}
+
+	return reached;
+}
+
+void *ActuatorTimeline::Worker(void *arg)
+{
+	pthread_mutex_lock(&m_lock);
+	while ((m_nextCue >= m_cues.size()) && !IsThreadCancelRequested())
+		pthread_cond_wait(&m_cond, &m_lock);
+	if (IsThreadCancelRequested()) {
+		pthread_mutex_unlock(&m_lock);
+		return NULL;
+	}
+	uint32_t generation = m_generation;
+	uint64_t deadlineNS = m_cues[m_nextCue].deadlineNS;
+	pthread_mutex_unlock(&m_lock);
+
+	if (!SleepUntil(deadlineNS))
+		return NULL; // not there yet, look again
+
+	// Take every cue of this sync point
+	pthread_mutex_lock(&m_lock);
+	if (generation != m_generation) {
+		// Replaced or stopped while we slept
+		pthread_mutex_unlock(&m_lock);
+		return NULL;
+	}
+	std::vector<ScheduledCue> due;
+	std::vector<Dispatch> dispatches;
+	for (; (m_nextCue < m_cues.size()) &&
+		   (m_cues[m_nextCue].deadlineNS == deadlineNS); ++m_nextCue)
+	{
+		due.push_back(m_cues[m_nextCue]);
+		dispatches.push_back(m_tracks[m_cues[m_nextCue].cue.track].dispatch);
+	}
+	ExecuteListType::DoneDelegate doneCallback;
+	if (m_nextCue >= m_cues.size()) {
+		// FINISHED: last sync point
+		doneCallback = m_doneCallback;
+		m_doneCallback.clear();
+	}
+	pthread_mutex_unlock(&m_lock);
+
+	std::vector<uint64_t> dispatchNS(due.size());
+	std::vector<bool> dispatched(due.size());
+	for (size_t i = 0; i < due.size(); ++i) {
+		dispatchNS[i] = B2BTime::GetCurrTimeMonotonicNS();
+		dispatched[i] = dispatches[i](due[i].cue);
+	}
+
+	pthread_mutex_lock(&m_lock);
+	RecordSyncPoint(due, dispatchNS, dispatched);
+	pthread_mutex_unlock(&m_lock);
+
+	for (size_t i = 0; i < due.size(); ++i) {
+		if (!dispatched[i]) {
+			B2BLog::Warn(LogFilt::LM_ACTUATOR, "%s: track %u refused \"%s\"",
+						 Name(), (unsigned)due[i].cue.track,
+						 due[i].cue.item.c_str());
+		}
+	}
+
+	if (!doneCallback.empty())
+		doneCallback(ExecuteListType::DONEREASON_COMPLETE);
+
+	return NULL;
+}
+
+void ActuatorTimeline::RecordSyncPoint(const std::vector<ScheduledCue> &due,
+									   const std::vector<uint64_t> &dispatchNS,
+									   const std::vector<bool> &dispatched)
+{
+	uint64_t firstNS = 0;
+	uint64_t lastNS = 0;
+	bool severalTracks = false;
+	for (size_t i = 0; i < due.size(); ++i) {
+		++m_dispatchStats.cues;
+		if (!dispatched[i])
+			++m_dispatchStats.failed;
+
+		uint64_t lateNS = (dispatchNS[i] > due[i].deadlineNS) ?
+									(dispatchNS[i] - due[i].deadlineNS) : 0;
+		m_dispatchStats.sumLateNS += lateNS;
+		if (lateNS > m_dispatchStats.maxLateNS)
+			m_dispatchStats.maxLateNS = lateNS;
+
+		if (i == 0) {
+			firstNS = lastNS = dispatchNS[i];
+		} else {
+			firstNS = std::min(firstNS, dispatchNS[i]);
+			lastNS = std::max(lastNS, dispatchNS[i]);
+			if (due[i].cue.track != due[0].cue.track)
+				severalTracks = true;
+		}
+	}
+
+	if (severalTracks) {
+		uint64_t skewNS = lastNS - firstNS;
+		++m_dispatchStats.syncPoints;
+		m_dispatchStats.sumDispatchSkewNS += skewNS;
+		if (skewNS > m_dispatchStats.maxDispatchSkewNS)
+			m_dispatchStats.maxDispatchSkewNS = skewNS;
+	}
+}
+
+void ActuatorTimeline::GetDispatchStats(DispatchStats *pStats) const
+{
+	b2bassert(pStats);
+
+	pthread_mutex_lock(&m_lock);
+	*pStats = m_dispatchStats;
+	pthread_mutex_unlock(&m_lock);
+}
+
+void ActuatorTimeline::ResetDispatchStats()
+{
+	pthread_mutex_lock(&m_lock);
+	m_dispatchStats.cues = 0;
+	m_dispatchStats.failed = 0;
+	m_dispatchStats.syncPoints = 0;
+	m_dispatchStats.maxDispatchSkewNS = 0;
+	m_dispatchStats.sumDispatchSkewNS = 0;
+	m_dispatchStats.maxLateNS = 0;
+	m_dispatchStats.sumLateNS = 0;
+	pthread_mutex_unlock(&m_lock);
+}
+
+void ActuatorTimeline::LogDispatchStats() const
+{
+	DispatchStats stats;
+	GetDispatchStats(&stats);
+
+	B2BLog::Info(LogFilt::LM_ACTUATOR,
+		"%s: %u cues (%u failed), late avg %.1fus max %.1fus, "
+		"%u sync points, dispatch skew avg %.1fus max %.1fus",
+		Name(), stats.cues, stats.failed,
+		stats.cues ? (stats.sumLateNS / 1000.0) / stats.cues : 0.0,
+		stats.maxLateNS / 1000.0,
+		stats.syncPoints,
+		stats.syncPoints ? (stats.sumDispatchSkewNS / 1000.0) / stats.syncPoints : 0.0,
+		stats.maxDispatchSkewNS / 1000.0);
+}
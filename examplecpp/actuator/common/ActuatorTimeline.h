@@ -0,0 +1,172 @@
+#pragma once
+//
+// ActuatorTimeline: starts entries on several actuators at absolute times
+//		on one clock, so they stay in step.  For example, show frame 3
+//		exactly when clip 2 starts.
+//		WARNING: Client must call Init() and Start() to enable this class.
+//
+//		Each actuator is a track, added with AddTrack and a Dispatch to
+//		call.  Play takes a list of cues, each one an item for a track at
+//		an offset from the start of the timeline.  Our thread sleeps with
+//		clock_nanosleep(TIMER_ABSTIME) on CLOCK_MONOTONIC until each cue's
+//		deadline and calls its track's Dispatch.  Deadlines are absolute,
+//		so time spent dispatching never adds up the way usleep pacing
+//		does.
+//
+//		Dispatch is called in our thread and must not block: hand the item
+//		to the actuator (for example DisplayOutput::DisplayImageFile on an
+//		idle DisplayOutput) and return.  How long the actuator then takes
+//		to start it is in the actuator's Stats() (START_LATENCY).
+//
+//		Cues with the same offset are a sync point.  We record how far
+//		apart we called their Dispatch (dispatch skew) and how late each
+//		Dispatch call was, see GetDispatchStats.  These are our times only:
+//		when the actuators actually start their items (start skew) is not
+//		measured here.
+//
+//		For example:
+//			TrackId sound = timeline.AddTrack("sound",
+//							ActuatorTimeline::Dispatch(this, &Foo::PlayCue));
+//			TrackId image = timeline.AddTrack("image",
+//							ActuatorTimeline::Dispatch(this, &Foo::ShowCue));
+//			cues.push_back(ActuatorTimeline::Cue(sound, 0, "clip1.wav"));
+//			cues.push_back(ActuatorTimeline::Cue(sound, 800*MS, "clip2.wav"));
+//			cues.push_back(ActuatorTimeline::Cue(image, 800*MS, "frame3.png"));
+//			timeline.Play(cues);
+//
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "common/Delegate.h"
+#include "apps/common/ExecuteListType.h"
+#include "apps/common/ThreadModule.h"
+
+class ActuatorTimeline : public ThreadModule {
+  public:
+	typedef uint32_t TrackId;
+	static const TrackId TRACK_INVALID = 0xffffffff;
+
+	// One item for one track.
+	// track: from AddTrack
+	// offsetNS: when to start, in nanoseconds from start of timeline
+	// item: passed to track's Dispatch (file name say)
+	struct Cue {
+		Cue() : track(TRACK_INVALID), offsetNS(0) {}
+		Cue(TrackId newTrack, uint64_t newOffsetNS,
+			const std::string &newItem) :
+			track(newTrack), offsetNS(newOffsetNS), item(newItem) {}
+
+		TrackId track;
+		uint64_t offsetNS;
+		std::string item;
+	};
+
+	// Called in our thread at cue's deadline.  Must not block.
+	// RETURNS: true on success, false if actuator refused the item
+	typedef Delegate<bool (const Cue &cue)> Dispatch;
+
+	// name: passed to ThreadModule
+	ActuatorTimeline(const char *name);
+	virtual ~ActuatorTimeline();
+
+	// START: B2BModule virtuals.  See ThreadModule for documentation
+	bool Init() { return true; } // nothing to do
+	// END: B2BModule virtuals
+
+	// Add a track.  Call before Play uses it.
+	// name: for logging, not copied (use a static string)
+	// dispatch: called for the track's cues, copied
+	// RETURNS: TrackId for Cue::track, TRACK_INVALID on failure
+	TrackId AddTrack(const char *name, const Dispatch &dispatch);
+
+	// Play cues.  Replaces a timeline that is playing: its cues not
+	// dispatched yet never are, and its doneCallback is called with
+	// NEWSTART.
+	// cues: in any order.  Cues with the same offset are dispatched in
+	//		the order given.
+	// startNS: B2BTime::GetCurrTimeMonotonicNS() time of offset 0.  0 for
+	//		now plus START_LEAD_NS, so cues at offset 0 start on time too.
+	// doneCallback: called with COMPLETE after last cue is dispatched,
+	//		or STOP/NEWSTART (see StopPlaying).  Copied.
+	// RETURNS: true on success, false if a cue's track is not valid
+	bool Play(const std::vector<Cue> &cues, uint64_t startNS=0,
+			  const ExecuteListType::DoneDelegate &doneCallback=
+										ExecuteListType::DoneDelegate());
+
+	// Stop timeline playing, if any.  Cues not dispatched yet never are.
+	// Its doneCallback is called with reason from this call.
+	void StopPlaying(ExecuteListType::DoneReason reason=
+										ExecuteListType::DONEREASON_STOP);
+
+	// RETURNS: true if a timeline has cues left to dispatch
+	bool IsPlaying() const;
+
+	// Play's default lead, from now to offset 0
+	static const uint64_t START_LEAD_NS = 20*1000*1000;
+
+	// How well we kept time calling Dispatch, since ctor or
+	// ResetDispatchStats.  Not when actuators started their items.
+	// cues: cues dispatched
+	// failed: of those, ones whose Dispatch returned false
+	// syncPoints: sync points with cues for 2 or more tracks
+	// dispatchSkew: at each of those sync points, time we called last
+	//		Dispatch minus time we called first
+	// late: each cue's Dispatch call minus its deadline
+	struct DispatchStats {
+		uint32_t cues;
+		uint32_t failed;
+		uint32_t syncPoints;
+		uint64_t maxDispatchSkewNS;
+		uint64_t sumDispatchSkewNS;
+		uint64_t maxLateNS;
+		uint64_t sumLateNS;
+	};
+	void GetDispatchStats(DispatchStats *pStats) const;
+	void ResetDispatchStats();
+	// B2BLog::Info DispatchStats
+	void LogDispatchStats() const;
+
+  protected:
+	// START: required protected virtual from ThreadModule
+	// Waits for next deadline and dispatches cues due
+	void *Worker(void *arg);
+	// END: required protected virtual from ThreadModule
+
+	// ThreadModule virtual: wakes Worker if it is waiting, so it can quit
+	void WakeWorker();
+
+  private:
+	struct Track {
+		const char *name;
+		Dispatch dispatch;
+	};
+
+	struct ScheduledCue {
+		uint64_t deadlineNS;
+		uint32_t order;		// index in Play's cues, to keep their order
+		Cue cue;
+	};
+	static bool DeadlineLess(const ScheduledCue &a, const ScheduledCue &b);
+
+	// Sleep until deadlineNS, or MAX_SLEEP_NS, whichever is first.
+	// RETURNS: true if deadlineNS was reached
+	bool SleepUntil(uint64_t deadlineNS);
+	// A timeline Play replaces is noticed by our thread within this
+	static const uint64_t MAX_SLEEP_NS = 10*1000*1000;
+
+	// Record dispatch times of one sync point
+	void RecordSyncPoint(const std::vector<ScheduledCue> &due,
+						 const std::vector<uint64_t> &dispatchNS,
+						 const std::vector<bool> &dispatched);
+
+	std::vector<Track> m_tracks;
+	std::vector<ScheduledCue> m_cues;	// sorted by deadline
+	size_t m_nextCue;					// first one not dispatched
+	uint32_t m_generation;				// bumped by Play and StopPlaying
+	ExecuteListType::DoneDelegate m_doneCallback;	// of timeline playing
+	DispatchStats m_dispatchStats;
+	mutable pthread_mutex_t m_lock;		// for all of the above
+	pthread_cond_t m_cond;				// signalled by Play and Stop
+};
@@ -118,11 +118,13 @@ bool AudioOutput::BuildExecListInternalPlayFile(const ExecList &execList,
 
 bool AudioOutput::PlayFiles(const std::vector<std::string> &fileList,
 							b2b::Volume newVolume, bool loop,
-							const ExecuteListType::DoneCallback *pDoneCallback)
+							const ExecuteListType::DoneCallback *pDoneCallback,
+							ExecuteListType::Priority priority)
 {
 	m_newVolume = newVolume; // save for BuildExecListInternal()
 	bool returnVal = ExecuteList("PlayFiles", fileList, 
-						m_BuildExecListInternalPlayFile, loop, pDoneCallback);
+						m_BuildExecListInternalPlayFile, loop, pDoneCallback,
+						priority);
 	if (!returnVal) {
 		B2BLog::Err(LogFilt::LM_ACTUATOR, "PlayFiles(%s,%d) failed.", 
 				fileList[0].c_str(), (int)fileList.size());
@@ -130,6 +132,21 @@ bool AudioOutput::PlayFiles(const std::vector<std::string> &fileList,
 	return returnVal;
 }
 
+bool AudioOutput::QueuePlayFiles(const std::vector<std::string> &fileList,
+							const ExecuteListType::DoneCallback *pDoneCallback,
+							ExecuteListType::Priority priority)
+{
+	m_newVolume = m_volume; // BuildExecListInternal() keeps volume
+	bool returnVal = QueueList("QueuePlayFiles", fileList,
+						m_BuildExecListInternalPlayFile, pDoneCallback,
+						priority);
+	if (!returnVal) {
+		B2BLog::Err(LogFilt::LM_ACTUATOR, "QueuePlayFiles(%s,%d) failed.", 
+				fileList[0].c_str(), (int)fileList.size());
+	}
+	return returnVal;
+}
+
 bool AudioOutput::BuildExecListInternalTextStringToSpeech(
 								const ExecList &execList,
 								ExecListInternal *pNewInternalList)
@@ -152,11 +169,13 @@ bool AudioOutput::BuildExecListInternalTextStringToSpeech(
 
 bool AudioOutput::TextStringsToSpeech(const std::vector<std::string> &textList,
 							b2b::Volume newVolume, bool loop,
-							const ExecuteListType::DoneCallback *pDoneCallback)
+							const ExecuteListType::DoneCallback *pDoneCallback,
+							ExecuteListType::Priority priority)
 {
 	m_newVolume = newVolume; // save for BuildExecListInternal()
 	bool returnVal = ExecuteList("TextStringsToSpeech", textList, 
-				m_BuildExecListInternalTextStringToSpeech, loop, pDoneCallback);
+				m_BuildExecListInternalTextStringToSpeech, loop, pDoneCallback,
+				priority);
 	if (!returnVal) {
 		B2BLog::Err(LogFilt::LM_ACTUATOR, "TextStringsToSpeech(%s,%d) failed.", 
 				textList[0].c_str(), (int)textList.size());
@@ -164,6 +183,22 @@ bool AudioOutput::TextStringsToSpeech(const std::vector<std::string> &textList,
 	return returnVal;
 }
 
+bool AudioOutput::QueueTextStringsToSpeech(
+							const std::vector<std::string> &textList,
+							const ExecuteListType::DoneCallback *pDoneCallback,
+							ExecuteListType::Priority priority)
+{
+	m_newVolume = m_volume; // BuildExecListInternal() keeps volume
+	bool returnVal = QueueList("QueueTextStringsToSpeech", textList, 
+				m_BuildExecListInternalTextStringToSpeech, pDoneCallback,
+				priority);
+	if (!returnVal) {
+		B2BLog::Err(LogFilt::LM_ACTUATOR, "QueueTextStringsToSpeech(%s,%d) failed.", 
+				textList[0].c_str(), (int)textList.size());
+	}
+	return returnVal;
+}
+
 bool AudioOutput::SetVolume(b2b::Volume volume)
 {
 	if (m_volume == volume) 
@@ -219,7 +254,7 @@ bool AudioOutput::WorkerExecute(const AudioOutputType::PlayListEntry &entry)
 		// Playing audio takes time and that is why we are in a
 		// separate thread
 		AudioOutputHW::PlayAudio(m_device,
-		  					audioDataP->dataP,
+		  					audioDataP->dataP.get(),
 		  					audioDataP->filenameFullPath.c_str());
 	} else {
 		// entry is text string
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <vector>
 
+#include "boost/shared_array.hpp"
 #include "boost/variant.hpp"
 
 #include "common/b2btypes.h"
@@ -19,21 +20,16 @@ class Neuron;
 namespace AudioOutputType {
 	// Data entry when playing an audio file
 	// dataP: the raw data of a file to play.  Always NULL if
-	//		m_deviceCanReadFile is true.
+	//		m_deviceCanReadFile is true.  Shared, so copies of an AudioData
+	//		(play lists are copied) don't copy or double free the data.
 	// filenameFullPath: the name of a file to play.
 	class AudioData {
 	  public:
+		// newDataP: allocated with new [], we take ownership
 		AudioData(uint8_t *newDataP, std::string &newFilenameFullPath) :
 		   dataP(newDataP), filenameFullPath(newFilenameFullPath) {}
-		virtual ~AudioData()
-		{
-			if (dataP) {
-				delete [] dataP;
-				dataP = NULL;
-			}
-		}
 			
-		uint8_t *dataP;
+		boost::shared_array<uint8_t> dataP;
 		std::string filenameFullPath;
 	};
 
@@ -90,10 +86,12 @@ class AudioOutput : public ExecuteListInThread<std::string, AudioOutputType::Pla
 	//		See DoneReason for all the reasons we can call this callback.
 	//		Called once per PlayFile()/PlayFiles() call.
 	//		Set to NULL if no reporting is desired.
+	// priority: a higher priority list interrupts the one playing, which
+	//		resumes afterwards.  See ExecuteListInThread::ExecuteList.
 	//
 	// Returns: true on success, false otherwise
 	//		Will fail and return false if already in process of playing
-	//		a file or file list
+	//		a file or file list of the same or higher priority
 	//
 	// WARNING: mute is not changed when PlayFile/Playfiles is called
 	//
@@ -114,11 +112,27 @@ class AudioOutput : public ExecuteListInThread<std::string, AudioOutputType::Pla
 
 	bool PlayFiles(const std::vector<std::string> &fileList, 
 				b2b::Volume newVolume, bool loop=false,
-				const ExecuteListType::DoneCallback *pDoneCallback=NULL);
+				const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+				ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL);
 	bool PlayFiles(const std::vector<std::string> &fileList, bool loop=false,
 					const ExecuteListType::DoneCallback *pDoneCallback=NULL)
 	  { return PlayFiles(fileList, VOLUME_DEFAULT, loop, pDoneCallback); }
 
+	// QueuePlayFiles: Play audio files from a list once the list playing,
+	//		and lists queued before this one, are done.  Starts right away
+	//		if nothing is playing.  Files are read now, so there is no gap
+	//		between lists.  Volume is not changed.
+	// Other arguments are the same as PlayFiles.
+	//
+	// Returns: true on success, false otherwise
+	//		Will fail and return false if ExecuteListInThread::
+	//		MAX_QUEUED_LISTS lists are already queued.
+	bool QueuePlayFiles(const std::vector<std::string> &fileList,
+				const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+				ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL);
+
 	// TextToSpeechString: Speak text asynchronously.
 	// TextToSpeechStrings: Speak text from a list.  Played in order in list.
 	//
@@ -134,10 +148,11 @@ class AudioOutput : public ExecuteListInThread<std::string, AudioOutputType::Pla
 	//		See DoneReason for all the reasons we can call this callback.
 	//		Called once per TextToSpeechString()/TextToSpeechStrings() call.
 	//		Set to NULL if no reporting is desired.
+	// priority: same as PlayFiles
 	//
 	// Returns: true on success, false otherwise
 	//		Will fail and return false if already in process of speaking
-	//		a text string or string list
+	//		a text string or string list of the same or higher priority
 	//
 	// WARNING: mute is not changed when 
 	//			TextToSpeechString/TextToSpeechStrings is called
@@ -161,7 +176,9 @@ class AudioOutput : public ExecuteListInThread<std::string, AudioOutputType::Pla
 
 	bool TextStringsToSpeech(const std::vector<std::string> &textList, 
 				b2b::Volume newVolume, bool loop = false,
-				const ExecuteListType::DoneCallback *pDoneCallback=NULL);
+				const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+				ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL);
 	bool TextStringsToSpeech(const std::vector<std::string> &textList,
 					bool loop = false,
 					const ExecuteListType::DoneCallback *pDoneCallback=NULL)
@@ -170,6 +187,14 @@ class AudioOutput : public ExecuteListInThread<std::string, AudioOutputType::Pla
 									loop, pDoneCallback);
 	}
 
+	// QueueTextStringsToSpeech: Speak text from a list once the list
+	//		playing, and lists queued before this one, are done.  Same as
+	//		QueuePlayFiles otherwise.
+	bool QueueTextStringsToSpeech(const std::vector<std::string> &textList,
+				const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+				ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL);
+
 	// volume: MIN_VOLUME to MAX_VOLUME (0 to 10)
 	//			0 may still output some power to audio output.  Use mute to
 	//			completely shut off all output.
@@ -91,6 +91,19 @@ bool DisplayOutput::DisplayImageFiles(const std::vector<std::string> &fileList,
 	return returnVal;
 }
 
+bool DisplayOutput::QueueImageFiles(const std::vector<std::string> &fileList,
+				const ExecuteListType::DoneCallback *pDoneCallback,
+				ExecuteListType::Priority priority)
+{
+	bool returnVal = QueueList("QueueImageFiles", fileList,
+							m_BuildExecListInternal, pDoneCallback, priority);
+	if (!returnVal) {
+		B2BLog::Err(LogFilt::LM_ACTUATOR, "QueueImageFiles(%s,%d) failed.",
+				fileList[0].c_str(), (int)fileList.size());
+	}
+	return returnVal;
+}
+
 bool DisplayOutput::DisplayImageFiles(const char *dirName,
 				b2b::TimeMS imageDisplayTimeMS, bool loop,
 				const ExecuteListType::DoneCallback *pDoneCallback)
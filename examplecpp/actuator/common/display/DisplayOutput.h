@@ -101,6 +101,22 @@ class DisplayOutput : public ExecuteListInThread<std::string, std::string>, publ
 						   		 pDoneCallback);
 	}
 
+	// QueueImageFiles(fileList, ...): Display image files from a list once
+	//		the list displaying, and lists queued before this one, are
+	//		done.  Starts right away if nothing is displaying.  Files are
+	//		checked now, so there is no gap between lists.  Image display
+	//		time is not changed.
+	// pDoneCallback: same as DisplayImageFiles
+	// priority: see ExecuteListInThread::ExecuteList
+	//
+	// Returns: true on success, false otherwise
+	//		Will fail and return false if ExecuteListInThread::
+	//		MAX_QUEUED_LISTS lists are already queued.
+	bool QueueImageFiles(const std::vector<std::string> &fileList,
+				const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+				ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL);
+
 	// RETURNS: true if currently "in the act of displaying" an image or image
 	// list, false otherwise.
 	// "in the act of displaying" means that we are writing out the image (or
@@ -3,6 +3,8 @@
 // Description: base class for all of our modules
 //
 #include <string.h>
+#include <string>
+#include <vector>
 
 class B2BModule {
   public:
@@ -40,7 +42,18 @@ class B2BModule {
 	}
     bool operator!=(const B2BModule &m) const { return !(*this == m); }
 
+	// Declare that this module needs module moduleName.  B2BModuleManager
+	// will Init and Start moduleName before this module and Stop it after
+	// this module.  Modules with no dependency path between them may be
+	// run at the same time (see B2BModuleManager::SetMaxParallel).
+	// moduleName: name of a module added to the same B2BModuleManager
+	//		before its InitAll is called.
+	void DependsOn(const char *moduleName)
+		{ m_dependencies.push_back(moduleName); }
+	const std::vector<std::string> &Dependencies() const
+		{ return m_dependencies; }
 
   private:
 	const char *m_name; // from ctor
+	std::vector<std::string> m_dependencies; // from DependsOn
 };
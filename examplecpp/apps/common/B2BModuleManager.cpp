@@ -1,12 +1,19 @@
 #include <algorithm>
-
-#include "boost/bind.hpp"
+#include <map>
 
 #include "log/B2BLog.h"
 #include "common/b2bassert.h"
 
+#include "LifecycleTracer.h"
 #include "B2BModuleManager.h"
 
+// RETURNS: time in milliseconds, with fraction so short times still show
+static double TimeValueToMS(const B2BTime::TimeValue &time)
+{
+	struct timespec ts = time.ConvertToTimespec();
+	return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+}
+
 B2BModuleManager::~B2BModuleManager()
 {
 	B2BModules::reverse_iterator iter;
@@ -16,14 +23,20 @@ B2BModuleManager::~B2BModuleManager()
 	}
 }
 
-B2BModule *B2BModuleManager::AddModuleImpl(B2BModule *module)
+B2BModule *B2BModuleManager::AddModuleImpl(B2BModule *module,
+										   const void *typeTag,
+										   void *typedModule)
 {
 	b2bassert(module);
 	if (!module)
 		return NULL; // FAIL
 
-	// FIXME: DEBUG only
-	if (GetModuleImpl(module->Name(), false)) {
+	RegistryEntry entry;
+	entry.module = module;
+	entry.typeTag = typeTag;
+	entry.typedModule = typedModule;
+	if (!m_registry.insert(Registry::value_type(module->Name(), entry)).second)
+	{
 		// add failed because module already exists.  It was not added
 		B2BLog::Err(LogFilt::LM_APP,
 			"AddModule %s already loaded in B2BModuleManager.  New %s ignored.",
@@ -37,20 +50,14 @@ B2BModule *B2BModuleManager::AddModuleImpl(B2BModule *module)
 	return module; // SUCCESS
 }
 
-/*static*/ bool B2BModuleManager::ModuleCompare(const B2BModule *module, 
-											 	const char *moduleName)
+const B2BModuleManager::RegistryEntry *B2BModuleManager::GetModuleImpl(
+								const char *moduleName, bool expected) const
 {
-	return module->NameEqual(moduleName);
-}
-
-B2BModule *B2BModuleManager::GetModuleImpl(const char *moduleName,
-											bool expected) const
-{
-	B2BModules::const_iterator iter = 
-			std::find_if(m_modules.begin(), m_modules.end(), 
-				  boost::bind(&B2BModuleManager::ModuleCompare,_1,moduleName));
-	if (iter != m_modules.end()) {
-		return *iter; // SUCCESS: Found the module, return it
+	// Look up by const char * directly, no std::string made
+	Registry::const_iterator iter =
+			m_registry.find(moduleName, NameHash(), NameEqual());
+	if (iter != m_registry.end()) {
+		return &iter->second; // SUCCESS: Found the module, return it
 	} else {
 		if (expected) {
 			// We expected to find the module
@@ -62,53 +69,272 @@ B2BModule *B2BModuleManager::GetModuleImpl(const char *moduleName,
 
 bool B2BModuleManager::DeleteModule(const char *moduleName)
 {
-	B2BModule *module = GetModuleImpl(moduleName, true);
-	if (module) {
-	  delete module; // call destructor
-	  // Remove module from B2BModuleManager
+	const RegistryEntry *entry = GetModuleImpl(moduleName, true);
+	if (entry) {
+	  B2BModule *module = entry->module;
+	  // Remove module from B2BModuleManager.  Erase by our own copy of
+	  // the name: moduleName may be module's, which delete frees.
+	  m_registry.erase(std::string(module->Name()));
 	  m_modules.remove(module);
+	  m_timings.erase(module);
+	  delete module; // call destructor
 	  return true;  // SUCCESS: Found the module and erase succeeded
 	} else {
-		B2BLog::Err(LogFilt::LM_APP, "GetModule %s not found.", moduleName);
-		return false; // FAIL: moduleName does not exist in B2BModuleManager
+		return false; // FAIL: already logged
 	}
 }
 
 bool B2BModuleManager::InitAll()
 {
-	bool returnVal = true; // assume success
-	B2BModules::iterator iter;
-	for (iter = m_modules.begin(); iter != m_modules.end(); ++iter) {
-		B2BModule *module = *iter;
-		if (module->Init())
-			returnVal = false; // FAIL: one failure means our method fails
+	return RunPhase(PHASE_INIT);
+}
+
+bool B2BModuleManager::StartAll()
+{
+	return RunPhase(PHASE_START);
+}
+
+bool B2BModuleManager::StopAll()
+{
+	return RunPhase(PHASE_STOP);
+}
+
+bool B2BModuleManager::GetModuleTiming(const char *moduleName,
+									   ModuleTiming *pTiming) const
+{
+	b2bassert(pTiming);
+
+	const RegistryEntry *entry = GetModuleImpl(moduleName, true);
+	if (!entry)
+		return false; // FAIL: already logged
+
+	ModuleTimings::const_iterator iter = m_timings.find(entry->module);
+	if (iter != m_timings.end())
+		*pTiming = iter->second;
+	else
+		*pTiming = ModuleTiming(); // never called
+	return true; // SUCCESS
+}
+
+/*static*/ const char *B2BModuleManager::PhaseName(Phase phase)
+{
+	switch (phase) {
+	  case PHASE_INIT:	return LifecycleTracer::CATEGORY_INIT;
+	  case PHASE_START:	return LifecycleTracer::CATEGORY_START;
+	  case PHASE_STOP:	return LifecycleTracer::CATEGORY_STOP;
+	  default:			return "(unknown phase)";
 	}
+}
 
-	return returnVal;
+/*static*/ bool B2BModuleManager::CallModule(Phase phase, B2BModule *module)
+{
+	switch (phase) {
+	  case PHASE_INIT:	return module->Init();
+	  case PHASE_START:	return module->Start(NULL);
+	  case PHASE_STOP:	return module->Stop(NULL);
+	  default:			return false; // FAIL
+	}
 }
 
-bool B2BModuleManager::StartAll()
+bool B2BModuleManager::BuildPhaseRun(Phase phase, PhaseRun *pRun) const
 {
+	b2bassert(pRun);
+
+	pRun->phase = phase;
+	pRun->modules.assign(m_modules.begin(), m_modules.end());
+	size_t numModules = pRun->modules.size();
+	pRun->next.assign(numModules, std::vector<size_t>());
+	pRun->numWaiting.assign(numModules, 0);
+	pRun->blocked.assign(numModules, false);
+	pRun->durations.assign(numModules, B2BTime::TimeValue());
+	pRun->ready.clear();
+	pRun->numDone = 0;
+	pRun->success = true;
+
+	std::map<std::string, size_t> moduleIndex;
+	for (size_t i = 0; i < numModules; ++i)
+		moduleIndex[pRun->modules[i]->Name()] = i;
+
 	bool returnVal = true; // assume success
-	B2BModules::iterator iter;
-	for (iter = m_modules.begin(); iter != m_modules.end(); ++iter) {
-		B2BModule *module = *iter;
-		if (module->Start(NULL))
-			returnVal = false; // FAIL: one failure means our method fails
+	for (size_t i = 0; i < numModules; ++i) {
+		const std::vector<std::string> &dependencies =
+											pRun->modules[i]->Dependencies();
+		for (size_t d = 0; d < dependencies.size(); ++d) {
+			std::map<std::string, size_t>::const_iterator iter =
+											moduleIndex.find(dependencies[d]);
+			if ((iter == moduleIndex.end()) || (iter->second == i)) {
+				B2BLog::Err(LogFilt::LM_APP,
+							"%s depends on %s which is not loaded.",
+							pRun->modules[i]->Name(), dependencies[d].c_str());
+				returnVal = false; // FAIL: keep going to log all of them
+				continue;
+			}
+			// Stop runs graph backwards: module i before what it needs
+			size_t before = iter->second;
+			size_t after = i;
+			if (phase == PHASE_STOP)
+				std::swap(before, after);
+			pRun->next[before].push_back(after);
+			pRun->numWaiting[after]++;
+		}
+	}
+	if (!returnVal)
+		return false; // FAIL: already logged
+
+	// Walk the graph once (without calling modules) to catch cycles.
+	// A module in a cycle never gets numWaiting of 0.
+	std::vector<size_t> numWaiting = pRun->numWaiting;
+	std::deque<size_t> ready;
+	for (size_t i = 0; i < numModules; ++i) {
+		if (numWaiting[i] == 0)
+			ready.push_back(i);
+	}
+	size_t numVisited = 0;
+	while (!ready.empty()) {
+		size_t i = ready.front();
+		ready.pop_front();
+		numVisited++;
+		for (size_t n = 0; n < pRun->next[i].size(); ++n) {
+			if (--numWaiting[pRun->next[i][n]] == 0)
+				ready.push_back(pRun->next[i][n]);
+		}
+	}
+	if (numVisited != numModules) {
+		for (size_t i = 0; i < numModules; ++i) {
+			if (numWaiting[i] != 0) {
+				B2BLog::Err(LogFilt::LM_APP,
+							"%s is in a module dependency cycle.",
+							pRun->modules[i]->Name());
+			}
+		}
+		return false; // FAIL
+	}
+
+	// Modules that need nothing can go now, in order added
+	for (size_t i = 0; i < numModules; ++i) {
+		if (pRun->numWaiting[i] == 0)
+			pRun->ready.push_back(i);
 	}
 
-	return returnVal;
+	return true; // SUCCESS
 }
 
-bool B2BModuleManager::StopAll()
+/*static*/ void *B2BModuleManager::PhaseWorker(void *arg)
 {
-	bool returnVal = true; // assume success
-	B2BModules::iterator iter;
-	for (iter = m_modules.begin(); iter != m_modules.end(); ++iter) {
-		B2BModule *module = *iter;
-		if (module->Stop(NULL))
-			returnVal = false; // FAIL: one failure means our method fails
+	PhaseRun *run = static_cast<PhaseRun *>(arg);
+
+	pthread_mutex_lock(&run->lock);
+	for (;;) {
+		while (run->ready.empty() && (run->numDone < run->modules.size()))
+			pthread_cond_wait(&run->cond, &run->lock);
+		if (run->numDone == run->modules.size())
+			break; // all done
+
+		size_t i = run->ready.front();
+		run->ready.pop_front();
+		B2BModule *module = run->modules[i];
+		bool blocked = run->blocked[i];
+		pthread_mutex_unlock(&run->lock);
+
+		bool success = false;
+		B2BTime::TimeValue duration;
+		duration.SetInvalid();
+		if (blocked) {
+			B2BLog::Err(LogFilt::LM_APP,
+						"%s %s skipped: a module it depends on failed.",
+						PhaseName(run->phase), module->Name());
+		} else {
+			B2BTime::TimeValue startTime = B2BTime::GetCurrTimeMonotonic();
+			success = CallModule(run->phase, module);
+			B2BTime::TimeValue endTime = B2BTime::GetCurrTimeMonotonic();
+			duration = endTime - startTime;
+			LifecycleTracer::Record(PhaseName(run->phase), module->Name(),
+									startTime, endTime);
+			if (!success) {
+				B2BLog::Err(LogFilt::LM_APP, "%s %s FAIL",
+							PhaseName(run->phase), module->Name());
+			}
+		}
+
+		pthread_mutex_lock(&run->lock);
+		run->durations[i] = duration;
+		if (!success)
+			run->success = false; // one failure means phase fails
+		for (size_t n = 0; n < run->next[i].size(); ++n) {
+			size_t next = run->next[i][n];
+			// Don't Init or Start a module whose dependency failed.  Always
+			// Stop, a module that failed to Stop shouldn't leak others.
+			if (!success && (run->phase != PHASE_STOP))
+				run->blocked[next] = true;
+			if (--run->numWaiting[next] == 0)
+				run->ready.push_back(next);
+		}
+		run->numDone++;
+		pthread_cond_broadcast(&run->cond);
+	}
+	pthread_mutex_unlock(&run->lock);
+
+	return NULL;
+}
+
+bool B2BModuleManager::RunPhase(Phase phase)
+{
+	PhaseRun run;
+	if (!BuildPhaseRun(phase, &run)) {
+		if (phase != PHASE_STOP)
+			return false; // FAIL: already logged
+
+		// Still have to stop everything.  Best we can do is reverse of
+		// the order modules were added.
+		B2BLog::Err(LogFilt::LM_APP, "StopAll: bad dependencies, "
+					"stopping in reverse of order added.");
+		B2BModules::reverse_iterator iter;
+		for (iter = m_modules.rbegin(); iter != m_modules.rend(); ++iter)
+			CallModule(phase, *iter);
+		return false; // FAIL
+	}
+
+	pthread_mutex_init(&run.lock, NULL);
+	pthread_cond_init(&run.cond, NULL);
+
+	B2BTime::TimeValue startTime = B2BTime::GetCurrTimeMonotonic();
+
+	// Calling thread is one of the workers
+	unsigned int numThreads = std::min<size_t>(m_maxParallel,
+											   run.modules.size());
+	std::vector<pthread_t> threads;
+	for (unsigned int t = 1; t < numThreads; ++t) {
+		pthread_t thread;
+		int ret = pthread_create(&thread, NULL,
+								 &B2BModuleManager::PhaseWorker, &run);
+		if (ret != 0) {
+			// Not fatal, the threads we have will do the work
+			B2BLog::Err(LogFilt::LM_APP, "%sAll: pthread_create FAIL: %d",
+						PhaseName(phase), ret);
+			break;
+		}
+		threads.push_back(thread);
+	}
+	PhaseWorker(&run);
+	for (size_t t = 0; t < threads.size(); ++t)
+		pthread_join(threads[t], NULL);
+
+	B2BTime::TimeValue duration = B2BTime::GetCurrTimeMonotonic() - startTime;
+
+	pthread_cond_destroy(&run.cond);
+	pthread_mutex_destroy(&run.lock);
+
+	for (size_t i = 0; i < run.modules.size(); ++i) {
+		m_timings[run.modules[i]].duration[phase] = run.durations[i];
+		if (!run.durations[i].IsInvalid()) {
+			B2BLog::Debug(LogFilt::LM_APP, "%s %s: %.3f ms",
+						  PhaseName(phase), run.modules[i]->Name(),
+						  TimeValueToMS(run.durations[i]));
+		}
 	}
+	B2BLog::Info(LogFilt::LM_APP, "%sAll: %d modules, %d threads, %.3f ms",
+				 PhaseName(phase), (int)run.modules.size(),
+				 (int)threads.size()+1, TimeValueToMS(duration));
 
-	return returnVal;
+	return run.success;
 }
@@ -3,16 +3,30 @@
 // Description: A module manager for loading, running, looking up,
 //				and automatically destructing all B2BModule in system.
 //
+//		Modules declare what they need with B2BModule::DependsOn.  InitAll,
+//		StartAll and StopAll order modules by those dependencies, and run
+//		modules with no dependency path between them on up to
+//		SetMaxParallel threads.  How long each module took is logged and
+//		available from GetModuleTiming.
+//
+#include <pthread.h>
+#include <string.h>
+#include <deque>
 #include <list>
+#include <map>
 #include <string>
+#include <vector>
+
+#include "boost/unordered_map.hpp"
 
 #include "common/b2bassert.h"
+#include "common/B2BTime.h"
 
 #include "B2BModule.h"
 
 class B2BModuleManager {
   public:
-	B2BModuleManager() {}
+	B2BModuleManager() : m_maxParallel(1) {}
 
 	// This destructor will call the destructor of all modules added
 	// by AddModule().
@@ -32,26 +46,53 @@ class B2BModuleManager {
 			B2BModule *b2bModule = dynamic_cast<B2BModule *>(module);
 			if (!b2bModule)
 				return NULL; // FAIL: couldn't typecast
-			module = dynamic_cast<T *>(AddModuleImpl(b2bModule));
-			if (!module)
-				return NULL; // FAIL: couldn't typecast
+			// Remember T so GetModule<T> needs no dynamic_cast
+			if (!AddModuleImpl(b2bModule, &ModuleTypeTag<T>::tag, module))
+				return NULL; // FAIL
 			return module;
 		}
 
 	// Returns B2BModule loaded by AddModule.
 	// RETURNS: module instance on success, NULL otherwise.
 	//
-	// PAY ATTENTION: GetModule is not necessarily efficient.  If you need
-	//		efficiency, then cache its return value in your own variable.
+	// GetModule is a hash lookup of moduleName.  If T is the type the
+	// module was added as there is no dynamic_cast.  For lookups in a
+	// loop use GetModuleHandle.
 	template <typename T>
 	T *GetModule(const char *moduleName) const
 		{ 
-			T *module = dynamic_cast<T *>(GetModuleImpl(moduleName, true));
-			if (!module)
-				return NULL; // FAIL: couldn't typecast
-			return module;
+			const RegistryEntry *entry = GetModuleImpl(moduleName, true);
+			if (!entry)
+				return NULL; // FAIL
+			return CastModule<T>(*entry);
 		}
 
+	// A module looked up once.  Get() is a single load, so it is fine to
+	// call every time you need the module.
+	// Valid until the module is deleted (DeleteModule or our destructor).
+	template <typename T>
+	class ModuleHandle {
+	  public:
+		ModuleHandle() : m_module(NULL) {}
+
+		// RETURNS: module, NULL if handle is not valid
+		T *Get() const { return m_module; }
+		T *operator->() const { return m_module; }
+		bool IsValid() const { return m_module != NULL; }
+
+	  private:
+		friend class B2BModuleManager;
+		explicit ModuleHandle(T *module) : m_module(module) {}
+
+		T *m_module;
+	};
+
+	// RETURNS: handle to module moduleName, IsValid() false if module is
+	//		not loaded or is not a T.
+	template <typename T>
+	ModuleHandle<T> GetModuleHandle(const char *moduleName) const
+		{ return ModuleHandle<T>(GetModule<T>(moduleName)); }
+
 	// Delete a B2BModule from this manager.  
 	// If module is found, its destructor is called.
 	// RETURNS: true on success, false otherwise
@@ -59,32 +100,153 @@ class B2BModuleManager {
 
 	// Initialize all the B2BModule
 	// Calls the B2BModule::Init() of all modules added by AddModule()
-	// Modules are called in order that they were added.
-	// RETURNS: true if every module's Init returned true, false otherwise
+	// A module is called after all modules it DependsOn returned true.
+	// If one of those failed, the module is not called.
+	// Modules with no dependencies between them are called in the order
+	// they were added (or at the same time, see SetMaxParallel).
+	// RETURNS: true if every module's Init returned true, false otherwise.
+	//		Also false if a dependency is not loaded or dependencies have
+	//		a cycle, in which case no module is called.
 	bool InitAll();
 
 	// Start all the B2BModule
 	// Calls the B2BModule::Start() of all modules added by AddModule()
-	// Modules are called in order that they were added.
+	// Modules are called in the same order as InitAll.
 	// RETURNS: true if every module's Start returned true, false otherwise
 	bool StartAll();
 
 	// Stop all the B2BModule
-	// Calls the B2BModule::Start() of all modules added by AddModule()
-	// Modules are called in order that they were added.
+	// Calls the B2BModule::Stop() of all modules added by AddModule()
+	// A module is called after all modules that DependsOn it, so reverse
+	// of InitAll order.  Every module is called even if some fail.
 	// RETURNS: true if every module's Stop returned true, false otherwise
 	bool StopAll();
 
+	// Most modules InitAll, StartAll and StopAll call at the same time.
+	// Default is 1: one module at a time in the calling thread.  Each extra
+	// one is a thread that only exists during those calls.
+	// maxParallel: 0 is treated as 1
+	void SetMaxParallel(unsigned int maxParallel)
+		{ m_maxParallel = maxParallel ? maxParallel : 1; }
+
+	// How long each phase took for one module
+	typedef enum {
+		PHASE_INIT,
+		PHASE_START,
+		PHASE_STOP,
+		PHASE_TOTAL
+	} Phase;
+	struct ModuleTiming {
+		// Time module's Init, Start or Stop took the last time it was
+		// called.  IsInvalid() if it was never called.
+		B2BTime::TimeValue duration[PHASE_TOTAL];
+
+		ModuleTiming()
+		{
+			for (int phase = 0; phase < PHASE_TOTAL; ++phase)
+				duration[phase].SetInvalid();
+		}
+	};
+
+	// pTiming: filled with timing of moduleName if method returns true
+	// RETURNS: true on success, false if moduleName not loaded
+	bool GetModuleTiming(const char *moduleName, ModuleTiming *pTiming) const;
+
   private:
+	// One address per type.  Compared to tell if a module was added as
+	// the type GetModule asks for.
+	template <typename T>
+	struct ModuleTypeTag {
+		static const char tag;
+	};
+
+	// A loaded module
+	struct RegistryEntry {
+		B2BModule *module;
+		const void *typeTag;	// ModuleTypeTag of type module was added as
+		void *typedModule;		// module as that type
+	};
+
+	template <typename T>
+	static T *CastModule(const RegistryEntry &entry)
+		{
+			if (entry.typeTag == &ModuleTypeTag<T>::tag)
+				return static_cast<T *>(entry.typedModule);
+			// Asked for a different type (a base class say), have to check
+			return dynamic_cast<T *>(entry.module);
+		}
+
 	// See template versions above for documentation
-	B2BModule *AddModuleImpl(B2BModule *module);
+	B2BModule *AddModuleImpl(B2BModule *module, const void *typeTag,
+							 void *typedModule);
 	// expected: if true, it means we expect moduleName to be there
 	//			 if false, we don't expect it to be there
-	B2BModule *GetModuleImpl(const char *moduleName, bool expected) const;
+	const RegistryEntry *GetModuleImpl(const char *moduleName,
+									   bool expected) const;
+
+	// One InitAll, StartAll or StopAll call.  Shared by all its threads.
+	struct PhaseRun {
+		Phase phase;
+		std::vector<B2BModule *> modules;		// in order added
+		// For each module, modules to call after it
+		std::vector<std::vector<size_t> > next;
+		// For each module, number of modules still to call before it
+		std::vector<size_t> numWaiting;
+		// For each module, true if a module before it failed
+		std::vector<bool> blocked;
+		std::vector<B2BTime::TimeValue> durations;
+		std::deque<size_t> ready;	// modules that can be called now
+		size_t numDone;
+		bool success;
+		pthread_mutex_t lock;
+		pthread_cond_t cond;	// signalled when ready or numDone changes
+	};
+
+	// Fill pRun modules and dependency graph for phase.  StopAll runs
+	//		the graph backwards.
+	// RETURNS: true on success, false if a dependency is not loaded or
+	//		dependencies have a cycle
+	bool BuildPhaseRun(Phase phase, PhaseRun *pRun) const;
 
-	// Return true if module is labeled by moduleName
-	static bool ModuleCompare(const B2BModule *module, const char *moduleName);
+	// Call phase method of every module, up to m_maxParallel at a time.
+	// RETURNS: true if every module succeeded, false otherwise
+	bool RunPhase(Phase phase);
+
+	// Thread routine: call modules from run->ready until all are done.
+	// arg: PhaseRun *
+	static void *PhaseWorker(void *arg);
+
+	// Call phase method of one module
+	// RETURNS: true on success, false otherwise
+	static bool CallModule(Phase phase, B2BModule *module);
+
+	static const char *PhaseName(Phase phase);
 
   	typedef std::list<B2BModule *> B2BModules;
   	B2BModules m_modules; // all the modules added by AddModule()
+	// Registry hash and compare.  Work on const char * too so GetModule
+	// does not have to make a std::string.
+	struct NameHash {
+		size_t operator()(const char *name) const
+			{ return boost::hash_range(name, name + strlen(name)); }
+		size_t operator()(const std::string &name) const
+			{ return boost::hash_range(name.begin(), name.end()); }
+	};
+	struct NameEqual {
+		bool operator()(const char *a, const std::string &b) const
+			{ return b == a; }
+		bool operator()(const std::string &a, const std::string &b) const
+			{ return a == b; }
+	};
+	// Same modules by name
+	typedef boost::unordered_map<std::string, RegistryEntry,
+								 NameHash, NameEqual> Registry;
+	Registry m_registry;
+
+	unsigned int m_maxParallel;	// from SetMaxParallel
+	typedef std::map<const B2BModule *, ModuleTiming> ModuleTimings;
+	ModuleTimings m_timings; // filled by RunPhase
 };
+
+template <typename T>
+const char B2BModuleManager::ModuleTypeTag<T>::tag = 0;
@@ -6,12 +6,46 @@
 //			its data structure is ENTRY_INTERNAL.
 //		WARNING: Client must call Init() and Start() to enable this class.
 //
+//		Callers and our thread share no lock.  ExecuteList builds an
+//		immutable, reference counted list and hands it to our thread
+//		through a one entry mailbox.  Whether a list is in progress, and
+//		which one, is one atomic state word.  Our thread keeps its own
+//		reference to the list it is running, so nothing is copied per entry
+//		or per loop.
+//		ExecuteList and StopExecuting must be called from one thread at
+//		a time (normally the behavior thread).
+//		When it has no list our thread sleeps on an eventfd, using no CPU,
+//		and ExecuteList and StopExecuting wake it right away.
+//
+//		Each list has a priority.  A list preempts a list of lower priority
+//		after the entry in progress (or during it, see WorkerInterrupt).
+//		The preempted list remembers where it was, and resumes from there
+//		when the preempting list is done.
+//
+//		QueueList queues lists to execute one after the other.  Each is
+//		built when it is queued, so our thread goes from one list to the
+//		next with no gap and no round trip through the caller.
+//
+//		Stats() times building, waiting, executing and callbacks, see
+//		ExecuteListStats.  Off until Stats().SetEnabled(true).
+//
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <vector>
 
+#include "boost/atomic.hpp"
+#include "boost/shared_ptr.hpp"
+
 #include "common/b2bassert.h"
 #include "common/B2BTime.h"
 #include "log/B2BLog.h"
 
+#include "ExecuteListStats.h"
 #include "ExecuteListType.h"
 
 #include "ThreadModule.h"
@@ -26,11 +60,18 @@ class ExecuteListInThread : public ThreadModule {
 	// ExecuteList(execList, ...): Execute items from a list.  
 	// 		execList: list of entries to execute
 	//		Executed in order in execList.
-	//		If not looping, will fail and return false if this instance is
-	//			already in process of executing a list.
-	//		If looping, will cancel the current looping list and execute
+	//		If a list of the same priority is executing:
+	//			If not looping, will fail and return false.
+	//			If looping, will cancel the current looping list and execute
 	//			this ExecuteList() call.  Current loop list's pDoneCallback
-	//			*will be* called with reason NEWSTART.
+	//			*will be* called with reason NEWSTART (from this call).
+	//		If a list of lower priority is executing, it is preempted:
+	//			this list starts after the entry in progress, and the
+	//			preempted list resumes after this one is done.  Preempted
+	//			list's pDoneCallback is called with reason PREEMPTED (from
+	//			this call), and again later when it is really done.
+	//		If a list of higher priority is executing, will fail and return
+	//			false.
 	// Execute(entry, ...): Execute one item.   Uses ExecuteList()
 	// 		entry: the one entry to execute
 	//		This is equivalent to calling ExecuteList() with a list of length 1
@@ -39,8 +80,8 @@ class ExecuteListInThread : public ThreadModule {
 	// buildExecListInternal: Create an internal list given the execList to
 	//		execute.  Also handle any other needed logic.
 	// 		This RETURNS: true on success, false otherwise
-	//		PAY ATTENTION: This routine is called with mutex locked.
-	//			Therefore this routine must be fast and simple.
+	//		Called in the caller's thread before the list is handed to our
+	//			thread, so it may take its time (read files, etc).
 	// loopExecList: If true, loop executing execList until StopExecuting()
 	//		 called.
 	//		 If false, execute execList once only.
@@ -50,6 +91,10 @@ class ExecuteListInThread : public ThreadModule {
 	//		Caller should set to NULL if no reporting is desired.
 	//		If loopExecList is true, only called once when StopExecuting() is
 	//			called and StopExecuting gives option of calling it or not.
+	//		Also called with PREEMPTED each time the list is preempted.
+	// doneCallback: same as pDoneCallback, for the versions that take a
+	//		DoneDelegate.  It is copied, caller need not keep it.
+	// priority: see above
 	//
 	// RETURNS: true on success, false otherwise
 	typedef std::vector<ENTRY> ExecList;
@@ -59,20 +104,83 @@ class ExecuteListInThread : public ThreadModule {
 	bool ExecuteList(const char *label, const ExecList &execList,  
 					BuildExecListInternal &buildExecListInternal,
 					bool loopExecList=false,
-					const ExecuteListType::DoneCallback *pDoneCallback=NULL);
+					const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+					ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL)
+	{
+		return ExecuteList(label, execList, buildExecListInternal,
+						   loopExecList,
+						   ExecuteListType::ToDoneDelegate(pDoneCallback),
+						   priority);
+	}
+	bool ExecuteList(const char *label, const ExecList &execList,
+					BuildExecListInternal &buildExecListInternal,
+					bool loopExecList,
+					const ExecuteListType::DoneDelegate &doneCallback,
+					ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL);
 				
 	bool Execute(const char *label, ENTRY entry, 
 					BuildExecListInternal &buildExecListInternal,
 					bool loopExecList=false,
-					const ExecuteListType::DoneCallback *pDoneCallback=NULL)
+					const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+					ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL)
 	{ 
+		return Execute(label, entry, buildExecListInternal, loopExecList,
+					   ExecuteListType::ToDoneDelegate(pDoneCallback),
+					   priority);
+	}
+	bool Execute(const char *label, ENTRY entry,
+					BuildExecListInternal &buildExecListInternal,
+					bool loopExecList,
+					const ExecuteListType::DoneDelegate &doneCallback,
+					ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL)
+	{
 		ExecList execList;
 		execList.push_back(entry);
 	  	return ExecuteList(label, execList, buildExecListInternal, 
-							loopExecList, pDoneCallback);
+							loopExecList, doneCallback, priority);
 	}
 
-	// Stops execution of current list
+	// QueueList(label, execList, ...): Execute items from a list after the
+	//		list executing, and lists queued before this one, are done.
+	//		Starts right away if nothing is executing.
+	//		buildExecListInternal is called now, in the caller's thread, so
+	//		the list starts as soon as the list before it is done.
+	//		A looping list ends, with reason NEWSTART, at the end of its
+	//		pass when a list is queued.
+	//		Lists preempted by the executing list resume before queued
+	//		lists start.
+	//		Will fail and return false if MAX_QUEUED_LISTS lists are
+	//			already queued.
+	//		Queued lists are executed once.  Other arguments are the same
+	//		as ExecuteList.
+	//
+	// RETURNS: true on success, false otherwise
+	static const uint32_t MAX_QUEUED_LISTS = 8;	// must divide 16
+	bool QueueList(const char *label, const ExecList &execList,
+					BuildExecListInternal &buildExecListInternal,
+					const ExecuteListType::DoneCallback *pDoneCallback=NULL,
+					ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL)
+	{
+		return QueueList(label, execList, buildExecListInternal,
+						 ExecuteListType::ToDoneDelegate(pDoneCallback),
+						 priority);
+	}
+	bool QueueList(const char *label, const ExecList &execList,
+					BuildExecListInternal &buildExecListInternal,
+					const ExecuteListType::DoneDelegate &doneCallback,
+					ExecuteListType::Priority priority=
+											ExecuteListType::PRIORITY_NORMAL);
+
+	// RETURNS: number of lists queued by QueueList that have not started
+	uint32_t NumQueuedLists() const { return QueueCount(m_state.load()); }
+
+	// Stops execution of current list, of lists it preempted and of
+	// queued lists
 	// This DOES NOT stop executing the entry in progress.  
 	// If executing a list, the remainder of the list will be cancelled.
 	//		IMPROVE: do stop current entry by killing and restarting thread?
@@ -81,73 +189,298 @@ class ExecuteListInThread : public ThreadModule {
 	//					work for them.   Better to add this kill as an option
 	//					so that we can retain previous behavior.
 	//
-	// reason: passed to ExecState::pDoneCallback(reason)
+	// reason: passed to pDoneCallback(reason)
 	// executeCallback: If true, StopExecuting method will directly call
-	//		ExecState::pDoneCallback(reason).
-	//		If false, StopExecuting method will not directly call it.
-	//		executeCallback is only used if ExecState::pDoneCallback != NULL
-	//		WARNING: Be very careful when using true: you do not want
-	//			to call callback twice (once in StopExecuting and once
-	//			in WorkerExecute())
+	//		pDoneCallback(reason).
+	//		If false, our thread calls pDoneCallback(DONEREASON_STOP) when
+	//		it sees the list was stopped.
+	//		Either way pDoneCallback is called only once.
+	//		Preempted lists are never resumed and queued lists never
+	//		start.  This method calls their pDoneCallback, with reason if
+	//		executeCallback is true and with DONEREASON_STOP if not.
 	// logInfo: If true, B2BLog::Info that this method is called with
 	//			reason information.  If false, use B2BLog:Debug.
 	//
 	// RETURNS: true on success, false otherwise
-	// CORNER CASE: If list is NOT executing (exectListInProg is already NULL),
-	//		this method is a NOP and it does not call the callback.
-	//		In this case, this method will return true.
+	// CORNER CASE: If list is NOT executing, this method is a NOP and it
+	//		does not call the callback.  In this case, this method will
+	//		return true.
 	bool StopExecuting(ExecuteListType::DoneReason reason,
 						bool executeCallback=false,
 						bool logInfo=false);
 
 	// Returns true if currently executing a list, false otherwise
-	bool IsExecuting() { return m_execState.execListInProg; }
+	bool IsExecuting() const { return m_state.load() & STATE_IN_PROG; }
 
-  protected:
-	// used to protect m_execState from async callers to Execute*()
-	pthread_mutex_t m_execListLock; 
+	// Timing histograms and counters, see ExecuteListStats.  Not recorded
+	// until Stats().SetEnabled(true).  Read with Stats().GetSnapshot or
+	// Stats().Log.
+	ExecuteListStats &Stats() { return m_stats; }
 
+  protected:
 	// START: required protected virtual from ThreadModule
-	// Executes list if execListInProg is true and execList is not empty
+	// Executes list handed to us by ExecuteList, until it completes or is
+	// stopped
 	void *Worker(void *arg);
 	// END: required protected virtual from ThreadModule
 
+	// ThreadModule virtual: wakes Worker if it is waiting for a list.
+	// Stop calls it so Worker can quit, ExecuteList so it sees the list.
+	void WakeWorker();
+
 	// Called to execute logic when list is executing
 	// RETURNS: true if Worker should keep executing the list, false if Worker
 	//			should stop the list
 	virtual bool WorkerExecute(const ENTRY_INTERNAL &entry) = 0;
 
-	// Called at end of each loop in Worker.  Client must do something
-	// to yield control to other threads (for example, sleep will do it).
+	// Called after each pass through a list (and after a stopped list is
+	// dropped), unless a queued or preempted list starts right after it.
+	// Client must do something to yield control to other threads (for
+	// example, sleep will do it).
+	// Not called while there is no list: then Worker waits for
+	// ExecuteList or StopExecuting.
 	virtual void WorkerYield() = 0;
 
-	// execListInProg: if true, we have an execList loaded to execute
-	//				or the execList is currently executing.
-	//			 if false, no execList is active
+	// Called by ExecuteList, in its thread, when it preempts the list
+	// Worker is executing.  Optional: cut short the entry WorkerExecute is
+	// executing (for example, stop the sound playing) so the new list
+	// starts sooner.  What WorkerExecute returns for a cut entry is ignored.
+	// RETURNS: true if an entry was cut short, it is executed again from
+	//		its start when the list resumes.  false (default) if nothing
+	//		was cut, the list resumes after the entry.
+	virtual bool WorkerInterrupt() { return false; }
+
+  private:
+	class ExecCommand;
+	typedef boost::shared_ptr<ExecCommand> ExecCommandPtr;
+
+	// One ExecuteList call.  Never changed after it is handed to Worker,
+	// except the atomics and resumePos.
+	// generation: m_state generation while this list is the current one.
+	//		Worker gives it a new one when it resumes the list.
 	// execList: the execution list
 	// loopExecList: if true, we want to loop execution of the execList
 	// 				 if false, we execute the execList once
-    class ExecState {
+	// priority: see ExecuteList
+	// preempted: list this one preempted, to resume when this one is
+	//		done.  Its own preempted is the one to resume after that, and
+	//		so on.  A list that replaces this one (NEWSTART) takes it over.
+	// doneClaimed: set by whoever will call pDoneCallback, so it is called
+	//		once.  ExecuteList and StopExecuting claim it before they
+	//		change m_state, so Worker can't call it first with the wrong
+	//		reason.
+	// endReason: set by Worker before it ends the list itself, for when
+	//		ExecuteList or StopExecuting claimed the callback just before
+	// interruptState: INTERRUPT_xxx.  Set by ExecuteList when it preempts
+	//		the list, cleared by Worker when it resumes it.
+	// resumePos: only used by Worker, entry to resume at
+	// enqueueNS: when list was handed to Worker, 0 if stats were off
+	// stats: where CallDone records callback time
+	// started: only used by Worker, it executed an entry of the list
+	class ExecCommand {
 	  public:
-        ExecState() : 
-			execListInProg(false), loopExecList(false), pDoneCallback(NULL) {}
+		ExecCommand(uint32_t newGeneration,
+					const boost::shared_ptr<const ExecListInternal> &newList,
+					bool newLoopExecList,
+					const ExecuteListType::DoneDelegate &newDoneCallback,
+					ExecuteListType::Priority newPriority,
+					const ExecCommandPtr &newPreempted,
+					uint64_t newEnqueueNS,
+					ExecuteListStats &newStats) :
+			generation(newGeneration), execList(newList),
+			loopExecList(newLoopExecList), doneCallback(newDoneCallback),
+			priority(newPriority), preempted(newPreempted),
+			endReason(ExecuteListType::DONEREASON_COMPLETE),
+			interruptState(INTERRUPT_NONE), resumePos(0),
+			enqueueNS(newEnqueueNS), stats(newStats), started(false),
+			doneClaimed(false)
+		{}
 
-		// Reset to empty and nothing running.
-        void Reset()
+		// RETURNS: true if caller must call CallDone, false if someone
+		//		else already claimed it
+		bool ClaimDone() { return !doneClaimed.exchange(true); }
+		void CallDone(ExecuteListType::DoneReason reason)
+		{
+			if (!doneCallback.empty()) {
+				uint64_t beginNS = stats.Begin();
+				doneCallback(reason);
+				stats.End(ExecuteListStats::METRIC_CALLBACK, beginNS);
+			}
+		}
+		// Call pDoneCallback(reason) unless it was already claimed
+		void Done(ExecuteListType::DoneReason reason)
 		{
-			loopExecList = false;
-			execListInProg = false;
-			execList.clear();
-			pDoneCallback = NULL;
+			if (ClaimDone())
+				CallDone(reason);
 		}
+		// RETURNS: true if list was preempted and not resumed yet
+		bool IsPreempted() const
+			{ return interruptState.load() != INTERRUPT_NONE; }
+
+		boost::atomic<uint32_t> generation;
+		const boost::shared_ptr<const ExecListInternal> execList;
+		const bool loopExecList;
+		const ExecuteListType::DoneDelegate doneCallback;
+		const ExecuteListType::Priority priority;
+		const ExecCommandPtr preempted;
+		boost::atomic<int> endReason;	// ExecuteListType::DoneReason
+		boost::atomic<int> interruptState;
+		typename ExecListInternal::size_type resumePos;
+		const uint64_t enqueueNS;
+		ExecuteListStats &stats;
+		bool started;
 
-		bool execListInProg;
-		ExecListInternal execList;
+	  private:
+		boost::atomic<bool> doneClaimed;
+	};
 
-		bool loopExecList;
-		const ExecuteListType::DoneCallback	*pDoneCallback;
+	// ExecCommand::interruptState
+	enum {
+		INTERRUPT_NONE = 0,		// not preempted
+		INTERRUPT_PENDING,		// preempted, WorkerInterrupt not done yet
+		INTERRUPT_CUT,			// WorkerInterrupt cut the entry short
+		INTERRUPT_NOT_CUT		// WorkerInterrupt cut nothing
 	};
-	ExecState m_execState;	// Our execution state
+
+	// m_state bits.  Rest of the bits are the generation, bumped every
+	// time a list starts, resumes or is stopped so Worker can tell its
+	// list is no longer the current one.
+	static const uint32_t STATE_IN_PROG = 0x1;	// a list is executing
+	static const uint32_t STATE_LOOP = 0x2;		// and it loops
+	static const uint32_t STATE_PRIORITY_MASK = 0xc;	// and its priority
+	static const uint32_t STATE_PRIORITY_SHIFT = 2;
+	// Lists queued in m_queue: index of first one (counts to 15 and
+	// wraps) and how many.  Kept in m_state so queueing a list, starting
+	// a queued list and StopExecuting can't miss each other.
+	static const uint32_t STATE_QUEUE_HEAD_MASK = 0xf0;
+	static const uint32_t STATE_QUEUE_HEAD_SHIFT = 4;
+	static const uint32_t STATE_QUEUE_COUNT_MASK = 0xf00;
+	static const uint32_t STATE_QUEUE_COUNT_SHIFT = 8;
+	static const uint32_t STATE_QUEUE_MASK =
+							STATE_QUEUE_HEAD_MASK | STATE_QUEUE_COUNT_MASK;
+	static const uint32_t STATE_GEN_SHIFT = 12;
+	static uint32_t StateGeneration(uint32_t state)
+		{ return state >> STATE_GEN_SHIFT; }
+	// RETURNS: generation after state's (wraps)
+	static uint32_t NextGeneration(uint32_t state)
+		{ return (StateGeneration(state) + 1) & (~0U >> STATE_GEN_SHIFT); }
+	static uint32_t QueueHead(uint32_t state)
+		{ return (state & STATE_QUEUE_HEAD_MASK) >> STATE_QUEUE_HEAD_SHIFT; }
+	static uint32_t QueueCount(uint32_t state)
+		{ return (state & STATE_QUEUE_COUNT_MASK) >> STATE_QUEUE_COUNT_SHIFT; }
+	// RETURNS: m_state queue bits
+	static uint32_t QueueState(uint32_t head, uint32_t count)
+	{
+		return ((head << STATE_QUEUE_HEAD_SHIFT) & STATE_QUEUE_HEAD_MASK) |
+			   (count << STATE_QUEUE_COUNT_SHIFT);
+	}
+	// RETURNS: m_queue slot of queue index
+	static uint32_t QueueSlot(uint32_t index)
+		{ return index % MAX_QUEUED_LISTS; }
+	static ExecuteListType::Priority StatePriority(uint32_t state)
+	{
+		return static_cast<ExecuteListType::Priority>(
+					(state & STATE_PRIORITY_MASK) >> STATE_PRIORITY_SHIFT);
+	}
+	// RETURNS: m_state value for command executing at generation
+	// queueState: queue bits to keep
+	static uint32_t InProgState(uint32_t generation,
+								const ExecCommand &command,
+								uint32_t queueState)
+	{
+		return (generation << STATE_GEN_SHIFT) | STATE_IN_PROG |
+			   (command.loopExecList ? STATE_LOOP : 0) |
+			   (command.priority << STATE_PRIORITY_SHIFT) |
+			   (queueState & STATE_QUEUE_MASK);
+	}
+
+	// RETURNS: true if command is still the list we should execute
+	bool IsCurrent(const ExecCommand &command) const
+	{
+		return (StateGeneration(m_state.load()) == command.generation);
+	}
+
+	// Worker: wait until WakeWorker is called
+	void WaitForWork();
+
+	// ExecuteList/QueueList: make an already built list the current one.
+	//		Rest is the same as ExecuteList.
+	// size: execList size, for logging
+	bool StartList(const char *label, size_t size,
+				   const boost::shared_ptr<const ExecListInternal> &newList,
+				   bool loopExecList,
+				   const ExecuteListType::DoneDelegate &doneCallback,
+				   ExecuteListType::Priority priority);
+
+	// QueueList/StopExecuting: drop our references to queued lists that
+	//		have started, so their memory is freed when they are done.
+	// state: m_state value to go by
+	void ReleaseStartedQueued(uint32_t state);
+
+	// ExecuteList/StopExecuting: get list in progress.
+	// pState: filled with m_state it goes with
+	// RETURNS: list in progress, empty if none
+	ExecCommandPtr GetCurrentCommand(uint32_t *pState) const;
+
+	// Worker: mark command's list as no longer executing, if it still is
+	//		current.  If it preempted a list, that list becomes current.
+	//		If not, the first queued list, if any, becomes current.
+	// reason: why, see ExecCommand::endReason
+	// pNext: filled with the list that became current, if any
+	// RETURNS: true if we did, false if someone else stopped, replaced or
+	//		preempted it
+	bool EndCommand(ExecCommand &command, ExecuteListType::DoneReason reason,
+					ExecCommandPtr *pNext);
+
+	// Worker: remember where a preempted list stopped, so it resumes there.
+	// nextPos: first entry not executed
+	// ranEntry: true if entry before nextPos was executed in this Worker
+	//		call, and might have been cut short by WorkerInterrupt
+	void SavePreempted(ExecCommand &command,
+					   typename ExecListInternal::size_type nextPos,
+					   bool ranEntry);
+
+	// ExecuteList/StopExecuting: call pDoneCallback of a command whose
+	//		callback we claimed.
+	// replacedState: m_state value we replaced (or saw if we changed none)
+	// reason: reason to give if we stopped the list.  If Worker ended it
+	//		first, its reason is given.
+	void CallClaimedDone(ExecCommand &command, uint32_t replacedState,
+						 ExecuteListType::DoneReason reason);
+
+	boost::atomic<uint32_t> m_state;	// see STATE_xxx
+
+	// Mailbox from ExecuteList to Worker.  Holds a heap ExecCommandPtr
+	// (or NULL), swapped in and out with atomic exchange.
+	boost::atomic<ExecCommandPtr *> m_pendingCommand;
+
+	// List whose generation is in m_state, so ExecuteList and
+	// StopExecuting can call its pDoneCallback.  Stored by ExecuteList,
+	// and by Worker when it resumes a list, just after they change m_state.
+	// Only use with boost::atomic_load and boost::atomic_store.
+	ExecCommandPtr m_currentCommand;
+
+	// Only used by Worker: list it is running (kept between loops)
+	ExecCommandPtr m_workerCommand;
+
+	// Lists queued by QueueList, a ring.  Which slots hold queued lists
+	// is in m_state.  Only use with boost::atomic_load and
+	// boost::atomic_store: Worker may read a slot with an old m_state as
+	// QueueList reuses it.  Its change to m_state fails then.
+	ExecCommandPtr m_queue[MAX_QUEUED_LISTS];
+	// Only used by caller of QueueList/StopExecuting: queue index of first
+	// slot still holding a started list (see ReleaseStartedQueued)
+	uint32_t m_queueReleased;
+
+	ExecuteListStats m_stats;
+	// Only used by Worker: when its last WorkerExecute returned, for
+	// METRIC_GAP.  0 if it waited for a list since, or stats were off.
+	uint64_t m_lastEntryEndNS;
+
+	// eventfd Worker waits on when it has no list, -1 if eventfd failed
+	int m_wakeFd;
+	// Used by WaitForWork if m_wakeFd is -1
+	static const useconds_t WAIT_FALLBACK_US = 50*1000;
 
 	// tests need access to privates
 	friend class CreatureMenu;
@@ -156,21 +489,61 @@ class ExecuteListInThread : public ThreadModule {
 template <typename ENTRY, typename ENTRY_INTERNAL>
 ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::ExecuteListInThread(
 														const char *name) :
-  ThreadModule(name)
-  //m_execState() // init'ed by its own ctor
+  ThreadModule(name),
+  m_state(0),
+  m_pendingCommand(NULL),
+  m_queueReleased(0),
+  m_lastEntryEndNS(0)
 {
-	pthread_mutexattr_t mutexattr;
-	pthread_mutexattr_init(&mutexattr);
-	pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
-	pthread_mutex_init(&m_execListLock, &mutexattr);
+	m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeFd < 0) {
+		// Still works, Worker just polls
+		B2BLog::Err(LogFilt::LM_APP, "%s: eventfd FAIL: %s",
+					Name(), strerror(errno));
+	}
 }
 
 template <typename ENTRY, typename ENTRY_INTERNAL>
 ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::~ExecuteListInThread()
 {
 	Stop(NULL); // Stop our thread
-	m_execState.Reset(); // Reset to empty and nothing running
-	pthread_mutex_destroy(&m_execListLock);
+	// Drop any list Worker never picked up
+	delete m_pendingCommand.exchange(NULL);
+	if (m_wakeFd >= 0)
+		close(m_wakeFd);
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::WakeWorker()
+{
+	if (m_wakeFd < 0)
+		return; // Worker polls
+
+	// Adds to eventfd's count.  Can't block (EFD_NONBLOCK) and a wake
+	// already pending is as good as this one, so ignore errors.
+	uint64_t one = 1;
+	ssize_t ret = write(m_wakeFd, &one, sizeof(one));
+	(void)ret;
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::WaitForWork()
+{
+	if (m_wakeFd < 0) {
+		usleep(WAIT_FALLBACK_US);
+		return;
+	}
+
+	// A wake written since Worker last looked is still counted in the
+	// eventfd, so poll returns right away and none is missed
+	struct pollfd pfd;
+	pfd.fd = m_wakeFd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, -1) > 0) {
+		uint64_t count;
+		ssize_t ret = read(m_wakeFd, &count, sizeof(count)); // reset count
+		(void)ret;
+	} // else: EINTR, Worker is called again anyway
 }
 
 template <typename ENTRY, typename ENTRY_INTERNAL>
@@ -178,72 +551,278 @@ bool ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::ExecuteList(const char *label,
 					const ExecList &execList,
 					BuildExecListInternal &buildExecListInternal,
 					bool loopExecList,
-					const ExecuteListType::DoneCallback *pDoneCallback)
+					const ExecuteListType::DoneDelegate &doneCallback,
+					ExecuteListType::Priority priority)
 {
-	pthread_mutex_lock(&m_execListLock);
-	const ExecuteListType::DoneCallback *pExecStateDoneCallback = NULL;
-	if (m_execState.execListInProg) {
-		if (m_execState.loopExecList) {
-			// Stop previous loop and continue
-			pExecStateDoneCallback = m_execState.pDoneCallback; // save it for later
-			// Do not call callback in here (2nd param is false).  Must be
-			// called with no mutex lock held to avoid deadlock.
-			StopExecuting(ExecuteListType::DONEREASON_NEWSTART, false, false);
-		} else {
-			// We are already executing a list and we are not looping.
-			// This is not allowed.
-			// Do not start a new execution.
-			pthread_mutex_unlock(&m_execListLock);
-			B2BLog::Info(LogFilt::LM_APP, "%s(%d) ignored because it is already busy executing a previous list.", 
-				label, (int)execList.size());
-			return false;  // FAIL
-		}
-	} // else: not currently executing a list
+	b2bassert((priority >= 0) && (priority < ExecuteListType::PRIORITY_TOTAL));
+	if ((priority < 0) || (priority >= ExecuteListType::PRIORITY_TOTAL)) {
+		B2BLog::Err(LogFilt::LM_APP, "%s(%d): bad priority %d",
+					label, (int)execList.size(), (int)priority);
+		return false; // FAIL
+	}
 
-	b2bassert(m_execState.execList.empty());
-	m_execState.Reset(); // Reset to empty and nothing running
-	m_execState.loopExecList = loopExecList;
-	m_execState.pDoneCallback = pDoneCallback;
+	uint32_t state = m_state.load();
+	if ((state & STATE_IN_PROG) &&
+		((priority < StatePriority(state)) ||
+		 ((priority == StatePriority(state)) && !(state & STATE_LOOP))))
+	{
+		// We are already executing a list of higher priority, or of the
+		// same priority that is not looping.
+		// This is not allowed.
+		// Do not start a new execution.
+		B2BLog::Info(LogFilt::LM_APP, "%s(%d,%s) ignored because it is already busy executing a previous list.",
+			label, (int)execList.size(),
+			ExecuteListType::PriorityToString(priority));
+		m_stats.Count(ExecuteListStats::COUNTER_REJECTED);
+		return false;  // FAIL
+	}
 
-	if (!(buildExecListInternal)(execList, &m_execState.execList)) {
-		m_execState.Reset(); // Reset to empty and nothing running
-		pthread_mutex_unlock(&m_execListLock);
+	// Build list before we touch any state, Worker never sees a list that
+	// failed to build
+	boost::shared_ptr<ExecListInternal> newList(new ExecListInternal);
+	uint64_t buildNS = m_stats.Begin();
+	bool built = (buildExecListInternal)(execList, newList.get());
+	m_stats.End(ExecuteListStats::METRIC_BUILD, buildNS);
+	if (!built)
 		return false; // FAIL
+
+	return StartList(label, execList.size(), newList, loopExecList,
+					 doneCallback, priority);
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::StartList(const char *label,
+				size_t size,
+				const boost::shared_ptr<const ExecListInternal> &newList,
+				bool loopExecList,
+				const ExecuteListType::DoneDelegate &doneCallback,
+				ExecuteListType::Priority priority)
+{
+	// Make our list the current one.  Loops only if Worker finished a list
+	// (changed m_state) under us.
+	uint32_t state;
+	ExecCommandPtr newCommand;
+	ExecCommandPtr prevCommand;	// replaced (NEWSTART) looping list
+	bool prevClaimed = false;
+	ExecCommandPtr preemptedCommand;
+	uint64_t enqueueNS = m_stats.Begin();
+	for (;;) {
+		ExecCommandPtr current = GetCurrentCommand(&state);
+		ExecCommandPtr resumeLater;	// newCommand resumes it when done
+		if (current) {
+			ExecuteListType::Priority currentPriority =
+													StatePriority(state);
+			if (priority > currentPriority) {
+				preemptedCommand = current;
+				resumeLater = current;
+			} else if ((priority == currentPriority) &&
+					   (state & STATE_LOOP))
+			{
+				// We will replace the loop, and resume what it would have
+				prevCommand = current;
+				resumeLater = current->preempted;
+			} else {
+				// Can only happen if another thread called ExecuteList, or
+				// Worker resumed or started a list
+				B2BLog::Info(LogFilt::LM_APP, "%s(%d,%s) ignored because it is already busy executing a previous list.",
+					label, (int)size,
+					ExecuteListType::PriorityToString(priority));
+				m_stats.Count(ExecuteListStats::COUNTER_REJECTED);
+				return false;  // FAIL
+			}
+		}
+
+		uint32_t newGeneration = NextGeneration(state);
+		newCommand.reset(new ExecCommand(newGeneration, newList,
+										 loopExecList, doneCallback,
+										 priority, resumeLater, enqueueNS,
+										 m_stats));
+		if (prevCommand)
+			prevClaimed = prevCommand->ClaimDone();
+		if (preemptedCommand)
+			preemptedCommand->interruptState = INTERRUPT_PENDING;
+		if (m_state.compare_exchange_strong(state,
+						InProgState(newGeneration, *newCommand, state)))
+			break; // SUCCESS
+
+		// Worker ended the list under us, try again
+		if (preemptedCommand) {
+			preemptedCommand->interruptState = INTERRUPT_NONE;
+			preemptedCommand.reset();
+		}
+		if (prevCommand) {
+			if (prevClaimed)
+				CallClaimedDone(*prevCommand, state,
+								ExecuteListType::DONEREASON_NEWSTART);
+			prevCommand.reset();
+			prevClaimed = false;
+		}
 	}
+	boost::atomic_store(&m_currentCommand, newCommand);
+	m_stats.Count(ExecuteListStats::COUNTER_LISTS);
 
-	// enable after building ExecState::execList
-	m_execState.execListInProg = true; 
+	if (prevCommand) {
+		B2BLog::Debug(LogFilt::LM_APP, "%s::ExecuteList: %s replaces loop",
+					  Name(), label);
+	}
+	if (preemptedCommand) {
+		B2BLog::Debug(LogFilt::LM_APP, "%s::ExecuteList: %s(%s) preempts",
+					  Name(), label,
+					  ExecuteListType::PriorityToString(priority));
+		// Tell Worker whether the entry it was executing was cut short.
+		// Worker waits for this before it lets our list run, so the
+		// PREEMPTED callback comes before anything the list does.
+		bool cut = WorkerInterrupt();
+		preemptedCommand->interruptState =
+								cut ? INTERRUPT_CUT : INTERRUPT_NOT_CUT;
+		m_stats.Count(ExecuteListStats::COUNTER_PREEMPTED);
+		if (cut)
+			m_stats.Count(ExecuteListStats::COUNTER_PREEMPTED_CUT);
+		preemptedCommand->CallDone(ExecuteListType::DONEREASON_PREEMPTED);
+	}
 
-	pthread_mutex_unlock(&m_execListLock);
+	// Hand to Worker.  If Worker never took the one before, it was
+	// replaced, stopped or preempted before it ran.
+	ExecCommandPtr *unclaimed =
+					m_pendingCommand.exchange(new ExecCommandPtr(newCommand));
+	WakeWorker();
+	if (unclaimed) {
+		// Preempted list is resumed from its start later
+		if (*unclaimed != preemptedCommand)
+			(*unclaimed)->Done(ExecuteListType::DONEREASON_STOP);
+		delete unclaimed;
+	}
 
-	if (pExecStateDoneCallback) {
+	if (prevClaimed) {
 		// Call cancelled looping list's callback.
-		// STOPPED: We don't call inside mutex lock to avoid deadlock.
-		// And don't access ExecState::pDoneCallback directly to avoid
-		// race conditions where someone may have called Start between
-		// this if-check and this line here.
-		// And BTW, Reset() sets ExecState::pDoneCallback to NULL
-		(*pExecStateDoneCallback)(ExecuteListType::DONEREASON_NEWSTART);
-	} // else: there was no cancelled looping list, or it had no callback
+		CallClaimedDone(*prevCommand, state,
+						ExecuteListType::DONEREASON_NEWSTART);
+	} // else: there was no cancelled looping list
 
 	return true; // SUCCESS
 }
 
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::QueueList(const char *label,
+					const ExecList &execList,
+					BuildExecListInternal &buildExecListInternal,
+					const ExecuteListType::DoneDelegate &doneCallback,
+					ExecuteListType::Priority priority)
+{
+	uint32_t state = m_state.load();
+	if (!(state & STATE_IN_PROG)) {
+		// Nothing to wait for
+		return ExecuteList(label, execList, buildExecListInternal, false,
+						   doneCallback, priority);
+	}
+
+	b2bassert((priority >= 0) && (priority < ExecuteListType::PRIORITY_TOTAL));
+	if ((priority < 0) || (priority >= ExecuteListType::PRIORITY_TOTAL)) {
+		B2BLog::Err(LogFilt::LM_APP, "%s(%d): bad priority %d",
+					label, (int)execList.size(), (int)priority);
+		return false; // FAIL
+	}
+	if (QueueCount(state) >= MAX_QUEUED_LISTS) {
+		B2BLog::Info(LogFilt::LM_APP, "%s(%d) ignored because %u lists are already queued.",
+			label, (int)execList.size(), (unsigned)MAX_QUEUED_LISTS);
+		m_stats.Count(ExecuteListStats::COUNTER_REJECTED);
+		return false; // FAIL
+	}
+
+	// Build now, while the list before it executes
+	boost::shared_ptr<ExecListInternal> newList(new ExecListInternal);
+	uint64_t buildNS = m_stats.Begin();
+	bool built = (buildExecListInternal)(execList, newList.get());
+	m_stats.End(ExecuteListStats::METRIC_BUILD, buildNS);
+	if (!built)
+		return false; // FAIL
+	// Gets its generation when it starts
+	ExecCommandPtr newCommand(new ExecCommand(0, newList, false,
+									doneCallback, priority, ExecCommandPtr(),
+									m_stats.Begin(), m_stats));
+
+	// Put in the slot after the last queued list, then count it in
+	// m_state.  Loops if Worker started a queued list under us.
+	state = m_state.load();
+	ReleaseStartedQueued(state);
+	for (;;) {
+		if (!(state & STATE_IN_PROG)) {
+			// Worker finished everything while we built our list
+			return StartList(label, execList.size(), newList, false,
+							 doneCallback, priority);
+		}
+		uint32_t count = QueueCount(state);
+		if (count >= MAX_QUEUED_LISTS) {
+			B2BLog::Info(LogFilt::LM_APP, "%s(%d) ignored because %u lists are already queued.",
+				label, (int)execList.size(), (unsigned)MAX_QUEUED_LISTS);
+			m_stats.Count(ExecuteListStats::COUNTER_REJECTED);
+			return false; // FAIL
+		}
+		uint32_t head = QueueHead(state);
+		ExecCommandPtr &slot = m_queue[QueueSlot(head + count)];
+		boost::atomic_store(&slot, newCommand);
+		if (m_state.compare_exchange_strong(state,
+					(state & ~STATE_QUEUE_MASK) | QueueState(head, count + 1)))
+			break; // SUCCESS
+		// Not queued, don't hold on to it
+		boost::atomic_store(&slot, ExecCommandPtr());
+	}
+
+	m_stats.Count(ExecuteListStats::COUNTER_LISTS);
+	B2BLog::Debug(LogFilt::LM_APP, "%s::QueueList: %s queued, %u waiting",
+				  Name(), label, (unsigned)QueueCount(state) + 1);
+
+	return true; // SUCCESS
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::ReleaseStartedQueued(
+															uint32_t state)
+{
+	// Slots before head were started by Worker (or dropped by
+	// StopExecuting).  QueueList only reuses a slot once it is released,
+	// so these are not queued again yet.
+	uint32_t head = QueueHead(state);
+	for (; QueueState(m_queueReleased, 0) != QueueState(head, 0);
+		 ++m_queueReleased)
+		boost::atomic_store(&m_queue[QueueSlot(m_queueReleased)],
+							ExecCommandPtr());
+}
+
 template <typename ENTRY, typename ENTRY_INTERNAL>
 bool ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::StopExecuting(
-								ExecuteListType::DoneReason reason, 
+								ExecuteListType::DoneReason reason,
 								bool executeCallback, bool logInfo)
 {
-	pthread_mutex_lock(&m_execListLock);
-	if (!m_execState.execListInProg) {
-		// We're not executing, exit immediately
-		pthread_mutex_unlock(&m_execListLock);
-		return true;
-	}
-	const ExecuteListType::DoneCallback *pDoneCallback = m_execState.pDoneCallback;
-	size_t size = m_execState.execList.size();
-	m_execState.Reset(); // Reset to empty and nothing running
-	pthread_mutex_unlock(&m_execListLock); 
+	// New generation with nothing in progress.  Worker sees its list is
+	// no longer current after the entry it is executing.
+	uint32_t state;
+	ExecCommandPtr command;
+	bool claimed;
+	for (;;) {
+		command = GetCurrentCommand(&state);
+		if (!command) {
+			// We're not executing, exit immediately
+			return true;
+		}
+		claimed = executeCallback && command->ClaimDone();
+		// Empty the queue too
+		if (m_state.compare_exchange_strong(state,
+					(NextGeneration(state) << STATE_GEN_SHIFT) |
+					QueueState(QueueHead(state) + QueueCount(state), 0)))
+			break; // SUCCESS
+
+		// Worker ended the list under us (and maybe resumed one it had
+		// preempted).  If we claimed a callback, Worker left calling it
+		// to us.
+		if (claimed)
+			CallClaimedDone(*command, state, reason);
+	}
+
+	WakeWorker(); // in case it has not picked up the list yet
+
+	size_t size = command->execList->size();
+
 	// Create informative reason information
 	std::string reasonString = ExecuteListType::DoneReasonToString(reason);
 	if (reason == ExecuteListType::DONEREASON_NEWSTART) {
@@ -251,8 +830,8 @@ bool ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::StopExecuting(
 		reasonString = std::string("STOP(") + ExecuteListType::DoneReasonToString(reason) + ")";
 	}
 	char buf[200+1];
-	snprintf(buf, 200, "%s::StopExecuting(%s): %s at %lu (execList.size=%u)", 
-				Name(), 
+	snprintf(buf, 200, "%s::StopExecuting(%s): %s at %lu (execList.size=%u)",
+				Name(),
 				ExecuteListType::DoneReasonToString(reason),
 				reasonString.c_str(),
 				(unsigned long)B2BTime::GetCurrentB2BTimestamp(),
@@ -262,73 +841,245 @@ bool ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::StopExecuting(
 	else
 		B2BLog::Debug(LogFilt::LM_APP, "%s", buf);
 
-	if (executeCallback && pDoneCallback) {
-		// STOPPED: We don't call inside mutex lock to avoid deadlock.
-		// And don't access ExecState::pDoneCallback directly to avoid
-		// race conditions where someone may have called Start between
-		// this if-check and this line here.
-		// And BTW, Reset() sets ExecState::pDoneCallback to NULL
-		(*pDoneCallback)(reason);
+	if (claimed) {
+		// Claimed above, so Worker won't call it
+		CallClaimedDone(*command, state, reason);
+	}
+
+	// Lists waiting to resume never will.  Worker only resumes one by
+	// changing m_state from the generation we just replaced, so they are
+	// ours now.
+	for (ExecCommandPtr preempted = command->preempted; preempted;
+		 preempted = preempted->preempted)
+	{
+		preempted->Done(executeCallback ? reason
+										: ExecuteListType::DONEREASON_STOP);
+	}
+	// Same for queued lists.  Worker only starts one by changing m_state.
+	uint32_t head = QueueHead(state);
+	for (uint32_t i = 0; i < QueueCount(state); ++i) {
+		ExecCommandPtr queued =
+						boost::atomic_load(&m_queue[QueueSlot(head + i)]);
+		if (queued) {
+			queued->Done(executeCallback ? reason
+										 : ExecuteListType::DONEREASON_STOP);
+		}
 	}
+	ReleaseStartedQueued(m_state.load());
 
 	return true;
 }
 
 template <typename ENTRY, typename ENTRY_INTERNAL>
-void *ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::Worker(void *arg)
+typename ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::ExecCommandPtr
+ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::GetCurrentCommand(
+												uint32_t *pState) const
 {
-	  // Make a copy to handle race conditions.  
-	  // We only use m_execState to look at execListInProg
-	  pthread_mutex_lock(&m_execListLock);
-      ExecState localExecState = m_execState;
+	for (;;) {
+		*pState = m_state.load();
+		if (!(*pState & STATE_IN_PROG))
+			return ExecCommandPtr(); // nothing in progress
 
-	  bool execCallback = false; // Assume we do not call callback
-	  // Assume we complete running the list normally
-	  ExecuteListType::DoneReason reason = ExecuteListType::DONEREASON_COMPLETE;
+		ExecCommandPtr command = boost::atomic_load(&m_currentCommand);
+		if (command && (command->generation == StateGeneration(*pState)))
+			return command;
+		// Worker resumed a list and has not stored it yet, only takes it
+		// a few instructions
+		sched_yield();
+	}
+}
 
-	  if (m_execState.execListInProg && !localExecState.execList.empty()) {
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::EndCommand(
+									ExecCommand &command,
+									ExecuteListType::DoneReason reason,
+									ExecCommandPtr *pNext)
+{
+	command.endReason = reason;	// before m_state, see CallClaimedDone
 
-		for (std::vector<uint8_t *>::size_type i = 0;
-			 i < localExecState.execList.size(); ++i)
-		{
-	  	  pthread_mutex_unlock(&m_execListLock);
-		  bool result = WorkerExecute(localExecState.execList[i]);
-	  	  pthread_mutex_lock(&m_execListLock);
-
-		  if (!result) {
-			// WorkerExecute returns false if we should stop executing
-			// Make sure this is false so we don't keep looping!
-	  	  	m_execState.execListInProg = false;
-	  	  	localExecState.loopExecList = false;
-			reason = ExecuteListType::DONEREASON_STOP;
-			break;
-		  }
+	const ExecCommandPtr &resume = command.preempted;
+	if (resume) {
+		// Before m_state, ExecuteList may preempt it again as soon as it
+		// is current
+		resume->interruptState = INTERRUPT_NONE;
+	}
+	uint32_t state = m_state.load();
+	ExecCommandPtr next;
+	for (;;) {
+		if (StateGeneration(state) != command.generation)
+			return false; // already stopped, replaced or preempted
 
-	  	  if (!m_execState.execListInProg) {
-			// We've been told to stop
-			// Make sure this is false so we don't keep looping!
-	  	  	localExecState.loopExecList = false; 
-			reason = ExecuteListType::DONEREASON_STOP;
-		  	break;
-		  }
+		uint32_t newState;
+		uint32_t nextGeneration = NextGeneration(state);
+		if (resume) {
+			next = resume;
+			next->generation = nextGeneration;
+			newState = InProgState(nextGeneration, *next, state);
+		} else if (QueueCount(state)) {
+			// Start first queued list
+			uint32_t head = QueueHead(state);
+			next = boost::atomic_load(&m_queue[QueueSlot(head)]);
+			if (!next) {
+				// state is old, QueueList released the slot
+				state = m_state.load();
+				continue;
+			}
+			next->generation = nextGeneration;
+			newState = InProgState(nextGeneration, *next,
+								   QueueState(head + 1, QueueCount(state) - 1));
+		} else {
+			next.reset();
+			newState = (command.generation << STATE_GEN_SHIFT) |
+					   (state & STATE_QUEUE_MASK);
 		}
+		if (m_state.compare_exchange_weak(state, newState))
+			break; // SUCCESS
+		// else: state reloaded by compare_exchange_weak, try again
+	}
 
-		if (!localExecState.loopExecList) {
-			// FINISHED: Done playing list, delete and re-init state
-			m_execState.Reset();
-			execCallback = true;
+	if (next) {
+		boost::atomic_store(&m_currentCommand, next);
+		if (resume) {
+			B2BLog::Debug(LogFilt::LM_APP, "%s: resume %s list at entry %u",
+				Name(), ExecuteListType::PriorityToString(resume->priority),
+				(unsigned)resume->resumePos);
+		}
+	}
+	*pNext = next;
 
-		} // Skip the "FINISHED" logic, looping and executing the list again
-	  }
+	return true; // SUCCESS
+}
 
-	  pthread_mutex_unlock(&m_execListLock);
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::SavePreempted(
+								ExecCommand &command,
+								typename ExecListInternal::size_type nextPos,
+								bool ranEntry)
+{
+	// Wait for ExecuteList to tell us what WorkerInterrupt did
+	int interruptState;
+	while ((interruptState = command.interruptState.load()) ==
+														INTERRUPT_PENDING)
+		sched_yield();
 
-	  if (execCallback && localExecState.pDoneCallback) {
-				(*localExecState.pDoneCallback)(reason);
-	  }
+	command.resumePos = nextPos;
+	if (ranEntry && (interruptState == INTERRUPT_CUT))
+		--command.resumePos; // execute cut entry again
+	if (command.loopExecList && (command.resumePos >= command.execList->size()))
+		command.resumePos = 0; // finished a pass, resume at next one
+	// else: a finished list resumes at its end, and completes then
+}
 
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::CallClaimedDone(
+									ExecCommand &command,
+									uint32_t replacedState,
+									ExecuteListType::DoneReason reason)
+{
+	if ((replacedState & STATE_IN_PROG) &&
+		(StateGeneration(replacedState) == command.generation))
+	{
+		command.CallDone(reason); // we stopped it
+	} else {
+		// Worker ended it between our claim and our change to m_state
+		command.CallDone(
+				static_cast<ExecuteListType::DoneReason>(command.endReason.load()));
+	}
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void *ExecuteListInThread<ENTRY, ENTRY_INTERNAL>::Worker(void *arg)
+{
+	// Pick up newest list, if any
+	ExecCommandPtr *pending = m_pendingCommand.exchange(NULL);
+	if (pending) {
+		if (m_workerCommand && (m_workerCommand != *pending) &&
+			!m_workerCommand->IsPreempted())
+		{
+			// Loop we were running was replaced (NEWSTART already called)
+			m_workerCommand->Done(ExecuteListType::DONEREASON_STOP);
+		} // else: preempted loop resumes from its next pass
+		m_workerCommand = *pending;
+		delete pending;
+	}
 
-	WorkerYield(); // give up control and let other threads run
+	if (m_workerCommand) {
+		ExecCommand &command = *m_workerCommand;
+		const ExecListInternal &execList = *command.execList;
+		typename ExecListInternal::size_type pos = command.resumePos;
+		command.resumePos = 0;
+		bool ranEntry = false;	// we executed entry before pos
+		bool stopped = false;	// WorkerExecute said to stop
+
+		for (; (pos < execList.size()) && IsCurrent(command); ++pos) {
+			ranEntry = true;
+			uint64_t beginNS = m_stats.Begin();
+			if (beginNS) {
+				if (!command.started && command.enqueueNS) {
+					m_stats.Record(ExecuteListStats::METRIC_START_LATENCY,
+								   beginNS - command.enqueueNS);
+				}
+				if (m_lastEntryEndNS) {
+					m_stats.Record(ExecuteListStats::METRIC_GAP,
+								   beginNS - m_lastEntryEndNS);
+				}
+			}
+			command.started = true;
+			bool keepExecuting = WorkerExecute(execList[pos]);
+			if (beginNS) {
+				m_lastEntryEndNS = B2BTime::GetCurrTimeMonotonicNS();
+				m_stats.Record(ExecuteListStats::METRIC_EXECUTE,
+							   m_lastEntryEndNS - beginNS);
+			} else {
+				m_lastEntryEndNS = 0;
+			}
+			if (!keepExecuting) {
+				// WorkerExecute returns false if we should stop executing
+				++pos;
+				stopped = true;
+				break;
+			}
+		}
+
+		ExecuteListType::DoneReason reason = stopped ?
+									ExecuteListType::DONEREASON_STOP :
+									ExecuteListType::DONEREASON_COMPLETE;
+		if (!stopped && (pos == execList.size()) && command.loopExecList) {
+			uint32_t state = m_state.load();
+			if (QueueCount(state)) {
+				// Make way for queued list
+				reason = ExecuteListType::DONEREASON_NEWSTART;
+			} else if (StateGeneration(state) == command.generation) {
+				// keep m_workerCommand, looping and executing it again
+				WorkerYield(); // give up control and let other threads run
+				return NULL;
+			}
+		}
+
+		// FINISHED: Done playing list, unless it is no longer current
+		ExecCommandPtr next;
+		if (!EndCommand(command, reason, &next)) {
+			if (command.IsPreempted()) {
+				// ExecuteList holds it until it resumes.  Don't yield, the
+				// preempting list should start now.
+				SavePreempted(command, pos, ranEntry);
+				m_workerCommand.reset();
+				return NULL;
+			}
+			// Stopped or replaced
+			reason = ExecuteListType::DONEREASON_STOP;
+		}
+		command.Done(reason);
+		m_workerCommand = next; // resumed or queued list, if any
+
+		if (!m_workerCommand)
+			WorkerYield(); // give up control and let other threads run
+		// else: go straight to next list
+	} else {
+		// Nothing to do, sleep until ExecuteList or StopExecuting
+		m_lastEntryEndNS = 0; // waiting is not a gap
+		WaitForWork();
+	}
 
 	return NULL;
 }
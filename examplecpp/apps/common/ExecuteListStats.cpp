@@ -0,0 +1,153 @@
+#include "common/b2bassert.h"
+#include "log/B2BLog.h"
+
+#include "ExecuteListStats.h"
+
+ExecuteListStats::ExecuteListStats() :
+	m_enabled(false)
+{
+	Reset();
+}
+
+/*static*/ uint32_t ExecuteListStats::Bucket(uint64_t durationNS)
+{
+	uint64_t us = durationNS / 1000;
+	uint32_t bucket = 0;
+	while (us && (bucket < NUM_BUCKETS-1)) {
+		us >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+void ExecuteListStats::Record(Metric metric, uint64_t durationNS)
+{
+	b2bassert((metric >= 0) && (metric < METRIC_TOTAL));
+
+	AtomicHistogram &histogram = m_histograms[metric];
+	histogram.count.fetch_add(1, boost::memory_order_relaxed);
+	histogram.sumNS.fetch_add(durationNS, boost::memory_order_relaxed);
+	histogram.buckets[Bucket(durationNS)].fetch_add(1,
+											boost::memory_order_relaxed);
+	uint64_t maxNS = histogram.maxNS.load(boost::memory_order_relaxed);
+	while ((durationNS > maxNS) &&
+		   !histogram.maxNS.compare_exchange_weak(maxNS, durationNS,
+											boost::memory_order_relaxed))
+		; // maxNS reloaded, try again
+}
+
+void ExecuteListStats::GetSnapshot(Snapshot *pSnapshot) const
+{
+	b2bassert(pSnapshot);
+
+	for (int m = 0; m < METRIC_TOTAL; ++m) {
+		const AtomicHistogram &from = m_histograms[m];
+		Histogram &to = pSnapshot->histograms[m];
+		to.count = from.count.load(boost::memory_order_relaxed);
+		to.sumNS = from.sumNS.load(boost::memory_order_relaxed);
+		to.maxNS = from.maxNS.load(boost::memory_order_relaxed);
+		for (uint32_t b = 0; b < NUM_BUCKETS; ++b)
+			to.buckets[b] = from.buckets[b].load(boost::memory_order_relaxed);
+	}
+	for (int c = 0; c < COUNTER_TOTAL; ++c)
+		pSnapshot->counters[c] = m_counters[c].load(boost::memory_order_relaxed);
+}
+
+void ExecuteListStats::Reset()
+{
+	for (int m = 0; m < METRIC_TOTAL; ++m) {
+		AtomicHistogram &histogram = m_histograms[m];
+		histogram.count.store(0);
+		histogram.sumNS.store(0);
+		histogram.maxNS.store(0);
+		for (uint32_t b = 0; b < NUM_BUCKETS; ++b)
+			histogram.buckets[b].store(0);
+	}
+	for (int c = 0; c < COUNTER_TOTAL; ++c)
+		m_counters[c].store(0);
+}
+
+double ExecuteListStats::Histogram::AverageUS() const
+{
+	return count ? (sumNS / 1000.0) / count : 0.0;
+}
+
+uint64_t ExecuteListStats::Histogram::PercentileUS(double pct) const
+{
+	if (!count)
+		return 0;
+
+	// Sample number pct falls on, counting from 1
+	uint64_t target = (uint64_t)((pct / 100.0) * count + 0.5);
+	if (target < 1)
+		target = 1;
+	uint64_t seen = 0;
+	for (uint32_t b = 0; b < NUM_BUCKETS-1; ++b) {
+		seen += buckets[b];
+		if (seen >= target)
+			return (uint64_t)1 << b;	// upper bound of bucket b
+	}
+	// Last bucket has no upper bound, max is the best we have
+	return maxNS / 1000;
+}
+
+void ExecuteListStats::Log(const char *name) const
+{
+	Snapshot snapshot;
+	GetSnapshot(&snapshot);
+
+	for (int m = 0; m < METRIC_TOTAL; ++m) {
+		const Histogram &histogram = snapshot.histograms[m];
+		B2BLog::Info(LogFilt::LM_APP,
+			"%s: %-13s n=%llu avg=%.1fus p50<%lluus p99<%lluus max=%.1fus",
+			name, MetricToString((Metric)m),
+			(unsigned long long)histogram.count, histogram.AverageUS(),
+			(unsigned long long)histogram.PercentileUS(50),
+			(unsigned long long)histogram.PercentileUS(99),
+			histogram.maxNS / 1000.0);
+	}
+	B2BLog::Info(LogFilt::LM_APP,
+				 "%s: %s=%llu %s=%llu %s=%llu %s=%llu", name,
+				 CounterToString(COUNTER_LISTS),
+				 (unsigned long long)snapshot.counters[COUNTER_LISTS],
+				 CounterToString(COUNTER_REJECTED),
+				 (unsigned long long)snapshot.counters[COUNTER_REJECTED],
+				 CounterToString(COUNTER_PREEMPTED),
+				 (unsigned long long)snapshot.counters[COUNTER_PREEMPTED],
+				 CounterToString(COUNTER_PREEMPTED_CUT),
+				 (unsigned long long)snapshot.counters[COUNTER_PREEMPTED_CUT]);
+}
+
+/*static*/ const char *ExecuteListStats::MetricToString(Metric metric)
+{
+	switch (metric) {
+	  case METRIC_BUILD:
+		return "BUILD";
+	  case METRIC_START_LATENCY:
+		return "START_LATENCY";
+	  case METRIC_EXECUTE:
+		return "EXECUTE";
+	  case METRIC_GAP:
+		return "GAP";
+	  case METRIC_CALLBACK:
+		return "CALLBACK";
+	  default:
+		return "BADVALUE";
+	}
+}
+
+/*static*/ const char *ExecuteListStats::CounterToString(Counter counter)
+{
+	switch (counter) {
+	  case COUNTER_LISTS:
+		return "LISTS";
+	  case COUNTER_REJECTED:
+		return "REJECTED";
+	  case COUNTER_PREEMPTED:
+		return "PREEMPTED";
+	  case COUNTER_PREEMPTED_CUT:
+		return "PREEMPTED_CUT";
+	  default:
+		return "BADVALUE";
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+//
+// ExecuteListStats: timing histograms and counters for ExecuteListInThread.
+//		Off by default.  When off, each place that records costs one
+//		relaxed atomic load and no clock read.  When on, recording takes
+//		no lock and does no allocation, so it is safe from any thread.
+//
+//		Histogram buckets are powers of two in microseconds, so
+//		percentiles are rough (within 2x) but cheap to keep.
+//
+#include <stdint.h>
+
+#include "boost/atomic.hpp"
+
+#include "common/B2BTime.h"
+
+class ExecuteListStats {
+  public:
+	// What we time
+	// BUILD: BuildExecListInternal call
+	// START_LATENCY: list handed to our thread (after BUILD) until its
+	//		first entry starts.  Includes waiting behind an executing or
+	//		queued list.
+	// EXECUTE: one WorkerExecute call
+	// GAP: end of one WorkerExecute to start of the next, when our thread
+	//		had a list the whole time (time waiting for ExecuteList is not
+	//		a gap)
+	// CALLBACK: one pDoneCallback call
+	typedef enum {
+		METRIC_BUILD = 0,
+		METRIC_START_LATENCY,
+		METRIC_EXECUTE,
+		METRIC_GAP,
+		METRIC_CALLBACK,
+		METRIC_TOTAL	// size of enum (never used as a valid value)
+	} Metric;
+
+	// What we count
+	// LISTS: lists accepted by ExecuteList or QueueList
+	// REJECTED: lists refused because busy or queue full
+	// PREEMPTED: lists preempted by a higher priority list
+	// PREEMPTED_CUT: of those, ones whose entry WorkerInterrupt cut short
+	typedef enum {
+		COUNTER_LISTS = 0,
+		COUNTER_REJECTED,
+		COUNTER_PREEMPTED,
+		COUNTER_PREEMPTED_CUT,
+		COUNTER_TOTAL	// size of enum (never used as a valid value)
+	} Counter;
+
+	// Bucket 0 is under 1 us, bucket i is [2^(i-1), 2^i) us, last bucket
+	// is everything longer
+	static const uint32_t NUM_BUCKETS = 32;
+
+	struct Histogram {
+		uint64_t count;
+		uint64_t sumNS;
+		uint64_t maxNS;
+		uint64_t buckets[NUM_BUCKETS];
+
+		// RETURNS: average in microseconds, 0 if count is 0
+		double AverageUS() const;
+		// RETURNS: upper bound, in microseconds, of the bucket holding
+		//		percentile pct (0 to 100).  0 if count is 0.
+		uint64_t PercentileUS(double pct) const;
+	};
+
+	struct Snapshot {
+		Histogram histograms[METRIC_TOTAL];
+		uint64_t counters[COUNTER_TOTAL];
+	};
+
+	ExecuteListStats();
+
+	// Turn recording on or off.  Default is off.
+	void SetEnabled(bool enabled) { m_enabled.store(enabled); }
+	bool IsEnabled() const
+		{ return m_enabled.load(boost::memory_order_relaxed); }
+
+	// Start timing.
+	// RETURNS: time now in nanoseconds, or 0 if not enabled
+	uint64_t Begin() const
+		{ return IsEnabled() ? B2BTime::GetCurrTimeMonotonicNS() : 0; }
+	// Record time since beginNS, from Begin.  Nothing if beginNS is 0.
+	void End(Metric metric, uint64_t beginNS)
+	{
+		if (beginNS)
+			Record(metric, B2BTime::GetCurrTimeMonotonicNS() - beginNS);
+	}
+	// Record a time measured some other way
+	void Record(Metric metric, uint64_t durationNS);
+	void Count(Counter counter)
+	{
+		if (IsEnabled())
+			m_counters[counter].fetch_add(1, boost::memory_order_relaxed);
+	}
+
+	// Copy what was recorded since ctor or Reset.  Taken while recording
+	// may go on, so a histogram's fields may be off by the samples
+	// recorded during the copy.
+	void GetSnapshot(Snapshot *pSnapshot) const;
+	void Reset();
+
+	// B2BLog::Info a summary line per metric and the counters
+	// name: to start each line with (module name say)
+	void Log(const char *name) const;
+
+	static const char *MetricToString(Metric metric);
+	static const char *CounterToString(Counter counter);
+
+  private:
+	struct AtomicHistogram {
+		boost::atomic<uint64_t> count;
+		boost::atomic<uint64_t> sumNS;
+		boost::atomic<uint64_t> maxNS;
+		boost::atomic<uint64_t> buckets[NUM_BUCKETS];
+	};
+
+	static uint32_t Bucket(uint64_t durationNS);
+
+	boost::atomic<bool> m_enabled;
+	AtomicHistogram m_histograms[METRIC_TOTAL];
+	boost::atomic<uint64_t> m_counters[COUNTER_TOTAL];
+};
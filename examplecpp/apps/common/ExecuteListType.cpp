@@ -9,6 +9,22 @@ const char *ExecuteListType::DoneReasonToString(DoneReason reason)
 		return "STOP";
 	  case DONEREASON_NEWSTART:
 		return "NEWSTART";
+	  case DONEREASON_PREEMPTED:
+		return "PREEMPTED";
+	  default:
+		return "BADVALUE";
+	}
+}
+
+const char *ExecuteListType::PriorityToString(Priority priority) 
+{
+	switch (priority) {
+	  case PRIORITY_BACKGROUND:
+		return "BACKGROUND";
+	  case PRIORITY_NORMAL:
+		return "NORMAL";
+	  case PRIORITY_URGENT:
+		return "URGENT";
 	  default:
 		return "BADVALUE";
 	}
@@ -4,22 +4,49 @@
 //
 #include "boost/function.hpp"
 
+#include "common/Delegate.h"
+
 namespace ExecuteListType {
 	// Reason why any actuator request has been declared "DONE".
 	// COMPLETE: We finished because we completed the request.
 	// STOP: Done because of a Stop call
 	// NEWSTART: Done because a new Start() was called.  Therefore this actuator
 	//		request is terminated in order to start the new actuator request.
+	// PREEMPTED: NOT done.  A higher priority request interrupted this one.
+	//		It is resumed where it left off after that request, and the
+	//		callback is called again with one of the other reasons.
 	typedef enum {
 		DONEREASON_COMPLETE = 0,
 		DONEREASON_STOP,
 		DONEREASON_NEWSTART,
+		DONEREASON_PREEMPTED,
 		DONEREASON_TOTAL	// size of enum (never used as a valid value)
 	} DoneReason;
 
+	// Priority of an actuator request.  A request interrupts one of lower
+	// priority and is refused by one of higher priority.
+	// BACKGROUND: idle animations and the like
+	// NORMAL: everything else
+	// URGENT: feedback that must not wait (an announcement say)
+	typedef enum {
+		PRIORITY_BACKGROUND = 0,
+		PRIORITY_NORMAL,
+		PRIORITY_URGENT,
+		PRIORITY_TOTAL	// size of enum (never used as a valid value)
+	} Priority;
+
 	// Type for our "Done" callbacks.
 	// RETURNS: true on success, false otherwise.
 	typedef boost::function<bool (DoneReason)> DoneCallback;
+	// Same, without heap or boost::function indirection (see Delegate).
+	// Copied, so caller needn't keep it alive like a DoneCallback pointer.
+	typedef Delegate<bool (DoneReason)> DoneDelegate;
+
+	// RETURNS: DoneDelegate that calls *pDoneCallback (which caller must
+	//		keep alive), empty if pDoneCallback is NULL
+	inline DoneDelegate ToDoneDelegate(const DoneCallback *pDoneCallback)
+		{ return DoneDelegate::FromPointer(pDoneCallback); }
 
 	const char *DoneReasonToString(DoneReason reason);
+	const char *PriorityToString(Priority priority);
 }
@@ -11,29 +11,55 @@
 //			GPIO1_5 is port 37
 //			GPIO3_31 is port 127
 //
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
 #include "boost/property_tree/json_parser.hpp"
 
 #include "common/b2bassert.h"
 #include "common/B2BTime.h"
+#include "common/FileUtil.h"
+#include "common/JSONStreamParser.h"
 #include "common/StringUtil.h"
 #include "common/JSONUtil.h"
 
 #include "log/B2BLog.h"
 
 #include "IOConfig.h"
+#include "IOConfigCache.h"
+#include "LifecycleTracer.h"
+
 
+/*static*/ const char * const IOConfig::SettingTypeString[IOConfig::SETTINGTYPE_TOTAL] =
+{
+	"BOOL",
+	"INT",
+	"DOUBLE",
+	"STRING",
+	"NUMARRAY"
+};
 
 IOConfig::IOConfig(const char *ioConfigFileNameFullPath) :
-	B2BModule("IOConfig")
+	B2BModule("IOConfig"),
+	m_loaded(false)
 {
 	b2bassert(ioConfigFileNameFullPath);
 
 	std::string err;
-	if (IOConfigFileParse(ioConfigFileNameFullPath, &err)) {
+	bool parsed;
+	{
+		LifecycleTracer::Span span("Parse", Name());
+		parsed = IOConfigFileParse(ioConfigFileNameFullPath, &err);
+	}
+	if (parsed) {
+		m_loaded = true;
 		// successful read
 		B2BLog::Debug(LogFilt::LM_APP, 
 				"IOConfig file %s: parse SUCCESS %d entries",
-				ioConfigFileNameFullPath, m_ioEntries.size());
+				ioConfigFileNameFullPath, m_tables.entries.size());
 
 	} else {
 		B2BLog::Err(LogFilt::LM_APP, 
@@ -43,19 +69,311 @@ IOConfig::IOConfig(const char *ioConfigFileNameFullPath) :
 	} 
 }
 
-void IOConfig::ParseJSON(const char *parentNodeName, const pt::ptree &node)
+// Json value text to number, using json number syntax only
+// RETURNS: true if all of text is a number of that kind, false otherwise
+static bool TextToInt(const std::string &text, int64_t *pValue)
+{
+	// json integer: -?[0-9]+
+	const char *pos = text.c_str();
+	if (*pos == '-')
+		++pos;
+	if (*pos == '\0')
+		return false; // FAIL: no digits
+	for (; *pos; ++pos) {
+		if ((*pos < '0') || (*pos > '9'))
+			return false; // FAIL: not an integer
+	}
+
+	errno = 0;
+	long long value = strtoll(text.c_str(), NULL, 10);
+	if (errno == ERANGE)
+		return false; // FAIL: does not fit, caller will use double
+	*pValue = value;
+	return true; // SUCCESS
+}
+
+static bool TextToDouble(const std::string &text, double *pValue)
+{
+	// Only json number characters, so strtod does not accept things like
+	// "inf", "nan" or hex that json does not have
+	if (text.empty() ||
+		(text.find_first_not_of("0123456789+-.eE") != std::string::npos))
+	{
+		return false; // FAIL: not a number
+	}
+
+	char *end;
+	double value = strtod(text.c_str(), &end);
+	if (*end != '\0')
+		return false; // FAIL: not all of text is a number
+	*pValue = value;
+	return true; // SUCCESS
+}
+
+/*static*/ void IOConfig::ParseJSONLeaf(IOConfigEntry *pEntry,
+						ExtraSettings *pSettings,
+						const std::string &label, const std::string &value)
+{
+	IOConfigEntry &entry = *pEntry;
+	const char *dataString = value.c_str();
+	if (label == "GPIO") {
+		entry.ioType = IOTYPE_GPIO;
+		entry.portNum = strtol(dataString, NULL, 10); // GPIO port
+	} 
+	else if (label == "PWM") {
+		entry.ioType = IOTYPE_PWM;
+		entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
+	} else if (label == "I2C") {
+		entry.ioType = IOTYPE_I2C;
+		entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
+		entry.direction = IODIR_OUTPUT;
+	} else if (label == "SPI") {
+		entry.ioType = IOTYPE_SPI;
+		entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
+		entry.direction = IODIR_OUTPUT;
+	} else if (label == "COUNTER") {
+		entry.ioType = IOTYPE_COUNTER;
+		entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
+	} else if (label == "ANALOG") {
+		entry.ioType = IOTYPE_ANALOG;
+		entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
+	} else if (label == "enable") {
+		entry.enable = StringUtil::StringToBool(value);
+	} else if (label == "dir") {
+		if (value == "input") {
+			entry.direction = IODIR_INPUT;
+		} else if (value == "output") {
+			entry.direction = IODIR_OUTPUT;
+		}
+	} else if (label == "polarity") {
+		if ((value == "active_high") || (value == "high")) {
+			entry.polarity = IOPOLARITY_HIGH; // active HIGH
+		} else if ((value == "active_low") || (value == "low")) {
+			entry.polarity = IOPOLARITY_LOW; // active LOW
+		}
+	} else if (label == "lowThreshold") {
+		// ANALOG
+		entry.thresholds.threshValues[B2BLogic::LEVEL_LOW] = 
+											strtof(dataString, NULL);
+	} else if (label == "mediumThreshold") {
+		// ANALOG
+		entry.thresholds.threshValues[B2BLogic::LEVEL_MEDIUM] =
+											strtof(dataString, NULL);
+	} else if (label == "highThreshold") {
+		// ANALOG
+		entry.thresholds.threshValues[B2BLogic::LEVEL_HIGH] =
+											strtof(dataString, NULL);
+	} else if (label == "_comment") {
+		// skip comments
+	} else {
+		if (entry.ioType == IOTYPE_TOTAL) {
+			// Unknown node name and haven't chosen IOType yet
+			// This is the wildcard type, which we label as GENERAL
+			entry.ioType = IOTYPE_GENERAL;
+			// any integer goes here
+			entry.portNum = strtol(dataString, NULL, 10);  
+		} else {
+			// Unknown node name and IOType already chosen
+			// Add to IOType's extraSettings
+			ParsedSetting setting;
+			if (TextToInt(value, &setting.intValue)) {
+				setting.type = SETTINGTYPE_INT;
+			} else if (TextToDouble(value, &setting.doubleValue)) {
+				setting.type = SETTINGTYPE_DOUBLE;
+			} else if ((value == "true") || (value == "false")) {
+				setting.type = SETTINGTYPE_BOOL;
+				setting.intValue = StringUtil::StringToBool(value);
+			} else {
+				setting.type = SETTINGTYPE_STRING;
+				setting.stringValue = value;
+			}
+			pSettings->insert(
+				std::pair<std::string, ParsedSetting>(label, setting));
+		}
+	} 
+}
+
+/*static*/ void IOConfig::ParseJSONNumArray(ExtraSettings *pSettings,
+					const std::string &label, std::vector<double> *pNumbers)
+{
+	std::pair<ExtraSettings::iterator, bool> result = pSettings->insert(
+			std::pair<std::string, ParsedSetting>(label, ParsedSetting()));
+	if (result.second) {
+		ParsedSetting &setting = result.first->second;
+		setting.type = SETTINGTYPE_NUMARRAY;
+		setting.numbers.swap(*pNumbers);
+	} // else: first definition wins
+}
+
+void IOConfig::Tables::swap(Tables &other)
+{
+	entries.swap(other.entries);
+	entriesByName.swap(other.entriesByName);
+	labels.swap(other.labels);
+	labelsByName.swap(other.labelsByName);
+	settings.swap(other.settings);
+	stringValues.swap(other.stringValues);
+	numbers.swap(other.numbers);
+}
+
+// Collects parsed entries into Tables, interning names and labels
+class IOConfig::TableBuilder {
+  public:
+	// Add entry if it is valid and its name is not already added (first
+	// definition wins).  Entry and settings contents are moved, not
+	// copied, so they are left in an unspecified state.
+	void AddEntry(IOConfigEntry *pEntry, ExtraSettings *pSettings)
+	{
+		if (!pEntry->IsValid())
+			return; // nothing to add
+
+		//B2BLog::Debug(LogFilt::LM_APP, "IOConfig insert %s", 
+		//								pEntry->ioName.c_str());
+
+		IOHandle ioHandle = m_tables.entries.size();
+		if (!m_names.insert(std::pair<IOName, IOHandle>(pEntry->ioName,
+														ioHandle)).second)
+		{
+			return; // already have an entry with this name
+		}
+
+		m_tables.entries.push_back(IOConfigEntry());
+		IOConfigEntry &newEntry = m_tables.entries.back();
+		newEntry.ioName.swap(pEntry->ioName);
+		newEntry.ioType = pEntry->ioType;
+		newEntry.enable = pEntry->enable;
+		newEntry.portNum = pEntry->portNum;
+		newEntry.direction = pEntry->direction;
+		newEntry.polarity = pEntry->polarity;
+		newEntry.thresholds = pEntry->thresholds;
+		newEntry.firstSetting = m_tables.settings.size();
+		newEntry.numSettings = pSettings->size();
+
+		for (ExtraSettings::iterator iter = pSettings->begin();
+			 iter != pSettings->end(); ++iter)
+		{
+			const ParsedSetting &parsed = iter->second;
+			ExtraSetting setting;
+			memset(&setting, 0, sizeof(setting));
+			setting.label = InternLabel(iter->first);
+			setting.type = parsed.type;
+			switch (parsed.type) {
+			  case SETTINGTYPE_BOOL:
+				setting.u.boolValue = (parsed.intValue != 0);
+				break;
+			  case SETTINGTYPE_INT:
+				setting.u.intValue = parsed.intValue;
+				break;
+			  case SETTINGTYPE_DOUBLE:
+				setting.u.doubleValue = parsed.doubleValue;
+				break;
+			  case SETTINGTYPE_STRING:
+				// NUL terminated so readers can have a const char *
+				setting.u.ref.offset = m_tables.stringValues.size();
+				setting.u.ref.length = parsed.stringValue.length();
+				m_tables.stringValues.append(parsed.stringValue);
+				m_tables.stringValues.push_back('\0');
+				break;
+			  case SETTINGTYPE_NUMARRAY:
+				setting.u.ref.offset = m_tables.numbers.size();
+				setting.u.ref.length = parsed.numbers.size();
+				m_tables.numbers.insert(m_tables.numbers.end(),
+								parsed.numbers.begin(), parsed.numbers.end());
+				break;
+			  default:
+				b2bassert(false); // parser always sets type
+				break;
+			}
+			m_tables.settings.push_back(setting);
+		}
+		std::sort(m_tables.settings.begin() + newEntry.firstSetting,
+				  m_tables.settings.end(), SettingLess);
+	}
+
+	// Move built tables to pTables.  Builder is empty afterwards.
+	void Finish(Tables *pTables)
+	{
+		// Our maps are already sorted by name
+		m_tables.entriesByName.reserve(m_names.size());
+		for (std::map<IOName, IOHandle>::const_iterator iter =
+			 m_names.begin(); iter != m_names.end(); ++iter)
+		{
+			m_tables.entriesByName.push_back(iter->second);
+		}
+		m_tables.labelsByName.reserve(m_labels.size());
+		for (std::map<std::string, LabelHandle>::const_iterator iter =
+			 m_labels.begin(); iter != m_labels.end(); ++iter)
+		{
+			m_tables.labelsByName.push_back(iter->second);
+		}
+
+		pTables->swap(m_tables);
+		m_tables = Tables();
+		m_names.clear();
+		m_labels.clear();
+	}
+
+  private:
+	LabelHandle InternLabel(const std::string &label)
+	{
+		std::pair<std::map<std::string, LabelHandle>::iterator, bool> result =
+			m_labels.insert(std::pair<std::string, LabelHandle>(label,
+												m_tables.labels.size()));
+		if (result.second)
+			m_tables.labels.push_back(label);
+		return result.first->second;
+	}
+
+	static bool SettingLess(const ExtraSetting &a, const ExtraSetting &b)
+	{
+		return a.label < b.label;
+	}
+
+	Tables m_tables;
+	std::map<IOName, IOHandle> m_names;			// parse time only
+	std::map<std::string, LabelHandle> m_labels;	// parse time only
+};
+
+// RETURNS: true if node is a json array (every child has an empty key)
+//		whose values are all numbers, false otherwise.
+//		pNumbers is filled with the values if true.
+static bool IsNumArray(const pt::ptree &node, std::vector<double> *pNumbers)
+{
+	for (pt::ptree::const_iterator pos = node.begin(); pos != node.end();
+		 ++pos)
+	{
+		double value;
+		if (!pos->first.empty() || !pos->second.empty() ||
+			!TextToDouble(pos->second.data(), &value))
+		{
+			return false; // not an array of numbers
+		}
+		pNumbers->push_back(value);
+	}
+	return true;
+}
+
+void IOConfig::ParseJSON(TableBuilder *pBuilder, const char *parentNodeName,
+						 const pt::ptree &node)
 {
 	IOConfigEntry entry;
+	ExtraSettings settings;
+	if (parentNodeName)
+		entry.ioName = parentNodeName;
     for (pt::ptree::const_iterator pos = node.begin(); pos != node.end();) {
 
-	  // Get the node name as a string
-      std::string node_name = pos->first;
-
 	  // recursively call ourselves to dig deeper into the tree
-      if (!pos->second.empty()) {
+      std::vector<double> numbers;
+      if (!pos->second.empty() && (parentNodeName != NULL) &&
+		  IsNumArray(pos->second, &numbers))
+	  {
+		// json array of numbers, belongs to this entry
+		ParseJSONNumArray(&settings, pos->first, &numbers);
+
+      } else if (!pos->second.empty()) {
 
   		// recurse into node
-        ParseJSON(node_name.c_str(), pos->second);
+        ParseJSON(pBuilder, pos->first.c_str(), pos->second);
 
       } else {
 	  	// node has no children, must be data
@@ -63,113 +381,153 @@ void IOConfig::ParseJSON(const char *parentNodeName, const pt::ptree &node)
 		if (parentNodeName == NULL) {
 			// Parent is json root, do nothing
 		} else {
-			entry.ioName = parentNodeName;
-			const char *dataString = pos->second.data().c_str();
-        	if (node_name == "GPIO") {
-			  	entry.ioType = IOTYPE_GPIO;
-				entry.portNum = strtol(dataString, NULL, 10); // GPIO port
-        	} 
-			else if (node_name == "PWM") {
-			  	entry.ioType = IOTYPE_PWM;
-				entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
-        	} else if (node_name == "I2C") {
-			  	entry.ioType = IOTYPE_I2C;
-				entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
-				entry.direction = IODIR_OUTPUT;
-        	} else if (node_name == "SPI") {
-			  	entry.ioType = IOTYPE_SPI;
-				entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
-				entry.direction = IODIR_OUTPUT;
-        	} else if (node_name == "COUNTER") {
-			  	entry.ioType = IOTYPE_COUNTER;
-				entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
-        	} else if (node_name == "ANALOG") {
-			  	entry.ioType = IOTYPE_ANALOG;
-				entry.portNum = strtol(dataString, NULL, 10);  // GPIO port
-        	} else if (node_name == "enable") {
-			  	entry.enable = StringUtil::StringToBool(pos->second.data());
-			} else if (node_name == "dir") {
-				std::string tempStr = pos->second.data();
-				if (tempStr == "input") {
-					entry.direction = IODIR_INPUT;
-				} else if (tempStr == "output") {
-					entry.direction = IODIR_OUTPUT;
-				}
-        	} else if (node_name == "polarity") {
-				std::string tempStr = pos->second.data();
-				if ((tempStr == "active_high") || (tempStr == "high")) {
-					entry.polarity = IOPOLARITY_HIGH; // active HIGH
-				} else if ((tempStr == "active_low") || (tempStr == "low")) {
-					entry.polarity = IOPOLARITY_LOW; // active LOW
-				}
-			} else if (node_name == "lowThreshold") {
-				// ANALOG
-				entry.thresholds.threshValues[B2BLogic::LEVEL_LOW] = 
-													strtof(dataString, NULL);
-			} else if (node_name == "mediumThreshold") {
-				// ANALOG
-				entry.thresholds.threshValues[B2BLogic::LEVEL_MEDIUM] =
-													strtof(dataString, NULL);
-			} else if (node_name == "highThreshold") {
-				// ANALOG
-				entry.thresholds.threshValues[B2BLogic::LEVEL_HIGH] =
-													strtof(dataString, NULL);
-        	} else if (node_name == "_comment") {
-				// skip comments
-        	} else {
-				if (entry.ioType == IOTYPE_TOTAL) {
-					// Unknown node name and haven't chosen IOType yet
-					// This is the wildcard type, which we label as GENERAL
-			  		entry.ioType = IOTYPE_GENERAL;
-					// any integer goes here
-					entry.portNum = strtol(dataString, NULL, 10);  
-				} else {
-					// Unknown node name and IOType already chosen
-					// Add to IOType's extraSettings std::map
-					int32_t intValue;
-					float floatValue;
-					if (StringUtil::StringToInt(pos->second.data(),
-												&intValue))
-					{
-					  	entry.extraSettings.insert(
-							std::pair<std::string, IOConfigEntry::ExtraData>(
-												node_name, (float)intValue));
-					} else if (StringUtil::StringToFloat(pos->second.data(),
-														 &floatValue))
-					{
-					  	entry.extraSettings.insert(
-							std::pair<std::string, IOConfigEntry::ExtraData>(
-												node_name, floatValue));
-					} else if ((pos->second.data() == "true") ||
-							   (pos->second.data() == "false"))
-					{
-					  	entry.extraSettings.insert(
-							std::pair<std::string, IOConfigEntry::ExtraData>(
-												node_name, 
-			  					StringUtil::StringToBool(pos->second.data())));
-					} else {
-					  	entry.extraSettings.insert(
-							std::pair<std::string, IOConfigEntry::ExtraData>(
-												node_name, pos->second.data()));
-					}
-				}
-			} 
+			ParseJSONLeaf(&entry, &settings, pos->first, pos->second.data());
 		}
       }
 
 	  ++pos;
 	}
 
-	if (entry.IsValid()) {
-	  //B2BLog::Debug(LogFilt::LM_APP, "IOConfig insert %s", 
-	  //								entry.ioName.c_str());
-	  m_ioEntries.insert(std::pair<IOName, IOConfigEntry>(entry.ioName, entry));
-	}
- 
+	pBuilder->AddEntry(&entry, &settings);
 }
 
+// Receives JSONStreamParser events and fills in IOConfigEntry records.
+// Gives the same entries as ParseJSON() on a ptree of the same file:
+// each object or array is an entry candidate named by its key, its
+// values are leaves of that entry, an empty object or array is a leaf
+// with value "", and children are added before their parent.
+class IOConfig::JSONHandler : public JSONStreamHandler {
+  public:
+	JSONHandler(TableBuilder *pBuilder) : m_pBuilder(pBuilder), m_depth(0) {}
+
+	bool JSONStartContainer(const std::string &key, bool isArray)
+	{
+		if (m_depth > 0) {
+			Frame &parent = m_frames[m_depth-1];
+			parent.hasChildren = true;
+			parent.allNumbers = false;
+		}
+		if (m_frames.size() <= m_depth)
+			m_frames.resize(m_depth+1);
+
+		Frame &frame = m_frames[m_depth++];
+		frame.entry = IOConfigEntry();
+		frame.entry.ioName = key;
+		frame.settings.clear();
+		frame.numbers.clear();
+		frame.hasChildren = false;
+		frame.allNumbers = isArray;
+		return true;
+	}
+
+	bool JSONEndContainer(bool isArray)
+	{
+		b2bassert(m_depth > 0);
+		Frame &frame = m_frames[--m_depth];
+		if (!frame.hasChildren) {
+			// Empty object or array.  ptree treats it as a leaf with no data.
+			if (m_depth > 1) {
+				Frame &parent = m_frames[m_depth-1];
+				ParseJSONLeaf(&parent.entry, &parent.settings,
+							  frame.entry.ioName, EMPTY_VALUE);
+			} // else: parent is json root (or we are root), do nothing
+		} else if (frame.allNumbers && (m_depth > 1)) {
+			// json array of numbers, belongs to parent entry
+			ParseJSONNumArray(&m_frames[m_depth-1].settings,
+							  frame.entry.ioName, &frame.numbers);
+		} else {
+			m_pBuilder->AddEntry(&frame.entry, &frame.settings);
+		}
+		return true;
+	}
+
+	bool JSONValue(const std::string &key, const std::string &value,
+				   ValueType type)
+	{
+		b2bassert(m_depth > 0);
+		Frame &frame = m_frames[m_depth-1];
+		frame.hasChildren = true;
+		if (frame.allNumbers) {
+			// Same test as ptree path, which only has text
+			double number;
+			if (TextToDouble(value, &number))
+				frame.numbers.push_back(number);
+			else
+				frame.allNumbers = false;
+		}
+		if (m_depth > 1) {
+			ParseJSONLeaf(&frame.entry, &frame.settings, key, value);
+		} // else: parent is json root, do nothing
+		return true;
+	}
+
+  private:
+	class Frame {
+	  public:
+		Frame() : hasChildren(false), allNumbers(false) {}
+		IOConfigEntry entry;
+		ExtraSettings settings;
+		std::vector<double> numbers;	// values if array of numbers
+		bool hasChildren;
+		bool allNumbers;				// array with only numbers so far
+	};
+
+	static const std::string EMPTY_VALUE;
+
+	TableBuilder *m_pBuilder;
+	std::vector<Frame> m_frames;	// one per open object/array, reused
+	size_t m_depth;					// number of open objects/arrays
+};
+
+/*static*/ const std::string IOConfig::JSONHandler::EMPTY_VALUE;
+
 bool IOConfig::IOConfigFileParse(const char *ioConfigFileNameFullPath, 
 										std::string *pErr)
+{
+	FileUtil::MappedFile file;
+	std::string err;
+	if (!file.Map(ioConfigFileNameFullPath, &err)) {
+		*pErr = std::string("Read error ") + err;
+		return false; // FAIL
+	}
+
+#ifndef IOCONFIG_NO_CACHE
+	uint64_t jsonHash = IOConfigCache::HashJSON(file.Data(), file.Size());
+	std::string cacheFileName = std::string(ioConfigFileNameFullPath) +
+											IOConfigCache::FILE_SUFFIX;
+	if (IOConfigCache::Load(cacheFileName.c_str(), jsonHash, file.Size(),
+							&m_tables))
+	{
+		B2BLog::Debug(LogFilt::LM_APP, "IOConfig file %s: using cache %s",
+				ioConfigFileNameFullPath, cacheFileName.c_str());
+		return true; // SUCCESS: no parse needed
+	}
+#endif // IOCONFIG_NO_CACHE
+
+#ifdef IOCONFIG_PARSE_PTREE
+	bool returnVal = IOConfigFileParsePTree(ioConfigFileNameFullPath, pErr);
+#else
+	bool returnVal = IOConfigFileParseStream(ioConfigFileNameFullPath,
+										file.Data(), file.Size(), pErr);
+#endif // IOCONFIG_PARSE_PTREE
+
+#ifndef IOCONFIG_NO_CACHE
+	if (returnVal) {
+		// Failing to write cache is not an error, we just parse next time
+		if (!IOConfigCache::Save(cacheFileName.c_str(), jsonHash, file.Size(),
+								 m_tables, &err))
+		{
+			B2BLog::Warn(LogFilt::LM_APP, "IOConfig cache %s not written: %s",
+						cacheFileName.c_str(), err.c_str());
+		}
+	}
+#endif // IOCONFIG_NO_CACHE
+
+	return returnVal;
+}
+
+bool IOConfig::IOConfigFileParsePTree(const char *ioConfigFileNameFullPath, 
+										std::string *pErr)
 {
 	// Read in file and load those settings into tree
 	pt::ptree jsonTree;
@@ -184,18 +542,276 @@ bool IOConfig::IOConfigFileParse(const char *ioConfigFileNameFullPath,
 		return false; // FAIL
     }
 
-	ParseJSON(NULL, jsonTree);
+	TableBuilder builder;
+	ParseJSON(&builder, NULL, jsonTree);
+	builder.Finish(&m_tables);
 
 	return true; // SUCCESS
 }
 
+bool IOConfig::IOConfigFileParseStream(const char *ioConfigFileNameFullPath, 
+						const char *data, size_t size, std::string *pErr)
+{
+	std::string err;
+
+	// Build on the side so a parse error leaves us with an empty table
+	// (same as the ptree path)
+	TableBuilder builder;
+	JSONHandler handler(&builder);
+	JSONStreamParser parser;
+	if (!parser.Parse(data, size, &handler, &err)) {
+		*pErr = std::string("Read error ") + ioConfigFileNameFullPath + 
+															"(" + err + ")";
+		return false; // FAIL
+	}
+
+	builder.Finish(&m_tables);
+	return true; // SUCCESS
+}
+
+IOConfig::IOHandle IOConfig::GetIOHandle(const IOName &name) const
+{
+	size_t lo = 0;
+	size_t hi = m_tables.entriesByName.size();
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		IOHandle handle = m_tables.entriesByName[mid];
+		int cmp = m_tables.entries[handle].ioName.compare(name);
+		if (cmp == 0)
+			return handle; // SUCCESS: found name
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return IOHANDLE_INVALID; // FAIL: name not found
+}
+
+IOConfig::LabelHandle IOConfig::GetLabelHandle(const char *label) const
+{
+	b2bassert(label);
+
+	size_t lo = 0;
+	size_t hi = m_tables.labelsByName.size();
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		LabelHandle handle = m_tables.labelsByName[mid];
+		int cmp = m_tables.labels[handle].compare(label);
+		if (cmp == 0)
+			return handle; // SUCCESS: found label
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return LABELHANDLE_INVALID; // FAIL: label not found
+}
+
 const IOConfig::IOConfigEntry *IOConfig::Lookup(const IOName &name) const
 {
-	IOConfigEntryList::const_iterator iter;
-	iter = m_ioEntries.find(name);
-	if (iter != m_ioEntries.end()) {
-		return &iter->second; // SUCCESS: found name
-	} else {
-		return NULL; // FAIL: name not found
+	return Lookup(GetIOHandle(name));
+}
+
+const IOConfig::ExtraSetting *IOConfig::FindExtraSetting(
+						IOHandle ioHandle, LabelHandle labelHandle) const
+{
+	if ((ioHandle >= m_tables.entries.size()) ||
+		(labelHandle == LABELHANDLE_INVALID))
+	{
+		return NULL; // FAIL: bad handle
+	}
+
+	// Entries have few settings, a short binary search by label handle
+	const IOConfigEntry &entry = m_tables.entries[ioHandle];
+	size_t lo = entry.firstSetting;
+	size_t hi = entry.firstSetting + entry.numSettings;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		const ExtraSetting &setting = m_tables.settings[mid];
+		if (setting.label == labelHandle)
+			return &setting; // SUCCESS: found label
+		if (setting.label < labelHandle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL; // FAIL: label not found
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting, bool *pValue) const
+{
+	if (setting.type != SETTINGTYPE_BOOL)
+		return false; // FAIL: wrong type
+	*pValue = setting.u.boolValue;
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting,
+							int32_t *pValue) const
+{
+	if ((setting.type != SETTINGTYPE_INT) ||
+		(setting.u.intValue < std::numeric_limits<int32_t>::min()) ||
+		(setting.u.intValue > std::numeric_limits<int32_t>::max()))
+	{
+		return false; // FAIL: wrong type or does not fit
+	}
+	*pValue = (int32_t)setting.u.intValue;
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting,
+							int64_t *pValue) const
+{
+	if (setting.type != SETTINGTYPE_INT)
+		return false; // FAIL: wrong type
+	*pValue = setting.u.intValue;
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting, float *pValue) const
+{
+	double value;
+	if (!SettingValue(setting, &value))
+		return false; // FAIL: wrong type
+	*pValue = (float)value;
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting,
+							double *pValue) const
+{
+	// Integers widen to floating point, so "offsetU": 0 reads as 0.0
+	if (setting.type == SETTINGTYPE_DOUBLE)
+		*pValue = setting.u.doubleValue;
+	else if (setting.type == SETTINGTYPE_INT)
+		*pValue = (double)setting.u.intValue;
+	else
+		return false; // FAIL: wrong type
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting,
+							std::string *pValue) const
+{
+	if (setting.type != SETTINGTYPE_STRING)
+		return false; // FAIL: wrong type
+	pValue->assign(&m_tables.stringValues[setting.u.ref.offset],
+				   setting.u.ref.length);
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting,
+							const char **pValue) const
+{
+	if (setting.type != SETTINGTYPE_STRING)
+		return false; // FAIL: wrong type
+	*pValue = &m_tables.stringValues[setting.u.ref.offset];
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting,
+							std::vector<float> *pValue) const
+{
+	if (setting.type != SETTINGTYPE_NUMARRAY)
+		return false; // FAIL: wrong type
+	const double *numbers = m_tables.numbers.empty() ? NULL :
+									&m_tables.numbers[setting.u.ref.offset];
+	pValue->assign(numbers, numbers + setting.u.ref.length);
+	return true; // SUCCESS
+}
+
+bool IOConfig::SettingValue(const ExtraSetting &setting,
+							std::vector<double> *pValue) const
+{
+	if (setting.type != SETTINGTYPE_NUMARRAY)
+		return false; // FAIL: wrong type
+	const double *numbers = m_tables.numbers.empty() ? NULL :
+									&m_tables.numbers[setting.u.ref.offset];
+	pValue->assign(numbers, numbers + setting.u.ref.length);
+	return true; // SUCCESS
+}
+
+bool IOConfig::EntryEqual(IOHandle ioHandle, const IOConfig &other,
+						  IOHandle otherIOHandle) const
+{
+	const IOConfigEntry *entry = Lookup(ioHandle);
+	const IOConfigEntry *otherEntry = other.Lookup(otherIOHandle);
+	if (!entry || !otherEntry)
+		return false; // FAIL: bad handle
+
+	if ((entry->ioName != otherEntry->ioName) ||
+		(entry->ioType != otherEntry->ioType) ||
+		(entry->enable != otherEntry->enable) ||
+		(entry->portNum != otherEntry->portNum) ||
+		(entry->direction != otherEntry->direction) ||
+		(entry->polarity != otherEntry->polarity) ||
+		(memcmp(entry->thresholds.threshValues,
+				otherEntry->thresholds.threshValues,
+				sizeof(entry->thresholds.threshValues)) != 0) ||
+		(entry->numSettings != otherEntry->numSettings))
+	{
+		return false; // different
 	}
+
+	// Label handles differ between IOConfigs, so match settings by label
+	for (uint32_t i = entry->firstSetting;
+		 i < (entry->firstSetting + entry->numSettings); ++i)
+	{
+		const ExtraSetting &setting = m_tables.settings[i];
+		const ExtraSetting *otherSetting = other.FindExtraSetting(
+					otherIOHandle,
+					other.GetLabelHandle(m_tables.labels[setting.label]));
+		if (!otherSetting || (setting.type != otherSetting->type))
+			return false; // different
+		switch (setting.type) {
+		  case SETTINGTYPE_BOOL:
+			if (setting.u.boolValue != otherSetting->u.boolValue)
+				return false; // different
+			break;
+		  case SETTINGTYPE_INT:
+			if (setting.u.intValue != otherSetting->u.intValue)
+				return false; // different
+			break;
+		  case SETTINGTYPE_DOUBLE:
+			if (setting.u.doubleValue != otherSetting->u.doubleValue)
+				return false; // different
+			break;
+		  case SETTINGTYPE_STRING:
+			if ((setting.u.ref.length != otherSetting->u.ref.length) ||
+				(memcmp(&m_tables.stringValues[setting.u.ref.offset],
+					&other.m_tables.stringValues[otherSetting->u.ref.offset],
+					setting.u.ref.length) != 0))
+			{
+				return false; // different
+			}
+			break;
+		  case SETTINGTYPE_NUMARRAY:
+			if (setting.u.ref.length != otherSetting->u.ref.length)
+				return false; // different
+			for (uint32_t n = 0; n < setting.u.ref.length; ++n) {
+				if (m_tables.numbers[setting.u.ref.offset + n] !=
+					other.m_tables.numbers[otherSetting->u.ref.offset + n])
+				{
+					return false; // different
+				}
+			}
+			break;
+		  default:
+			return false; // bad type
+		}
+	}
+
+	return true; // same
+}
+
+const char *IOConfig::IOHandleName(IOHandle ioHandle) const
+{
+	return (ioHandle < m_tables.entries.size()) ?
+				m_tables.entries[ioHandle].ioName.c_str() : "(unknown IO)";
+}
+
+const char *IOConfig::LabelHandleName(LabelHandle labelHandle) const
+{
+	return (labelHandle < m_tables.labels.size()) ?
+				m_tables.labels[labelHandle].c_str() : "(unknown label)";
 }
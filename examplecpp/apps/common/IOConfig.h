@@ -6,8 +6,8 @@
 #include <stdint.h>
 #include <string>
 #include <map>
+#include <vector>
 
-#include "boost/variant.hpp"
 #include "boost/property_tree/ptree.hpp"
 
 #include "common/B2BLogic.h"
@@ -22,7 +22,7 @@ namespace pt = boost::property_tree; // make it easier to use ptree.hpp
 class IOConfig : public B2BModule {
   public:
 	IOConfig(const char *ioConfigFileNameFullPath);
-	IOConfig() : B2BModule("IOConfigNULL") {} // If you want an empty instance
+	IOConfig() : B2BModule("IOConfigNULL"), m_loaded(false) {} // If you want an empty instance
 	~IOConfig() {}
 
 	// START: required virtual from B2BModule.  See that class for doc
@@ -54,6 +54,9 @@ class IOConfig : public B2BModule {
 	//		and you can define as many as you wish.  This allows you to have
 	//		flexible definitions for any IO type.  The number of pairs
 	//		(from json's "valueName" : value) in extraSettings is unlimited.
+	//		Each extraSettings value gets a SettingType from its json text:
+	//		true/false is BOOL, a whole number is INT, any other number
+	//		is DOUBLE, an array of numbers is NUMARRAY, the rest are STRING.
 	//
 	// IOType: description     IOPortNum	dir 	polarity  Note
 	// GPIO: generic GPIO pin    R     	  	 R         O		1
@@ -79,12 +82,15 @@ class IOConfig : public B2BModule {
 	//		and "highThreshold" (all are optional).  The associated float values
 	//		are stored in IOConfigEntry.thresholds.   If a threshold is not
 	//		defined, its value in IOConfigEntry.thresholds is 0.
+	//		ANALOG entries can also define "calRaw" and "calValue"
+	//		(stored in extraSettings) for a raw to engineering unit
+	//		conversion table.  See CalibrationLUT.
 	// Note 5: IOType GENERAL is used for IO type strings not listed above.
 	//		For example, "Instance" is not in above IOType column.
 	//   	  "AudioOut": { "Instance": 0, "dir": "output", "deviceName": "X" },
 	//	 	  IOConfigEntry will be: IOType GENERAL, IOName "AudioOut",
-	//			portNum is 0, and extraSettings have have one entry in
-	//			std::map of std::pair<"deviceName", "X">
+	//			portNum is 0, and extraSettings have have one entry:
+	//			label "deviceName", value "X"
 	//	 
 	typedef enum {
 	   IOTYPE_GPIO = 0,
@@ -124,6 +130,16 @@ class IOConfig : public B2BModule {
 	};
 	static const IOPortNum IOPORTNUM_INVALID = -1;
 
+	// Every IO name and every extraSettings label is interned into a dense
+	// integer handle when the config is loaded.  Look a handle up once (by
+	// string) and then use the handle versions of the accessors below,
+	// which are an array index instead of a string search.
+	// Handles are only valid for the IOConfig instance that returned them.
+	typedef uint32_t IOHandle;
+	typedef uint32_t LabelHandle;
+	static const IOHandle IOHANDLE_INVALID = 0xFFFFFFFF;
+	static const LabelHandle LABELHANDLE_INVALID = 0xFFFFFFFF;
+
 	class IOConfigEntry {
 	  public:
 		IOConfigEntry() : 
@@ -132,7 +148,9 @@ class IOConfig : public B2BModule {
 			enable(true),				// default to enabled
 			portNum(IOPORTNUM_INVALID),
 			direction(IODIR_TOTAL),
-			polarity(IOPOLARITY_HIGH)	// default to "active_high"
+			polarity(IOPOLARITY_HIGH),	// default to "active_high"
+			firstSetting(0),
+			numSettings(0)
 		{}
 
 		IOName ioName;
@@ -143,11 +161,10 @@ class IOConfig : public B2BModule {
 		IOPolarity polarity;
 		IOThresholds thresholds;
 
-		// FIXME: Allow integer too
-		typedef boost::variant<bool, float, std::string> ExtraData;
-		// key is the label from json.  ExtraData is the value.
-		typedef std::map<std::string, ExtraData> ExtraSettings;
-		ExtraSettings extraSettings;
+		// Range of this entry's extraSettings in IOConfig's settings table.
+		// Use GetExtraSettingsValue() to read them.
+		uint32_t firstSetting;
+		uint32_t numSettings;
 
 		// RETURNS: true if our entry is valid, false otherwise
 		bool IsValid() const
@@ -159,10 +176,52 @@ class IOConfig : public B2BModule {
 
 	};
 
+	// Type of an extraSettings value
+	typedef enum {
+	   SETTINGTYPE_BOOL = 0,
+	   SETTINGTYPE_INT,		// int64_t
+	   SETTINGTYPE_DOUBLE,
+	   SETTINGTYPE_STRING,
+	   SETTINGTYPE_NUMARRAY,	// array of numbers, stored as double
+	   SETTINGTYPE_TOTAL	// size of enum (never used as a valid value)
+	} SettingType;
+	static const char * const SettingTypeString[SETTINGTYPE_TOTAL];
+
 	// name: the IO name
 	// RETURNS: the IO config entry for name, NULL if name not found
 	const IOConfigEntry *Lookup(const IOName &name) const;
 
+	// ioHandle: from GetIOHandle()
+	// RETURNS: the IO config entry for ioHandle, NULL if ioHandle invalid
+	const IOConfigEntry *Lookup(IOHandle ioHandle) const
+	{
+		return (ioHandle < m_tables.entries.size()) ?
+									&m_tables.entries[ioHandle] : NULL;
+	}
+
+	// RETURNS: handle for IO name, IOHANDLE_INVALID if name not found
+	IOHandle GetIOHandle(const IOName &name) const;
+
+	// RETURNS: handle for extraSettings label, LABELHANDLE_INVALID if no
+	//		entry defines label
+	LabelHandle GetLabelHandle(const char *label) const;
+	LabelHandle GetLabelHandle(const std::string &label) const
+		{ return GetLabelHandle(label.c_str()); }
+
+	// RETURNS: number of IO entries.  Handles are 0 to NumEntries()-1.
+	size_t NumEntries() const { return m_tables.entries.size(); }
+
+	// RETURNS: true if config file was read and parsed, false if we are
+	//		using an empty table
+	bool IsLoaded() const { return m_loaded; }
+
+	// Compare one of our entries with an entry of another IOConfig
+	//		(for example an older copy of the same file).
+	// RETURNS: true if both entries have same values and same
+	//		extraSettings, false otherwise or if either handle is invalid.
+	bool EntryEqual(IOHandle ioHandle, const IOConfig &other,
+					IOHandle otherIOHandle) const;
+
 	#ifdef OS_IS_LINUX
 	// Go through all the IOs and do some initialization
 	// PWM: none
@@ -186,49 +245,208 @@ class IOConfig : public B2BModule {
 	}
 
 	// For entry ioName, return extraSettings value associated with label.
+	// T: type to read value as.  Must match the value's SettingType:
+	//		bool: BOOL
+	//		int32_t, int64_t: INT (int32_t fails if value does not fit)
+	//		float, double: DOUBLE or INT
+	//		std::string, const char *: STRING (const char * points into
+	//			our table, valid for life of this IOConfig)
+	//		std::vector<float>, std::vector<double>: NUMARRAY
+	//	   A value of any other type is an error (nothing is converted).
 	// pValue: only set if return value is true.
 	// logError: if true, log errors; if false, do not log
 	// RETURNS: true on success, false otherwise
+	// A literal label takes the const char * version: no std::string is
+	// built for it.
 	template <typename T>
-	bool GetExtraSettingsValue(const IOName &ioName, std::string label,
+	bool GetExtraSettingsValue(const IOName &ioName, const std::string &label,
 							T *pValue, bool logError=true) const
 	{
-	  const IOConfig::IOConfigEntry *ioConfigEntry = Lookup(ioName);
-	  if (ioConfigEntry) {
-		IOConfig::IOConfigEntry::ExtraSettings::const_iterator iter =
-								ioConfigEntry->extraSettings.find(label);
-		if (iter != ioConfigEntry->extraSettings.end()) {
-			*pValue = boost::get<T>(iter->second);
+	  return GetExtraSettingsValue(ioName, label.c_str(), pValue, logError);
+	}
+	template <typename T>
+	bool GetExtraSettingsValue(const IOName &ioName, const char *label,
+							T *pValue, bool logError=true) const
+	{
+	  IOHandle ioHandle = GetIOHandle(ioName);
+	  if (ioHandle == IOHANDLE_INVALID) {
+		if (logError) {
+			B2BLog::Err(LogFilt::LM_APP, "%s not defined in IOConfig",
+											ioName.c_str());
+		}
+		return false; // FAIL
+	  }
+	  LabelHandle labelHandle = GetLabelHandle(label);
+	  if (labelHandle == LABELHANDLE_INVALID) {
+		// No entry uses label, log it here while we still have the string
+		if (logError) {
+			B2BLog::Err(LogFilt::LM_APP, "%s: no IOConfig \"%s\" defined.",
+			  								ioName.c_str(), label);
+		}
+		return false; // FAIL
+	  }
+	  return GetExtraSettingsValue(ioHandle, labelHandle, pValue, logError);
+	}
+
+	// Same as above, using handles.  No string compares.
+	template <typename T>
+	bool GetExtraSettingsValue(IOHandle ioHandle, LabelHandle labelHandle,
+							T *pValue, bool logError=true) const
+	{
+	  const ExtraSetting *pSetting = FindExtraSetting(ioHandle, labelHandle);
+	  if (pSetting) {
+		if (SettingValue(*pSetting, pValue)) {
 			return true; // SUCCESS
 		} else {
 			if (logError) {
-				B2BLog::Err(LogFilt::LM_APP, "%s: no IOConfig \"%s\" defined.",
-			  								ioName.c_str(), label.c_str());
+				B2BLog::Err(LogFilt::LM_APP,
+						"%s: IOConfig \"%s\" is %s, wrong type for read",
+						IOHandleName(ioHandle), LabelHandleName(labelHandle),
+						SettingTypeString[pSetting->type]);
 			}
 			return false; // FAIL
 		}
 	  } else {
 		if (logError) {
-			B2BLog::Err(LogFilt::LM_APP, "%s not defined in IOConfig",
-											ioName.c_str());
+			B2BLog::Err(LogFilt::LM_APP, "%s: no IOConfig \"%s\" defined.",
+						IOHandleName(ioHandle), LabelHandleName(labelHandle));
 		}
 		return false; // FAIL
 	  }
 	}
 
+	// RETURNS: type of label's value in entry, SETTINGTYPE_TOTAL if either
+	//		handle is invalid or entry does not define label
+	SettingType GetExtraSettingsType(IOHandle ioHandle,
+									 LabelHandle labelHandle) const
+	{
+	  const ExtraSetting *pSetting = FindExtraSetting(ioHandle, labelHandle);
+	  return pSetting ? (SettingType)pSetting->type : SETTINGTYPE_TOTAL;
+	}
+
   private:
+	friend class IOConfigCache; // reads and writes m_tables
+
+	// One extraSettings value.  Plain data, so tables can be copied to
+	// and from IOConfigCache as is.
+	class ExtraSetting {
+	  public:
+		LabelHandle label;
+		uint32_t type;			// SettingType
+		union {
+			bool boolValue;
+			int64_t intValue;
+			double doubleValue;
+			// STRING: offset of NUL terminated string in stringValues
+			// NUMARRAY: offset of first number in numbers
+			struct {
+				uint32_t offset;
+				uint32_t length; // chars (not counting NUL) or numbers
+			} ref;
+		} u;
+	};
+
+	// All of our loaded config.  Kept together so a new config can be
+	// built on the side and swapped in.
+	class Tables {
+	  public:
+		std::vector<IOConfigEntry> entries;		// index is IOHandle
+		std::vector<IOHandle> entriesByName;	// handles sorted by ioName
+		std::vector<std::string> labels;		// index is LabelHandle
+		std::vector<LabelHandle> labelsByName;	// handles sorted by label
+		// Each entry's settings are together (see IOConfigEntry
+		// firstSetting), sorted by label handle
+		std::vector<ExtraSetting> settings;
+		std::string stringValues;				// STRING setting values
+		std::vector<double> numbers;			// NUMARRAY setting values
+
+		void swap(Tables &other);
+	};
+
+	// Parse time only: an extraSettings value before it is put in Tables
+	class ParsedSetting {
+	  public:
+		ParsedSetting() : type(SETTINGTYPE_TOTAL), intValue(0),
+						  doubleValue(0) {}
+		SettingType type;
+		int64_t intValue;				// BOOL and INT
+		double doubleValue;				// DOUBLE
+		std::string stringValue;		// STRING
+		std::vector<double> numbers;	// NUMARRAY
+	};
+	// Parse time only: an entry's extraSettings before interning.
+	// key is the label from json.
+	typedef std::map<std::string, ParsedSetting> ExtraSettings;
+
+	// Builds Tables from parsed entries, see IOConfig.cpp
+	class TableBuilder;
+
 	// Helper function that does actual parsing of the pt::ptree node
 	// parentNodeName: the name of the parent node that contains this ptree
-	void ParseJSON(const char *parentNodeName, const pt::ptree &node);
+	void ParseJSON(TableBuilder *pBuilder, const char *parentNodeName,
+				   const pt::ptree &node);
+
+	// Apply one json "label" : value pair to an entry.  Shared by the
+	// ptree and streaming parsers so both give identical entries.
+	// pEntry, pSettings: entry to update
+	// label: json label
+	// value: json value as text (as ptree stores it)
+	static void ParseJSONLeaf(IOConfigEntry *pEntry, ExtraSettings *pSettings,
+						const std::string &label, const std::string &value);
+
+	// Add a json array of numbers as a NUMARRAY extraSetting.  Shared by
+	// the ptree and streaming parsers.
+	// numbers: array values.  Contents are moved, not copied.
+	static void ParseJSONNumArray(ExtraSettings *pSettings,
+						const std::string &label, std::vector<double> *pNumbers);
+
+	// Streaming parser callbacks, see IOConfig.cpp
+	class JSONHandler;
 
 	// Read in IO config file, and load IO config tables from it.
+	// Uses the IOConfigCache file if it matches the json file.  Otherwise
+	// parses the json file and writes a new cache.  Define
+	// IOCONFIG_NO_CACHE to always parse.
+	// Uses the single pass streaming parser on a memory mapped file.
+	// Define IOCONFIG_PARSE_PTREE to use boost::property_tree instead.
 	// ioConfigFileNameFullPath: full path name of IO config file
 	// pErr: errors, only valid if method returns false
 	// RETURNS: true on success, false otherwise.
 	bool IOConfigFileParse(const char *ioConfigFileNameFullPath, 
 										std::string *pErr);
+	// Same as IOConfigFileParse(), for each parser.
+	// data, size: contents of ioConfigFileNameFullPath
+	bool IOConfigFileParsePTree(const char *ioConfigFileNameFullPath, 
+										std::string *pErr);
+	bool IOConfigFileParseStream(const char *ioConfigFileNameFullPath, 
+						const char *data, size_t size, std::string *pErr);
+
+	// RETURNS: label's value in entry, NULL if either handle is invalid
+	//		or entry does not define label
+	const ExtraSetting *FindExtraSetting(IOHandle ioHandle,
+										 LabelHandle labelHandle) const;
+
+	// Read setting as type of pValue.  See GetExtraSettingsValue() for
+	// which types match.
+	// RETURNS: true on success, false if type does not match
+	bool SettingValue(const ExtraSetting &setting, bool *pValue) const;
+	bool SettingValue(const ExtraSetting &setting, int32_t *pValue) const;
+	bool SettingValue(const ExtraSetting &setting, int64_t *pValue) const;
+	bool SettingValue(const ExtraSetting &setting, float *pValue) const;
+	bool SettingValue(const ExtraSetting &setting, double *pValue) const;
+	bool SettingValue(const ExtraSetting &setting,
+					  std::string *pValue) const;
+	bool SettingValue(const ExtraSetting &setting,
+					  const char **pValue) const;
+	bool SettingValue(const ExtraSetting &setting,
+					  std::vector<float> *pValue) const;
+	bool SettingValue(const ExtraSetting &setting,
+					  std::vector<double> *pValue) const;
+
+	// RETURNS: name for handle, for logging.  Never NULL.
+	const char *IOHandleName(IOHandle ioHandle) const;
+	const char *LabelHandleName(LabelHandle labelHandle) const;
 
-	// table of IO definitions
-	typedef std::map<IOName, IOConfigEntry> IOConfigEntryList;
-	IOConfigEntryList m_ioEntries;
+	Tables m_tables;
+	bool m_loaded;	// true if file parse succeeded
 };
@@ -0,0 +1,348 @@
+//
+// IOConfigCache: compiled binary form of an IOConfig json file.
+//
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <map>
+#include <vector>
+
+#include "boost/static_assert.hpp"
+
+#include "common/FileUtil.h"
+
+#include "IOConfigCache.h"
+
+/*static*/ const char * const IOConfigCache::FILE_SUFFIX = ".cache";
+
+static const char CACHE_MAGIC[8] = { 'B', '2', 'B', 'I', 'O', 'C', 'F', 0 };
+
+/*static*/ uint64_t IOConfigCache::HashJSON(const char *data, size_t size)
+{
+	// FNV-1a, 64 bit.  Fast and good enough to detect an edited file.
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/*static*/ bool IOConfigCache::StringValid(const CacheHeader &header,
+										   const CacheString &str)
+{
+	return (str.offset <= header.stringPoolSize) &&
+		   (str.length <= (header.stringPoolSize - str.offset));
+}
+
+// Check that handles in byName are in range and sort their names
+// RETURNS: true if valid, false otherwise
+template <typename NAMEOF>
+static bool ByNameValid(const uint32_t *byName, uint32_t num,
+						const NAMEOF &nameOf)
+{
+	for (uint32_t i = 0; i < num; ++i) {
+		if (byName[i] >= num)
+			return false; // FAIL: bad handle
+		if ((i > 0) && !(nameOf(byName[i-1]) < nameOf(byName[i])))
+			return false; // FAIL: not sorted
+	}
+	return true; // SUCCESS
+}
+
+// Gives names of entries or labels for ByNameValid()
+class CacheEntryNameOf {
+  public:
+	CacheEntryNameOf(const std::vector<IOConfig::IOConfigEntry> &entries) :
+		m_entries(entries) {}
+	const std::string &operator()(uint32_t handle) const
+		{ return m_entries[handle].ioName; }
+  private:
+	const std::vector<IOConfig::IOConfigEntry> &m_entries;
+};
+class CacheLabelNameOf {
+  public:
+	CacheLabelNameOf(const std::vector<std::string> &labels) :
+		m_labels(labels) {}
+	const std::string &operator()(uint32_t handle) const
+		{ return m_labels[handle]; }
+  private:
+	const std::vector<std::string> &m_labels;
+};
+
+/*static*/ bool IOConfigCache::Load(const char *cacheFileName,
+					uint64_t jsonHash, uint64_t jsonSize,
+					IOConfig::Tables *pTables)
+{
+	BOOST_STATIC_ASSERT((sizeof(CacheHeader) % sizeof(double)) == 0);
+	BOOST_STATIC_ASSERT((sizeof(IOConfig::ExtraSetting) % sizeof(double)) == 0);
+
+	FileUtil::MappedFile file;
+	if (!file.Map(cacheFileName))
+		return false; // FAIL: no cache yet
+
+	// Validate everything before we use it, a bad cache must not crash us
+	const char *data = file.Data();
+	const size_t size = file.Size();
+	if (size < sizeof(CacheHeader))
+		return false; // FAIL: too small
+	const CacheHeader &header = *reinterpret_cast<const CacheHeader *>(data);
+	if ((memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ||
+		(header.version != VERSION) ||
+		(header.levelTotal != B2BLogic::LEVEL_TOTAL) ||
+		(header.jsonHash != jsonHash) ||
+		(header.jsonSize != jsonSize))
+	{
+		return false; // FAIL: other format or stale
+	}
+
+	const uint64_t settingsOffset = sizeof(CacheHeader);
+	const uint64_t numbersOffset = settingsOffset +
+		((uint64_t)header.numSettings * sizeof(IOConfig::ExtraSetting));
+	const uint64_t entriesOffset = numbersOffset +
+					((uint64_t)header.numNumbers * sizeof(double));
+	const uint64_t entriesByNameOffset = entriesOffset +
+					((uint64_t)header.numEntries * sizeof(CacheEntry));
+	const uint64_t labelsOffset = entriesByNameOffset +
+					((uint64_t)header.numEntries * sizeof(uint32_t));
+	const uint64_t labelsByNameOffset = labelsOffset +
+					((uint64_t)header.numLabels * sizeof(CacheString));
+	const uint64_t stringPoolOffset = labelsByNameOffset +
+					((uint64_t)header.numLabels * sizeof(uint32_t));
+	const uint64_t stringValuesOffset = stringPoolOffset +
+												header.stringPoolSize;
+	if ((stringValuesOffset + header.stringValuesSize) != size)
+		return false; // FAIL: truncated or bad counts
+
+	const CacheEntry *entries =
+			reinterpret_cast<const CacheEntry *>(data + entriesOffset);
+	const uint32_t *entriesByName =
+			reinterpret_cast<const uint32_t *>(data + entriesByNameOffset);
+	const CacheString *labels =
+			reinterpret_cast<const CacheString *>(data + labelsOffset);
+	const uint32_t *labelsByName =
+			reinterpret_cast<const uint32_t *>(data + labelsByNameOffset);
+	const char *pool = data + stringPoolOffset;
+
+	IOConfig::Tables tables;
+
+	// Setting values are plain data, copy as is then check them
+	tables.stringValues.assign(data + stringValuesOffset,
+							   header.stringValuesSize);
+	tables.numbers.resize(header.numNumbers);
+	if (header.numNumbers) {
+		memcpy(&tables.numbers[0], data + numbersOffset,
+			   header.numNumbers * sizeof(double));
+	}
+	tables.settings.resize(header.numSettings);
+	if (header.numSettings) {
+		memcpy(&tables.settings[0], data + settingsOffset,
+			   header.numSettings * sizeof(IOConfig::ExtraSetting));
+	}
+	for (uint32_t i = 0; i < header.numSettings; ++i) {
+		IOConfig::ExtraSetting &setting = tables.settings[i];
+		if (setting.label >= header.numLabels)
+			return false; // FAIL: bad setting
+		switch (setting.type) {
+		  case IOConfig::SETTINGTYPE_BOOL:
+		  {
+			// Any byte value in file must become a valid bool
+			unsigned char rawBool;
+			memcpy(&rawBool, &setting.u.boolValue, sizeof(rawBool));
+			setting.u.boolValue = (rawBool != 0);
+			break;
+		  }
+		  case IOConfig::SETTINGTYPE_INT:
+		  case IOConfig::SETTINGTYPE_DOUBLE:
+			break;
+		  case IOConfig::SETTINGTYPE_STRING:
+			if ((setting.u.ref.offset >= header.stringValuesSize) ||
+				(setting.u.ref.length >=
+							(header.stringValuesSize - setting.u.ref.offset)) ||
+				(tables.stringValues[setting.u.ref.offset +
+									 setting.u.ref.length] != '\0'))
+			{
+				return false; // FAIL: bad setting
+			}
+			break;
+		  case IOConfig::SETTINGTYPE_NUMARRAY:
+			if ((setting.u.ref.offset > header.numNumbers) ||
+				(setting.u.ref.length >
+							(header.numNumbers - setting.u.ref.offset)))
+			{
+				return false; // FAIL: bad setting
+			}
+			break;
+		  default:
+			return false; // FAIL: bad setting
+		}
+	}
+
+	tables.labels.resize(header.numLabels);
+	for (uint32_t i = 0; i < header.numLabels; ++i) {
+		if (!StringValid(header, labels[i]))
+			return false; // FAIL: bad label
+		tables.labels[i].assign(pool + labels[i].offset, labels[i].length);
+	}
+	if (!ByNameValid(labelsByName, header.numLabels,
+					 CacheLabelNameOf(tables.labels)))
+	{
+		return false; // FAIL: bad label index
+	}
+	tables.labelsByName.assign(labelsByName,
+							   labelsByName + header.numLabels);
+
+	tables.entries.resize(header.numEntries);
+	for (uint32_t i = 0; i < header.numEntries; ++i) {
+		const CacheEntry &cacheEntry = entries[i];
+		if (!StringValid(header, cacheEntry.name) ||
+			(cacheEntry.firstSetting > header.numSettings) ||
+			(cacheEntry.numSettings >
+							(header.numSettings - cacheEntry.firstSetting)) ||
+			(cacheEntry.ioType >= IOConfig::IOTYPE_TOTAL) ||
+			(cacheEntry.direction >= IOConfig::IODIR_TOTAL) ||
+			(cacheEntry.polarity >= IOConfig::IOPOLARITY_TOTAL))
+		{
+			return false; // FAIL: bad entry
+		}
+
+		IOConfig::IOConfigEntry &entry = tables.entries[i];
+		entry.ioName.assign(pool + cacheEntry.name.offset,
+							cacheEntry.name.length);
+		entry.ioType = (IOConfig::IOType)cacheEntry.ioType;
+		entry.enable = cacheEntry.enable != 0;
+		entry.portNum = cacheEntry.portNum;
+		entry.direction = (IOConfig::IODirection)cacheEntry.direction;
+		entry.polarity = (IOConfig::IOPolarity)cacheEntry.polarity;
+		memcpy(entry.thresholds.threshValues, cacheEntry.thresholds,
+			   sizeof(entry.thresholds.threshValues));
+		entry.firstSetting = cacheEntry.firstSetting;
+		entry.numSettings = cacheEntry.numSettings;
+
+		for (uint32_t s = 1; s < cacheEntry.numSettings; ++s) {
+			if (!(tables.settings[cacheEntry.firstSetting + s - 1].label <
+				  tables.settings[cacheEntry.firstSetting + s].label))
+			{
+				return false; // FAIL: settings not sorted
+			}
+		}
+	}
+	if (!ByNameValid(entriesByName, header.numEntries,
+					 CacheEntryNameOf(tables.entries)))
+	{
+		return false; // FAIL: bad entry index
+	}
+	tables.entriesByName.assign(entriesByName,
+								entriesByName + header.numEntries);
+
+	pTables->swap(tables);
+	return true; // SUCCESS
+}
+
+// Builds the string pool, sharing storage for repeated strings
+class CacheStringPool {
+  public:
+	uint32_t Size() const { return m_pool.size(); }
+	const std::string &Data() const { return m_pool; }
+
+	// RETURNS: offset of str in pool
+	uint32_t Add(const std::string &str)
+	{
+		std::map<std::string, uint32_t>::const_iterator iter =
+															m_offsets.find(str);
+		if (iter != m_offsets.end())
+			return iter->second;
+		uint32_t offset = m_pool.size();
+		m_pool.append(str);
+		m_offsets.insert(std::pair<std::string, uint32_t>(str, offset));
+		return offset;
+	}
+
+  private:
+	std::string m_pool;
+	std::map<std::string, uint32_t> m_offsets;
+};
+
+// Write count items at data to fp
+// RETURNS: true on success, false otherwise
+template <typename T>
+static bool WriteItems(FILE *fp, const T *data, size_t count)
+{
+	return (count == 0) || (fwrite(data, sizeof(T), count, fp) == count);
+}
+
+/*static*/ bool IOConfigCache::Save(const char *cacheFileName,
+					uint64_t jsonHash, uint64_t jsonSize,
+					const IOConfig::Tables &tables, std::string *pErr)
+{
+	// Build tables in memory, then write them in one go
+	CacheStringPool pool;
+	std::vector<CacheEntry> entries(tables.entries.size());
+	std::vector<CacheString> labels(tables.labels.size());
+
+	for (size_t i = 0; i < tables.entries.size(); ++i) {
+		const IOConfig::IOConfigEntry &entry = tables.entries[i];
+		CacheEntry &cacheEntry = entries[i];
+		memset(&cacheEntry, 0, sizeof(cacheEntry));
+		cacheEntry.name.offset = pool.Add(entry.ioName);
+		cacheEntry.name.length = entry.ioName.length();
+		cacheEntry.firstSetting = entry.firstSetting;
+		cacheEntry.numSettings = entry.numSettings;
+		cacheEntry.portNum = entry.portNum;
+		cacheEntry.ioType = entry.ioType;
+		cacheEntry.enable = entry.enable;
+		cacheEntry.direction = entry.direction;
+		cacheEntry.polarity = entry.polarity;
+		memcpy(cacheEntry.thresholds, entry.thresholds.threshValues,
+			   sizeof(cacheEntry.thresholds));
+	}
+
+	for (size_t i = 0; i < tables.labels.size(); ++i) {
+		labels[i].offset = pool.Add(tables.labels[i]);
+		labels[i].length = tables.labels[i].length();
+	}
+
+	CacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = VERSION;
+	header.levelTotal = B2BLogic::LEVEL_TOTAL;
+	header.jsonHash = jsonHash;
+	header.jsonSize = jsonSize;
+	header.numEntries = entries.size();
+	header.numLabels = labels.size();
+	header.numSettings = tables.settings.size();
+	header.numNumbers = tables.numbers.size();
+	header.stringPoolSize = pool.Size();
+	header.stringValuesSize = tables.stringValues.size();
+
+	std::string tempFileName = std::string(cacheFileName) + ".tmp";
+	FILE *fp = fopen(tempFileName.c_str(), "wb");
+	if (!fp) {
+		*pErr = std::string("open failed: ") + strerror(errno);
+		return false; // FAIL
+	}
+	bool ok =
+		WriteItems(fp, &header, 1) &&
+		WriteItems(fp, tables.settings.empty() ? NULL :
+			&tables.settings[0], tables.settings.size()) &&
+		WriteItems(fp, tables.numbers.empty() ? NULL :
+			&tables.numbers[0], tables.numbers.size()) &&
+		WriteItems(fp, entries.empty() ? NULL : &entries[0], entries.size()) &&
+		WriteItems(fp, tables.entriesByName.empty() ? NULL :
+			&tables.entriesByName[0], tables.entriesByName.size()) &&
+		WriteItems(fp, labels.empty() ? NULL : &labels[0], labels.size()) &&
+		WriteItems(fp, tables.labelsByName.empty() ? NULL :
+			&tables.labelsByName[0], tables.labelsByName.size()) &&
+		WriteItems(fp, pool.Data().data(), pool.Size()) &&
+		WriteItems(fp, tables.stringValues.data(),
+				   tables.stringValues.size());
+	ok = (fclose(fp) == 0) && ok;
+	if (!ok || (rename(tempFileName.c_str(), cacheFileName) != 0)) {
+		*pErr = std::string("write failed: ") + strerror(errno);
+		remove(tempFileName.c_str());
+		return false; // FAIL
+	}
+
+	return true; // SUCCESS
+}
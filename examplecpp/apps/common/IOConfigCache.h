@@ -0,0 +1,96 @@
+#pragma once
+//
+// IOConfigCache: compiled binary form of an IOConfig json file.
+//		Written next to the json file (json name + FILE_SUFFIX) after a
+//		successful parse and tagged with a hash of the json text.  On the
+//		next start IOConfig memory maps the cache and, if the hash still
+//		matches, fills its tables from it with no json parsing and no
+//		text to number conversion.  Any mismatch or damage just means the
+//		cache is ignored and rewritten.
+//
+//		File layout (native byte order, all offsets from start of file).
+//		Tables are stored in IOConfig's in memory order, so handles in the
+//		cache are the same as IOConfig handles:
+//			CacheHeader
+//			IOConfig::ExtraSetting[numSettings]	grouped by entry, sorted
+//												by label
+//			double[numNumbers]			NUMARRAY setting values
+//			CacheEntry[numEntries]		index is IOHandle
+//			uint32_t[numEntries]		IOHandles sorted by name
+//			CacheString[numLabels]		index is LabelHandle
+//			uint32_t[numLabels]			LabelHandles sorted by label
+//			string pool					names and labels
+//			char[stringValuesSize]		STRING setting values
+//		The 8 byte values come first so they stay aligned.
+//
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "IOConfig.h"
+
+class IOConfigCache {
+  public:
+	// Appended to json file name to get cache file name
+	static const char * const FILE_SUFFIX;
+
+	// RETURNS: hash of json text, used to tell if cache is stale
+	static uint64_t HashJSON(const char *data, size_t size);
+
+	// Fill pTables from cache file if it was built from json text with
+	//		jsonHash and jsonSize.
+	// cacheFileName: full path of cache file
+	// pTables: filled only if method returns true
+	// RETURNS: true on success, false if cache is missing, stale or bad
+	static bool Load(const char *cacheFileName, uint64_t jsonHash,
+					 uint64_t jsonSize, IOConfig::Tables *pTables);
+
+	// Write tables to cache file.  Written to a temp file and renamed, so
+	//		a reader never sees a partial cache.
+	// cacheFileName: full path of cache file
+	// pErr: errors, only valid if method returns false
+	// RETURNS: true on success, false otherwise.
+	static bool Save(const char *cacheFileName, uint64_t jsonHash,
+					 uint64_t jsonSize, const IOConfig::Tables &tables,
+					 std::string *pErr);
+
+  private:
+	// Bump when any structure below (or IOConfig::ExtraSetting) changes
+	static const uint32_t VERSION = 3;
+
+	// A string in the string pool
+	struct CacheString {
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct CacheHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t levelTotal;	// B2BLogic::LEVEL_TOTAL when written
+		uint64_t jsonHash;
+		uint64_t jsonSize;
+		uint32_t numEntries;
+		uint32_t numLabels;
+		uint32_t numSettings;
+		uint32_t numNumbers;
+		uint32_t stringPoolSize;
+		uint32_t stringValuesSize;
+	};
+
+	struct CacheEntry {
+		CacheString name;
+		uint32_t firstSetting;	// index into settings table
+		uint32_t numSettings;
+		int16_t portNum;
+		uint8_t ioType;
+		uint8_t enable;
+		uint8_t direction;
+		uint8_t polarity;
+		uint8_t pad[2];
+		float thresholds[B2BLogic::LEVEL_TOTAL];
+	};
+
+	// RETURNS: true if str lies inside the string pool
+	static bool StringValid(const CacheHeader &header, const CacheString &str);
+};
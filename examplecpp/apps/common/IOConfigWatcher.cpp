@@ -0,0 +1,211 @@
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "common/b2bassert.h"
+#include "log/B2BLog.h"
+
+#include "IOConfigWatcher.h"
+
+IOConfigWatcher::IOConfigWatcher(const char *ioConfigFileNameFullPath) :
+	ThreadModule("IOConfigWatcher"),
+	m_fileNameFullPath(ioConfigFileNameFullPath),
+	m_inotifyFd(-1),
+	m_config(new IOConfig(ioConfigFileNameFullPath)),
+	m_epoch(0),
+	m_generation(0)
+{
+	m_readers[0] = 0;
+	m_readers[1] = 0;
+
+	size_t slash = m_fileNameFullPath.rfind('/');
+	if (slash == std::string::npos) {
+		m_dirName = ".";
+		m_baseName = m_fileNameFullPath;
+	} else {
+		m_dirName = m_fileNameFullPath.substr(0, slash+1);
+		m_baseName = m_fileNameFullPath.substr(slash+1);
+	}
+
+	pthread_mutexattr_t mutexattr;
+	pthread_mutexattr_init(&mutexattr);
+	pthread_mutexattr_settype(&mutexattr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_lockSubscribers, &mutexattr);
+	pthread_mutexattr_destroy(&mutexattr);
+	pthread_mutex_init(&m_lockReload, NULL);
+}
+
+IOConfigWatcher::~IOConfigWatcher()
+{
+	if (m_inotifyFd >= 0)
+		close(m_inotifyFd);
+	// Thread is stopped (ThreadModule requires it), so no reader is left
+	delete m_config.load();
+	pthread_mutex_destroy(&m_lockReload);
+	pthread_mutex_destroy(&m_lockSubscribers);
+}
+
+bool IOConfigWatcher::Init()
+{
+	if (m_inotifyFd >= 0)
+		return true; // already done
+
+	m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotifyFd < 0) {
+		B2BLog::Err(LogFilt::LM_APP, "%s: inotify_init1 FAIL: %s",
+					Name(), strerror(errno));
+		return false; // FAIL
+	}
+
+	// Watch the directory, not the file: editors and deploy scripts often
+	// replace the file by rename, which would end a watch on the file.
+	if (inotify_add_watch(m_inotifyFd, m_dirName.c_str(),
+						  IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		B2BLog::Err(LogFilt::LM_APP, "%s: inotify_add_watch(%s) FAIL: %s",
+					Name(), m_dirName.c_str(), strerror(errno));
+		close(m_inotifyFd);
+		m_inotifyFd = -1;
+		return false; // FAIL
+	}
+
+	return true; // SUCCESS
+}
+
+IOConfigWatcher::ReadGuard::ReadGuard(const IOConfigWatcher &watcher) :
+	m_watcher(watcher)
+{
+	// Count ourselves in before we load the pointer.  Synchronize() waits
+	// for this count, so the config we load cannot be deleted under us.
+	m_readerIdx = m_watcher.m_epoch.load() & 1;
+	m_watcher.m_readers[m_readerIdx].fetch_add(1);
+	m_config = m_watcher.m_config.load();
+}
+
+IOConfigWatcher::ReadGuard::~ReadGuard()
+{
+	m_watcher.m_readers[m_readerIdx].fetch_sub(1);
+}
+
+void IOConfigWatcher::Subscribe(const IOConfig::IOName &ioName,
+								const ChangeCallback &callback)
+{
+	pthread_mutex_lock(&m_lockSubscribers);
+	m_subscribers.insert(Subscribers::value_type(ioName, callback));
+	pthread_mutex_unlock(&m_lockSubscribers);
+}
+
+bool IOConfigWatcher::Reload()
+{
+	// One Reload at a time: another one could delete oldConfig while we
+	// notify with it, and two Synchronize()s would flip m_epoch under
+	// each other.  Parse under the lock too, so the last file read is
+	// the one published.
+	pthread_mutex_lock(&m_lockReload);
+	IOConfig *newConfig = new IOConfig(m_fileNameFullPath.c_str());
+	if (!newConfig->IsLoaded()) {
+		// IOConfig already logged why
+		B2BLog::Err(LogFilt::LM_APP, "%s: %s not loaded, keeping current",
+					Name(), m_fileNameFullPath.c_str());
+		delete newConfig;
+		pthread_mutex_unlock(&m_lockReload);
+		return false; // FAIL
+	}
+
+	const IOConfig *oldConfig = m_config.exchange(newConfig);
+	m_generation.fetch_add(1);
+	B2BLog::Info(LogFilt::LM_APP, "%s: %s reloaded, %d entries",
+				 Name(), m_fileNameFullPath.c_str(),
+				 (int)newConfig->NumEntries());
+
+	Synchronize(); // after this only we can see oldConfig
+	NotifyChanges(*oldConfig, *newConfig);
+	delete oldConfig;
+	pthread_mutex_unlock(&m_lockReload);
+
+	return true; // SUCCESS
+}
+
+void IOConfigWatcher::Synchronize()
+{
+	// A reader may have read m_epoch just before a flip and count itself
+	// in the old count after we checked it.  Flipping and draining twice
+	// covers both counts, so every reader that started before us is done.
+	for (int flip = 0; flip < 2; ++flip) {
+		uint32_t oldIdx = m_epoch.fetch_add(1) & 1;
+		while (m_readers[oldIdx].load() != 0)
+			usleep(100);
+	}
+}
+
+void IOConfigWatcher::NotifyChanges(const IOConfig &oldConfig,
+									const IOConfig &newConfig)
+{
+	pthread_mutex_lock(&m_lockSubscribers);
+	Subscribers::const_iterator iter = m_subscribers.begin();
+	while (iter != m_subscribers.end()) {
+		const IOConfig::IOName &ioName = iter->first;
+		IOConfig::IOHandle oldHandle = oldConfig.GetIOHandle(ioName);
+		IOConfig::IOHandle newHandle = newConfig.GetIOHandle(ioName);
+		bool changed;
+		if ((oldHandle == IOConfig::IOHANDLE_INVALID) &&
+			(newHandle == IOConfig::IOHANDLE_INVALID))
+		{
+			changed = false; // not in either
+		} else {
+			changed = !newConfig.EntryEqual(newHandle, oldConfig, oldHandle);
+		}
+
+		// Call every subscriber of this entry, then go to next entry
+		Subscribers::const_iterator end = m_subscribers.upper_bound(ioName);
+		for (; iter != end; ++iter) {
+			if (changed)
+				iter->second(newConfig, ioName);
+		}
+	}
+	pthread_mutex_unlock(&m_lockSubscribers);
+}
+
+void *IOConfigWatcher::Worker(void *arg)
+{
+	if (m_inotifyFd < 0) {
+		// Init was not called or failed, nothing to watch
+		usleep(POLL_TIMEOUT_MS * 1000);
+		return NULL;
+	}
+
+	struct pollfd pfd;
+	pfd.fd = m_inotifyFd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, POLL_TIMEOUT_MS) <= 0)
+		return NULL; // timeout (or EINTR), ThreadModule checks for Stop
+
+	// Read all events, note if any is for our file
+	bool ourFile = false;
+	for (;;) {
+		char buf[4096]
+			__attribute__ ((aligned(__alignof__(struct inotify_event))));
+		ssize_t len = read(m_inotifyFd, buf, sizeof(buf));
+		if (len <= 0)
+			break; // no more events
+		for (char *ptr = buf; ptr < (buf + len); ) {
+			const struct inotify_event *event =
+							reinterpret_cast<const struct inotify_event *>(ptr);
+			if (event->len && (m_baseName == event->name))
+				ourFile = true;
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+		if (!ourFile)
+			continue;
+
+		// Let writer finish, then drain what it did meanwhile
+		usleep(SETTLE_MS * 1000);
+	}
+
+	if (ourFile)
+		Reload();
+
+	return NULL;
+}
@@ -0,0 +1,120 @@
+#pragma once
+//
+// IOConfigWatcher: hot reload of the IO config json file.
+//		Watches the config file with inotify.  When the file is written
+//		(or replaced by rename, like most editors do) our thread parses it
+//		into a new IOConfig and publishes it with an atomic pointer swap.
+//		The old IOConfig is deleted once no reader can still be using it
+//		(RCU style: readers never take a lock, the reload thread waits).
+//
+//		Readers:
+//			IOConfigWatcher::ReadGuard guard(watcher);
+//			const IOConfig &ioConfig = guard.Config();
+//			... use ioConfig, including pointers and handles from it ...
+//		ioConfig (and anything from it) is valid until guard is destroyed.
+//		Keep guards short, a reload waits for all guards that exist when
+//		it publishes.  IOHandles are only valid for the IOConfig that
+//		returned them, so look them up again after a change.
+//
+//		Subscribers get a callback for each entry that changed (including
+//		added and removed entries), so only affected modules reconfigure.
+//
+//		If the new file does not parse, the current config is kept.
+//
+#include <stdint.h>
+#include <pthread.h>
+#include <map>
+#include <string>
+
+#include "boost/atomic.hpp"
+#include "boost/function.hpp"
+
+#include "apps/common/IOConfig.h"
+#include "apps/common/ThreadModule.h"
+
+class IOConfigWatcher : public ThreadModule {
+  public:
+	// ioConfigFileNameFullPath: full path name of IO config file.  It is
+	//		loaded here, so Config is available before Start.
+	IOConfigWatcher(const char *ioConfigFileNameFullPath);
+	virtual ~IOConfigWatcher();
+
+	// START: required virtual from B2BModule.  See that class for doc
+	// Init sets up inotify.  Start/Stop are ThreadModule's.
+	bool Init();
+	// END: required virtual from B2BModule.  See that class for doc
+
+	// Lock free read access to the current IOConfig.  See top of file.
+	class ReadGuard {
+	  public:
+		ReadGuard(const IOConfigWatcher &watcher);
+		~ReadGuard();
+
+		const IOConfig &Config() const { return *m_config; }
+
+	  private:
+		// Copying would release twice
+		ReadGuard(const ReadGuard &);
+		ReadGuard &operator=(const ReadGuard &);
+
+		const IOConfigWatcher &m_watcher;
+		uint32_t m_readerIdx;	// which reader count we are in
+		const IOConfig *m_config;
+	};
+
+	// Called from our thread after a reload, once per subscribed entry
+	//		that changed.
+	// ioConfig: new config (valid during callback only)
+	// ioName: entry that changed.  ioConfig.Lookup(ioName) is NULL if the
+	//		entry was removed.
+	typedef boost::function<void (const IOConfig &ioConfig,
+							const IOConfig::IOName &ioName)> ChangeCallback;
+
+	// Call callback when entry ioName changes.  More than one callback
+	//		can subscribe to the same entry.
+	void Subscribe(const IOConfig::IOName &ioName,
+				   const ChangeCallback &callback);
+
+	// Parse config file now and publish it if it parses.  Normally called
+	//		by our thread when the file changes.  Safe from any thread: a
+	//		Reload waits for one in progress.  Not from a ChangeCallback.
+	// RETURNS: true if new config was published, false otherwise
+	bool Reload();
+
+	// RETURNS: number of reloads published since ctor
+	uint32_t Generation() const { return m_generation.load(); }
+
+  protected:
+	void *Worker(void *arg);
+
+  private:
+	// Wait until every ReadGuard that exists now has been destroyed
+	void Synchronize();
+
+	// Call subscribers for entries that differ between configs
+	void NotifyChanges(const IOConfig &oldConfig, const IOConfig &newConfig);
+
+	// How long Worker waits for inotify before checking for Stop
+	static const int POLL_TIMEOUT_MS = 200;
+	// Editors often write a file in several steps.  After a change,
+	// wait this long for more changes before we reload.
+	static const int SETTLE_MS = 50;
+
+	std::string m_fileNameFullPath;
+	std::string m_dirName;			// directory we watch
+	std::string m_baseName;			// file name in m_dirName
+	int m_inotifyFd;
+
+	// Current config, owned by us.  Readers load it inside a ReadGuard.
+	boost::atomic<const IOConfig *> m_config;
+	// Two reader counts.  New readers use m_readers[m_epoch & 1].
+	// Mutable: ReadGuard uses a const IOConfigWatcher.
+	mutable boost::atomic<uint32_t> m_epoch;
+	mutable boost::atomic<uint32_t> m_readers[2];
+	boost::atomic<uint32_t> m_generation;
+
+	typedef std::multimap<IOConfig::IOName, ChangeCallback> Subscribers;
+	Subscribers m_subscribers;
+	pthread_mutex_t m_lockSubscribers;	// recursive: callbacks may Subscribe
+	pthread_mutex_t m_lockReload;		// one Reload at a time
+};
@@ -0,0 +1,236 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+#include "boost/atomic.hpp"
+
+#include "common/b2bthread.h"
+#include "common/b2bassert.h"
+#include "log/B2BLog.h"
+
+#include "LifecycleTracer.h"
+
+/*static*/ const char * const LifecycleTracer::CATEGORY_INIT = "Init";
+/*static*/ const char * const LifecycleTracer::CATEGORY_START = "Start";
+/*static*/ const char * const LifecycleTracer::CATEGORY_STOP = "Stop";
+/*static*/ const char * const LifecycleTracer::CATEGORY_THREAD_CREATE =
+															"ThreadCreate";
+/*static*/ const char * const LifecycleTracer::CATEGORY_FIRST_WORKER =
+															"FirstWorker";
+
+// Event storage.  Record claims a slot with one atomic add, fills it, then
+// marks it committed so readers never see a half written event.  All of
+// these are zero before main runs (static storage), no ctor needed.
+static LifecycleTracer::Event s_events[LifecycleTracer::MAX_EVENTS];
+static boost::atomic<bool> s_committed[LifecycleTracer::MAX_EVENTS];
+static boost::atomic<uint32_t> s_numEvents(0);	// slots claimed
+static boost::atomic<uint32_t> s_numDropped(0);
+static boost::atomic<bool> s_enabled(true);
+
+/*static*/ void LifecycleTracer::SetEnabled(bool enabled)
+{
+	s_enabled.store(enabled);
+}
+
+/*static*/ bool LifecycleTracer::IsEnabled()
+{
+	return s_enabled.load(boost::memory_order_relaxed);
+}
+
+/*static*/ uint64_t LifecycleTracer::TimeValueToNS(
+										const B2BTime::TimeValue &time)
+{
+	struct timespec ts = time.ConvertToTimespec();
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/*static*/ void LifecycleTracer::Record(const char *category,
+										const char *name,
+										const B2BTime::TimeValue &begin,
+										const B2BTime::TimeValue &end)
+{
+	b2bassert(category && name);
+
+	if (!IsEnabled())
+		return;
+
+	uint32_t idx = s_numEvents.fetch_add(1, boost::memory_order_relaxed);
+	if (idx >= MAX_EVENTS) {
+		s_numDropped.fetch_add(1, boost::memory_order_relaxed);
+		return; // FAIL: full
+	}
+
+	Event &event = s_events[idx];
+	event.category = category;
+	strncpy(event.name, name, MAX_NAME_LEN);
+	event.name[MAX_NAME_LEN] = '\0';
+	event.beginNS = TimeValueToNS(begin);
+	event.endNS = TimeValueToNS(end);
+	event.tid = gettid();
+	s_committed[idx].store(true, boost::memory_order_release);
+}
+
+// Sort events by begin time
+static bool EventBeginLess(const LifecycleTracer::Event &a,
+						   const LifecycleTracer::Event &b)
+{
+	return a.beginNS < b.beginNS;
+}
+
+/*static*/ uint32_t LifecycleTracer::GetEvents(std::vector<Event> *pEvents)
+{
+	b2bassert(pEvents);
+
+	uint32_t numEvents = std::min(s_numEvents.load(), MAX_EVENTS);
+	pEvents->clear();
+	pEvents->reserve(numEvents);
+	for (uint32_t i = 0; i < numEvents; ++i) {
+		// Skip events still being written
+		if (s_committed[i].load(boost::memory_order_acquire))
+			pEvents->push_back(s_events[i]);
+	}
+	std::stable_sort(pEvents->begin(), pEvents->end(), EventBeginLess);
+
+	return s_numDropped.load();
+}
+
+/*static*/ void LifecycleTracer::Clear()
+{
+	uint32_t numEvents = std::min(s_numEvents.load(), MAX_EVENTS);
+	for (uint32_t i = 0; i < numEvents; ++i)
+		s_committed[i].store(false);
+	s_numDropped.store(0);
+	s_numEvents.store(0);
+}
+
+// Write str as the inside of a json string
+static void WriteJSONString(FILE *file, const char *str)
+{
+	for (; *str; ++str) {
+		unsigned char c = *str;
+		if ((c == '"') || (c == '\\'))
+			fprintf(file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(file, "\\u%04x", c);
+		else
+			fputc(c, file);
+	}
+}
+
+/*static*/ bool LifecycleTracer::WriteChromeTrace(const char *fileName,
+												  std::string *pErr)
+{
+	b2bassert(fileName && pErr);
+
+	std::vector<Event> events;
+	uint32_t numDropped = GetEvents(&events);
+
+	FILE *file = fopen(fileName, "w");
+	if (!file) {
+		*pErr = std::string("fopen FAIL: ") + strerror(errno);
+		return false; // FAIL
+	}
+
+	// Times are microseconds from first event
+	uint64_t zeroNS = events.empty() ? 0 : events[0].beginNS;
+	int pid = getpid();
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (size_t i = 0; i < events.size(); ++i) {
+		const Event &event = events[i];
+		fprintf(file, "%s\n{\"name\":\"", i ? "," : "");
+		WriteJSONString(file, event.name);
+		fprintf(file, "\",\"cat\":\"");
+		WriteJSONString(file, event.category);
+		fprintf(file,
+			"\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			pid, (int)event.tid, (event.beginNS - zeroNS) / 1000.0,
+			(event.endNS - event.beginNS) / 1000.0);
+	}
+	fprintf(file, "\n],\"otherData\":{\"droppedEvents\":%u}}\n", numDropped);
+
+	if (ferror(file) || (fclose(file) != 0)) {
+		*pErr = std::string("write FAIL: ") + strerror(errno);
+		return false; // FAIL
+	}
+
+	if (numDropped) {
+		B2BLog::Warn(LogFilt::LM_APP,
+					 "LifecycleTracer: %u events dropped, MAX_EVENTS is %u",
+					 numDropped, MAX_EVENTS);
+	}
+
+	return true; // SUCCESS
+}
+
+/*static*/ bool LifecycleTracer::GetCriticalPath(std::vector<Event> *pPath)
+{
+	b2bassert(pPath);
+
+	pPath->clear();
+	std::vector<Event> events;
+	GetEvents(&events);
+	if (events.empty())
+		return false; // FAIL: nothing recorded
+
+	// Start from the span that ended last
+	size_t current = 0;
+	for (size_t i = 1; i < events.size(); ++i) {
+		if (events[i].endNS > events[current].endNS)
+			current = i;
+	}
+
+	for (;;) {
+		pPath->push_back(events[current]);
+
+		// Span that ended last before current began is what it waited on.
+		// Spans that contain current (its Start around its pthread_create
+		// say) end after it began so are never picked.
+		size_t previous = events.size();
+		for (size_t i = 0; i < events.size(); ++i) {
+			if ((events[i].endNS <= events[current].beginNS) &&
+				((previous == events.size()) ||
+				 (events[i].endNS > events[previous].endNS)))
+			{
+				previous = i;
+			}
+		}
+		if (previous == events.size())
+			break; // reached start
+		current = previous;
+	}
+
+	std::reverse(pPath->begin(), pPath->end());
+	return true; // SUCCESS
+}
+
+/*static*/ void LifecycleTracer::LogCriticalPath()
+{
+	std::vector<Event> path;
+	if (!GetCriticalPath(&path)) {
+		B2BLog::Info(LogFilt::LM_APP, "LifecycleTracer: no events");
+		return;
+	}
+
+	std::vector<Event> events;
+	GetEvents(&events);
+	uint64_t zeroNS = events[0].beginNS;
+	double totalMS = (path.back().endNS - zeroNS) / 1000000.0;
+
+	B2BLog::Info(LogFilt::LM_APP,
+				 "LifecycleTracer: critical path %d spans, %.3f ms total",
+				 (int)path.size(), totalMS);
+	uint64_t prevEndNS = zeroNS;
+	for (size_t i = 0; i < path.size(); ++i) {
+		const Event &event = path[i];
+		double spanMS = (event.endNS - event.beginNS) / 1000000.0;
+		double idleMS = (event.beginNS - prevEndNS) / 1000000.0;
+		B2BLog::Info(LogFilt::LM_APP,
+					 "  %-12s %-32s %9.3f ms %5.1f%%  (%.3f ms idle before)",
+					 event.category, event.name, spanMS,
+					 totalMS ? (100.0 * spanMS / totalMS) : 0.0, idleMS);
+		prevEndNS = event.endNS;
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+//
+// LifecycleTracer: records where startup and shutdown time goes.
+//		B2BModuleManager records every module's Init, Start and Stop,
+//		ThreadModule records thread creation and how long the thread takes
+//		to get to its first Worker call,
+//		and any code can add its own span (see Span).  Events go into a
+//		fixed array with no lock and no allocation, so recording is safe
+//		from any thread and cheap enough to leave on.
+//
+//		After startup (or shutdown) call WriteChromeTrace and open the file
+//		in chrome://tracing or https://ui.perfetto.dev, or LogCriticalPath
+//		to see which chain of spans the total time was spent waiting on.
+//
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+#include "common/B2BTime.h"
+
+class LifecycleTracer {
+  public:
+	// Events past this many are dropped (and counted)
+	static const uint32_t MAX_EVENTS = 4096;
+	// Longer names are cut
+	static const size_t MAX_NAME_LEN = 47;
+
+	struct Event {
+		const char *category;	// "Init", "Start", ... (static string)
+		char name[MAX_NAME_LEN+1];	// usually module name
+		uint64_t beginNS;		// GetCurrTimeMonotonic in nanoseconds
+		uint64_t endNS;
+		pid_t tid;				// thread that recorded event
+	};
+
+	// Turn recording on or off.  Default is on.
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// Record one span.  Safe to call from any thread.
+	// category: kind of span.  Must be a static string, only the pointer
+	//		is kept.  See CATEGORY_xxx for ones we use.
+	// name: what the span is for, copied
+	static void Record(const char *category, const char *name,
+					   const B2BTime::TimeValue &begin,
+					   const B2BTime::TimeValue &end);
+
+	// Records a span from its ctor to its dtor, for example:
+	//		{
+	//			LifecycleTracer::Span span("Parse", "IOConfig");
+	//			...
+	//		}
+	class Span {
+	  public:
+		Span(const char *category, const char *name) :
+			m_category(category), m_name(name),
+			m_begin(B2BTime::GetCurrTimeMonotonic())
+		{}
+		~Span()
+		{
+			Record(m_category, m_name, m_begin,
+				   B2BTime::GetCurrTimeMonotonic());
+		}
+
+	  private:
+		const char *m_category;
+		const char *m_name;
+		B2BTime::TimeValue m_begin;
+	};
+
+	// Categories recorded by B2BModuleManager and ThreadModule
+	static const char * const CATEGORY_INIT;
+	static const char * const CATEGORY_START;
+	static const char * const CATEGORY_STOP;
+	static const char * const CATEGORY_THREAD_CREATE;	// pthread_create
+	static const char * const CATEGORY_FIRST_WORKER;	// create to first Worker call
+
+	// Copy every event recorded so far.
+	// pEvents: filled sorted by beginNS
+	// RETURNS: number of events dropped because MAX_EVENTS was reached
+	static uint32_t GetEvents(std::vector<Event> *pEvents);
+
+	// Forget all events.  Only call when nothing else is recording.
+	static void Clear();
+
+	// Write all events as a Chrome trace event json file.
+	// fileName: full path of file to write
+	// pErr: errors, only valid if method returns false
+	// RETURNS: true on success, false otherwise.
+	static bool WriteChromeTrace(const char *fileName, std::string *pErr);
+
+	// Find the chain of spans that the last span to finish was waiting on.
+	//		Starting from the span that ended last, the one before it is the
+	//		span that ended last before it began, and so on.  Spans that
+	//		run in parallel with the chain are not on it, speeding them up
+	//		does not make startup shorter.
+	// pPath: filled with spans on critical path, earliest first
+	// RETURNS: true on success, false if there are no events
+	static bool GetCriticalPath(std::vector<Event> *pPath);
+
+	// Log GetCriticalPath with each span's time, the idle time before
+	//		it, and its share of the total.
+	static void LogCriticalPath();
+
+  private:
+	// RETURNS: time in nanoseconds
+	static uint64_t TimeValueToNS(const B2BTime::TimeValue &time);
+};
@@ -0,0 +1,413 @@
+#pragma once
+//
+// MultiLaneExecuteList: generic base class for executing several lists at
+//		the same time, one per lane, on a shared pool of threads.
+//		Each entry in execute list is described by an ENTRY and
+//			its data structure is ENTRY_INTERNAL.
+//		WARNING: Client must call Init() and Start() to enable this class.
+//
+//		A lane is like one ExecuteListInThread: it executes one list at a
+//		time, in order, and has its own DoneCallback.  Lanes are
+//		independent, for example ambient sound and speech, or two display
+//		regions.  Lanes are not tied to threads: a thread takes a lane
+//		that has work, executes one entry, and puts the lane back at the
+//		end of the line.  So dozens of lanes need only as many threads as
+//		entries that should execute at the same time.  A lane never has
+//		two entries executing at once.
+//
+//		Lanes have no priorities or queue (see ExecuteListInThread for
+//		those).
+//
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "boost/function.hpp"
+#include "boost/shared_ptr.hpp"
+
+#include "common/b2bassert.h"
+#include "log/B2BLog.h"
+
+#include "ExecuteListType.h"
+
+#include "B2BModule.h"
+#include "WorkerPool.h"
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+class MultiLaneExecuteList : public B2BModule {
+  public:
+	typedef uint32_t LaneId;	// 0 to NumLanes()-1
+
+	// name: module name, also used for pool threads
+	// numLanes: number of lanes
+	// numThreads: number of pool threads, most entries that execute at
+	//		the same time.  0 is treated as 1.
+	MultiLaneExecuteList(const char *name, uint32_t numLanes,
+						 uint32_t numThreads);
+	virtual ~MultiLaneExecuteList();
+
+	// START: B2BModule virtuals.  See B2BModule for documentation
+	// Start creates the pool threads
+	bool Start(void *arg);
+	// Stop waits for entries executing to finish and stops the pool
+	// threads.  Then, in Stop's thread, lists left in lanes and lists
+	// StopExecuting stopped call their doneCallback(DONEREASON_STOP).
+	bool Stop(void **returnVal);
+	// END: B2BModule virtuals
+
+	// Same as ExecuteListInThread::ExecuteList and Execute, for lane.
+	// Fails and returns false if lane is not valid.
+	// doneCallback: same as pDoneCallback, for the versions that take a
+	//		DoneDelegate.  It is copied, caller need not keep it.
+	// An empty list completes right away, even if loopExecList is true.
+	typedef std::vector<ENTRY> ExecList;
+	typedef std::vector<ENTRY_INTERNAL> ExecListInternal;
+	typedef boost::function<bool (const ExecList &execList, ExecListInternal *pNewInternalList)> BuildExecListInternal;
+
+	bool ExecuteList(LaneId lane, const char *label,
+					const ExecList &execList,
+					BuildExecListInternal &buildExecListInternal,
+					bool loopExecList=false,
+					const ExecuteListType::DoneCallback *pDoneCallback=NULL)
+	{
+		return ExecuteList(lane, label, execList, buildExecListInternal,
+							loopExecList,
+							ExecuteListType::ToDoneDelegate(pDoneCallback));
+	}
+	bool ExecuteList(LaneId lane, const char *label,
+					const ExecList &execList,
+					BuildExecListInternal &buildExecListInternal,
+					bool loopExecList,
+					const ExecuteListType::DoneDelegate &doneCallback);
+
+	bool Execute(LaneId lane, const char *label, ENTRY entry,
+					BuildExecListInternal &buildExecListInternal,
+					bool loopExecList=false,
+					const ExecuteListType::DoneCallback *pDoneCallback=NULL)
+	{
+		return Execute(lane, label, entry, buildExecListInternal,
+						loopExecList,
+						ExecuteListType::ToDoneDelegate(pDoneCallback));
+	}
+	bool Execute(LaneId lane, const char *label, ENTRY entry,
+					BuildExecListInternal &buildExecListInternal,
+					bool loopExecList,
+					const ExecuteListType::DoneDelegate &doneCallback)
+	{
+		ExecList execList;
+		execList.push_back(entry);
+		return ExecuteList(lane, label, execList, buildExecListInternal,
+							loopExecList, doneCallback);
+	}
+
+	// Same as ExecuteListInThread::StopExecuting, for lane.  Other lanes
+	// keep executing.
+	// If executeCallback is false, a pool thread calls
+	// doneCallback(DONEREASON_STOP).
+	// RETURNS: true on success, false if lane is not valid
+	bool StopExecuting(LaneId lane, ExecuteListType::DoneReason reason,
+						bool executeCallback=false,
+						bool logInfo=false);
+
+	// Returns true if lane is executing a list, false otherwise
+	bool IsExecuting(LaneId lane) const;
+
+	uint32_t NumLanes() const { return m_lanes.size(); }
+	uint32_t NumThreads() const { return m_pool.NumThreads(); }
+
+  protected:
+	// Called in a pool thread to execute one entry of lane's list.  Called
+	// for different lanes at the same time, never for one lane at once.
+	// RETURNS: true if lane should keep executing its list, false if lane
+	//			should stop the list
+	virtual bool WorkerExecute(LaneId lane, const ENTRY_INTERNAL &entry) = 0;
+
+  private:
+	struct Lane {
+		Lane() : loopExecList(false), pos(0), generation(0),
+				 running(false), ready(false) {}
+
+		// List executing, empty if none
+		boost::shared_ptr<const ExecListInternal> execList;
+		bool loopExecList;
+		ExecuteListType::DoneDelegate doneCallback;
+		// Callbacks of lists StopExecuting stopped, for a pool thread to
+		// call with DONEREASON_STOP
+		std::vector<ExecuteListType::DoneDelegate> stoppedCallbacks;
+		size_t pos;				// next entry to execute
+		uint32_t generation;	// bumped when execList is replaced
+		bool running;			// a pool thread is executing an entry
+		bool ready;				// in m_ready
+	};
+
+	// Put lane in m_ready if it has something to do and isn't there.
+	// Called with m_lock held.
+	void MakeReady(LaneId lane);
+
+	// WorkerPool::Work: wait for a ready lane and execute its next entry.
+	// Returns without doing anything once Stop is called.
+	void RunLane(uint32_t thread);
+
+	std::vector<Lane> m_lanes;
+	std::deque<LaneId> m_ready;		// lanes with work, in order
+	mutable pthread_mutex_t m_lock;	// for all of the above, and m_pool's quit
+	pthread_cond_t m_readyCond;		// signalled when m_ready, or by m_pool.Stop
+	WorkerPool m_pool;
+};
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::MultiLaneExecuteList(
+								const char *name, uint32_t numLanes,
+								uint32_t numThreads) :
+  B2BModule(name),
+  m_lanes(numLanes),
+  m_pool(name, numThreads ? numThreads : 1,
+		 WorkerPool::Work(this, &MultiLaneExecuteList::RunLane),
+		 &m_lock, &m_readyCond)
+{
+	pthread_mutex_init(&m_lock, NULL);
+	pthread_cond_init(&m_readyCond, NULL);
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::~MultiLaneExecuteList()
+{
+	Stop(NULL); // Stop our threads
+
+	pthread_cond_destroy(&m_readyCond);
+	pthread_mutex_destroy(&m_lock);
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::Start(void *arg)
+{
+	return m_pool.Start(arg);
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::Stop(void **returnVal)
+{
+	bool success = m_pool.Stop();
+
+	// No pool thread is left to call the callbacks StopExecuting queued,
+	// or to finish lists still in lanes.  Take them all and report STOP
+	// here.
+	std::vector<ExecuteListType::DoneDelegate> callbacks;
+	pthread_mutex_lock(&m_lock);
+	for (size_t lane = 0; lane < m_lanes.size(); ++lane) {
+		Lane &laneState = m_lanes[lane];
+		callbacks.insert(callbacks.end(), laneState.stoppedCallbacks.begin(),
+						 laneState.stoppedCallbacks.end());
+		laneState.stoppedCallbacks.clear();
+		if (laneState.execList) {
+			if (!laneState.doneCallback.empty())
+				callbacks.push_back(laneState.doneCallback);
+			laneState.execList.reset();
+			laneState.doneCallback.clear();
+			++laneState.generation;
+		}
+		laneState.ready = false;
+	}
+	m_ready.clear();
+	pthread_mutex_unlock(&m_lock);
+
+	for (size_t i = 0; i < callbacks.size(); ++i)
+		callbacks[i](ExecuteListType::DONEREASON_STOP);
+
+	if (success && returnVal)
+		*returnVal = NULL;
+
+	return success;
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::ExecuteList(LaneId lane,
+					const char *label,
+					const ExecList &execList,
+					BuildExecListInternal &buildExecListInternal,
+					bool loopExecList,
+					const ExecuteListType::DoneDelegate &doneCallback)
+{
+	if (lane >= m_lanes.size()) {
+		B2BLog::Err(LogFilt::LM_APP, "%s(%u): bad lane, %s has %u lanes",
+					label, (unsigned)lane, Name(), (unsigned)m_lanes.size());
+		return false; // FAIL
+	}
+
+	// Build list without the lock, it may take its time
+	boost::shared_ptr<ExecListInternal> newList(new ExecListInternal);
+	if (!(buildExecListInternal)(execList, newList.get()))
+		return false; // FAIL
+
+	pthread_mutex_lock(&m_lock);
+	Lane &laneState = m_lanes[lane];
+	ExecuteListType::DoneDelegate replacedCallback;
+	if (laneState.execList) {
+		if (!laneState.loopExecList) {
+			// Lane is already executing a list and it is not looping.
+			// This is not allowed.
+			pthread_mutex_unlock(&m_lock);
+			B2BLog::Info(LogFilt::LM_APP, "%s(%u,%d) ignored because lane is already busy executing a previous list.",
+				label, (unsigned)lane, (int)execList.size());
+			return false;  // FAIL
+		}
+		// Cancel looping list
+		replacedCallback = laneState.doneCallback;
+	}
+
+	laneState.execList = newList;
+	laneState.loopExecList = loopExecList;
+	laneState.doneCallback = doneCallback;
+	laneState.pos = 0;
+	++laneState.generation;	// entry executing now is from old list
+	MakeReady(lane);
+	pthread_mutex_unlock(&m_lock);
+
+	if (!replacedCallback.empty()) {
+		B2BLog::Debug(LogFilt::LM_APP, "%s::ExecuteList(%u): %s replaces loop",
+					  Name(), (unsigned)lane, label);
+		replacedCallback(ExecuteListType::DONEREASON_NEWSTART);
+	}
+
+	return true; // SUCCESS
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::StopExecuting(LaneId lane,
+								ExecuteListType::DoneReason reason,
+								bool executeCallback, bool logInfo)
+{
+	if (lane >= m_lanes.size()) {
+		B2BLog::Err(LogFilt::LM_APP, "%s::StopExecuting(%u): bad lane",
+					Name(), (unsigned)lane);
+		return false; // FAIL
+	}
+
+	pthread_mutex_lock(&m_lock);
+	Lane &laneState = m_lanes[lane];
+	if (!laneState.execList) {
+		// We're not executing, exit immediately
+		pthread_mutex_unlock(&m_lock);
+		return true;
+	}
+	size_t size = laneState.execList->size();
+	ExecuteListType::DoneDelegate callback = laneState.doneCallback;
+	laneState.execList.reset();
+	laneState.doneCallback.clear();
+	++laneState.generation;
+	if (!executeCallback && !callback.empty()) {
+		// Pool thread calls it
+		laneState.stoppedCallbacks.push_back(callback);
+		callback.clear();
+		MakeReady(lane);
+	}
+	pthread_mutex_unlock(&m_lock);
+
+	if (logInfo) {
+		B2BLog::Info(LogFilt::LM_APP, "%s::StopExecuting(%u,%s) (execList.size=%u)",
+				Name(), (unsigned)lane,
+				ExecuteListType::DoneReasonToString(reason), (unsigned)size);
+	} else {
+		B2BLog::Debug(LogFilt::LM_APP, "%s::StopExecuting(%u,%s) (execList.size=%u)",
+				Name(), (unsigned)lane,
+				ExecuteListType::DoneReasonToString(reason), (unsigned)size);
+	}
+
+	if (!callback.empty())
+		callback(reason);
+
+	return true;
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+bool MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::IsExecuting(
+													LaneId lane) const
+{
+	if (lane >= m_lanes.size())
+		return false;
+
+	pthread_mutex_lock(&m_lock);
+	bool executing = (m_lanes[lane].execList.get() != NULL);
+	pthread_mutex_unlock(&m_lock);
+
+	return executing;
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::MakeReady(LaneId lane)
+{
+	Lane &laneState = m_lanes[lane];
+	// A running lane is made ready by its thread when its entry is done
+	if (laneState.ready || laneState.running)
+		return;
+	if (!laneState.execList && laneState.stoppedCallbacks.empty())
+		return; // nothing to do
+
+	laneState.ready = true;
+	m_ready.push_back(lane);
+	pthread_cond_signal(&m_readyCond);
+}
+
+template <typename ENTRY, typename ENTRY_INTERNAL>
+void MultiLaneExecuteList<ENTRY, ENTRY_INTERNAL>::RunLane(uint32_t thread)
+{
+	pthread_mutex_lock(&m_lock);
+	while (m_ready.empty() && !m_pool.IsQuitting())
+		pthread_cond_wait(&m_readyCond, &m_lock);
+	if (m_pool.IsQuitting()) {
+		pthread_mutex_unlock(&m_lock);
+		return;
+	}
+
+	LaneId lane = m_ready.front();
+	m_ready.pop_front();
+	Lane &laneState = m_lanes[lane];
+	laneState.ready = false;
+	laneState.running = true;
+	std::vector<ExecuteListType::DoneDelegate> stoppedCallbacks;
+	stoppedCallbacks.swap(laneState.stoppedCallbacks);
+	// Our own reference, ExecuteList may replace the lane's list while
+	// we execute this one's entry
+	boost::shared_ptr<const ExecListInternal> execList = laneState.execList;
+	uint32_t generation = laneState.generation;
+	size_t pos = laneState.pos;
+	pthread_mutex_unlock(&m_lock);
+
+	for (size_t i = 0; i < stoppedCallbacks.size(); ++i)
+		stoppedCallbacks[i](ExecuteListType::DONEREASON_STOP);
+
+	bool keepExecuting = true;
+	if (execList && (pos < execList->size()))
+		keepExecuting = WorkerExecute(lane, (*execList)[pos++]);
+
+	pthread_mutex_lock(&m_lock);
+	laneState.running = false;
+	ExecuteListType::DoneDelegate doneCallback;
+	ExecuteListType::DoneReason reason = ExecuteListType::DONEREASON_COMPLETE;
+	if (execList && (laneState.generation == generation)) {
+		// Lane still has our list
+		laneState.pos = pos;
+		bool finished = false;
+		if (!keepExecuting) {
+			// WorkerExecute returns false if we should stop executing
+			reason = ExecuteListType::DONEREASON_STOP;
+			finished = true;
+		} else if (pos >= execList->size()) {
+			if (laneState.loopExecList && !execList->empty())
+				laneState.pos = 0; // next pass
+			else
+				finished = true; // FINISHED: Done executing list
+		}
+		if (finished) {
+			doneCallback = laneState.doneCallback;
+			laneState.execList.reset();
+			laneState.doneCallback.clear();
+			++laneState.generation;
+		}
+	} // else: replaced or stopped while we executed, already reported
+	MakeReady(lane);	// back of the line, if there is more to do
+	pthread_mutex_unlock(&m_lock);
+
+	if (!doneCallback.empty())
+		doneCallback(reason);
+}
@@ -5,6 +5,7 @@
 #include "common/b2bthread.h"
 #include "common/b2bassert.h"
 #include "log/B2BLog.h"
+#include "apps/common/LifecycleTracer.h"
 
 
 ThreadModule::ThreadModule(const char *name) :
@@ -31,7 +32,8 @@ bool ThreadModule::Start(void *arg)
 
 	m_threadState.m_arg = arg;
 
-    // Create our thread
+    // Create our thread.  Set m_createTime first, our thread reads it.
+	m_threadState.m_createTime = B2BTime::GetCurrTimeMonotonic();
     int result = pthread_create(&m_threadState.m_thread, NULL, WorkerInternal,
 								this);
     if (result) {
@@ -43,6 +45,9 @@ bool ThreadModule::Start(void *arg)
     }
 
 	m_threadState.m_created = true;
+	LifecycleTracer::Record(LifecycleTracer::CATEGORY_THREAD_CREATE, Name(),
+							m_threadState.m_createTime,
+							B2BTime::GetCurrTimeMonotonic());
 
 	return true;
 }
@@ -51,6 +56,7 @@ bool ThreadModule::Stop(void **returnVal)
 {
 	if (m_threadState.m_created) {
 		SendThreadCancelRequest();
+		WakeWorker(); // in case Worker is waiting
 		// Wait for thread to quit.  We wait because I want all threads
 		// to end cleanly.  Specifically, I want derived classes to exit
 		// their Worker functions when their Stop is called.
@@ -94,6 +100,13 @@ bool ThreadModule::WaitForThreadToStart(pid_t *pTID,
     B2BLog::Debug(LogFilt::LM_OS, "ThreadModule %s tid: %d",
 									tm->Name(), (int)tm->m_threadState.m_tid);
 
+	// Time from pthread_create to first Worker call, for startup trace.
+	// Not to first Worker done: many Workers wait for work, and that
+	// idle time would look like startup.
+	LifecycleTracer::Record(LifecycleTracer::CATEGORY_FIRST_WORKER,
+							tm->Name(), tm->m_threadState.m_createTime,
+							B2BTime::GetCurrTimeMonotonic());
+
 	void *returnVal = NULL;
 	while (!tm->IsThreadCancelRequested()) {
 		returnVal = tm->Worker(tm->m_threadState.m_arg);
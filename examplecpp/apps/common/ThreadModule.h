@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <pthread.h>
 
+#include "common/B2BTime.h"
 #include "apps/common/B2BModule.h"
 
 class ThreadModule : public B2BModule {
@@ -47,6 +48,13 @@ class ThreadModule : public B2BModule {
 	// If Worker returns, then the thread exits.
 	virtual void *Worker(void *arg) = 0;
 
+	// Called by Stop right after it requests cancel, in Stop's thread.
+	// Override if Worker waits on something (a condition, an fd): wake it
+	// so it sees IsThreadCancelRequested and returns.  Take the same lock
+	// Worker checks IsThreadCancelRequested under, then the wake can't be
+	// missed.  Default does nothing, for a Worker that never waits long.
+	virtual void WakeWorker() {}
+
 	bool WaitForThreadToStart(pid_t *pTID, useconds_t sleepPeriodUS) const;
 
   protected:
@@ -75,6 +83,7 @@ class ThreadModule : public B2BModule {
 		  }
 
     	void *m_arg; 			// the thread's arg parameter
+		B2BTime::TimeValue m_createTime;	// when Start called pthread_create
     	pthread_t m_thread;		// the thread
     	pid_t m_tid;			// the thread's tid
     	bool m_created;			// true if thread was created
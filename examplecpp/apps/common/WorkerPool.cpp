@@ -0,0 +1,56 @@
+#include "common/b2bassert.h"
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(const char *name, uint32_t numThreads,
+					   const Work &work, pthread_mutex_t *pLock,
+					   pthread_cond_t *pCond) :
+	m_work(work),
+	m_pLock(pLock),
+	m_pCond(pCond),
+	m_quit(false)
+{
+	b2bassert(pLock && pCond);
+
+	for (uint32_t thread = 0; thread < numThreads; ++thread)
+		m_threads.push_back(new PoolThread(name, this, thread));
+}
+
+WorkerPool::~WorkerPool()
+{
+	for (size_t i = 0; i < m_threads.size(); ++i)
+		delete m_threads[i];
+}
+
+bool WorkerPool::Start(void *arg)
+{
+	pthread_mutex_lock(m_pLock);
+	m_quit = false;
+	pthread_mutex_unlock(m_pLock);
+
+	for (size_t i = 0; i < m_threads.size(); ++i) {
+		if (!m_threads[i]->Start(arg)) {
+			Stop();
+			return false; // FAIL
+		}
+	}
+
+	return true; // SUCCESS
+}
+
+bool WorkerPool::Stop()
+{
+	// Wake threads waiting in Work so they see m_quit
+	pthread_mutex_lock(m_pLock);
+	m_quit = true;
+	pthread_cond_broadcast(m_pCond);
+	pthread_mutex_unlock(m_pLock);
+
+	bool success = true;
+	for (size_t i = 0; i < m_threads.size(); ++i) {
+		if (!m_threads[i]->Stop(NULL))
+			success = false; // thread not started
+	}
+
+	return success;
+}
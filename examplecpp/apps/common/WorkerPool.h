@@ -0,0 +1,76 @@
+#pragma once
+//
+// WorkerPool: a fixed set of threads that each call one Work function
+//		over and over, for modules that spread their work over several
+//		threads (MultiLaneExecuteList, SensorPollScheduler).
+//
+//		The owner keeps its work, and the lock and condition its threads
+//		wait on.  Work waits under that lock for something to do, does it
+//		and returns; once IsQuitting it returns without waiting.  Stop
+//		sets IsQuitting and broadcasts the condition under the lock, so a
+//		waiting Work sees it, then joins the threads.
+//
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include "common/Delegate.h"
+
+#include "ThreadModule.h"
+
+class WorkerPool {
+  public:
+	// Called in pool thread over and over, until Stop
+	// thread: 0 to NumThreads()-1
+	typedef Delegate<void (uint32_t thread)> Work;
+
+	// name: name of our threads
+	// numThreads: can be 0, then Start and Stop have nothing to do
+	// work: copied
+	// pLock, pCond: owner's, Work waits on them.  Must outlive us.
+	WorkerPool(const char *name, uint32_t numThreads, const Work &work,
+			   pthread_mutex_t *pLock, pthread_cond_t *pCond);
+	// Owner must Stop us first: our threads use its lock
+	~WorkerPool();
+
+	// Start our threads.  If one fails, those started are stopped.
+	// arg: passed to ThreadModule::Start
+	// RETURNS: true on success, false otherwise
+	bool Start(void *arg);
+	// Wake Work and stop our threads.  Returns when they have quit.
+	// RETURNS: true on success, false if a thread was not started
+	bool Stop();
+
+	// RETURNS: true from Stop until next Start.  Call with owner's lock
+	//			held.
+	bool IsQuitting() const { return m_quit; }
+
+	uint32_t NumThreads() const { return m_threads.size(); }
+
+  private:
+	// One of our threads.  Worker calls pool's Work.
+	class PoolThread : public ThreadModule {
+	  public:
+		PoolThread(const char *name, WorkerPool *pool, uint32_t thread) :
+			ThreadModule(name), m_pool(pool), m_thread(thread) {}
+		~PoolThread() { Stop(NULL); }
+		bool Init() { return true; }
+
+	  protected:
+		void *Worker(void *arg) { m_pool->m_work(m_thread); return NULL; }
+
+	  private:
+		WorkerPool *m_pool;
+		uint32_t m_thread;
+	};
+
+	// Copying would share threads
+	WorkerPool(const WorkerPool &);
+	WorkerPool &operator=(const WorkerPool &);
+
+	std::vector<PoolThread *> m_threads;
+	Work m_work;
+	pthread_mutex_t *m_pLock;	// owner's, for m_quit
+	pthread_cond_t *m_pCond;	// owner's, broadcast by Stop
+	bool m_quit;				// set by Stop
+};
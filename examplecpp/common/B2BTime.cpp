@@ -17,6 +17,13 @@ B2BTime::TimeValue B2BTime::GetCurrTimeMonotonic()
 	return currentTime;
 }
 
+uint64_t B2BTime::GetCurrTimeMonotonicNS()
+{
+	struct timespec timestamp;
+	clock_gettime(CLOCK_MONOTONIC, &timestamp);
+	return ((uint64_t)timestamp.tv_sec * 1000000000ULL) + timestamp.tv_nsec;
+}
+
 b2b::Timestamp B2BTime::GetCurrentB2BTimestamp()
 {
 	return GetCurrTimeMonotonic().ConvertToMSec();
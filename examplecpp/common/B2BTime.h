@@ -158,6 +158,10 @@ namespace B2BTime {
 	//				functions for "wall clock".
 	TimeValue GetCurrTimeMonotonic();
 
+	// Same clock as GetCurrTimeMonotonic(), in nanoseconds.  For timing
+	// hot paths and absolute deadlines: no TimeValue to build or convert.
+	uint64_t GetCurrTimeMonotonicNS();
+
 	// Returns the current time as a b2b::Timestamp.   Uses CurrTimeMonotonic()
 	b2b::Timestamp GetCurrentB2BTimestamp();
 
@@ -0,0 +1,210 @@
+#pragma once
+//
+// Delegate: callback like boost::function, that never allocates.
+//		The function, method or function object is stored inside the
+//		Delegate, in STORAGE_SIZE bytes.  One too big doesn't compile (the
+//		BOOST_STATIC_ASSERT in Store fails), so a Delegate never goes to
+//		the heap.  Calling it is one call through a function pointer to a
+//		wrapper the compiler can inline the target into.
+//
+//		Bind with:
+//			Delegate<bool (void *)> d(&Function);			// function
+//			Delegate<bool (void *)> d(this, &Foo::Method);	// method
+//			Delegate<bool (void *)> d(boost::bind(...));	// function object
+//			Delegate<bool (void *)> d(boostFunction);		// boost::function
+//		A method Delegate holds just the object pointer and the method
+//		pointer.  The caller must keep the object alive.
+//
+//		Only one argument signatures, R (A1), so far.
+//
+#include <stddef.h>
+#include <new>
+
+#include "boost/static_assert.hpp"
+#include "boost/type_traits/alignment_of.hpp"
+
+#include "common/b2bassert.h"
+
+// Holds whatever a Delegate binds, and copies and destroys it.  Not used
+// directly.
+template <size_t STORAGE_SIZE>
+class DelegateStorage {
+  protected:
+	// Big enough and aligned for anything that fits in STORAGE_SIZE
+	union Storage {
+		char bytes[STORAGE_SIZE];
+		void *pointer;
+		long long integer;
+		double number;
+		void (*function)();
+	};
+
+	DelegateStorage() : m_manage(NULL) {}
+	DelegateStorage(const DelegateStorage &other) : m_manage(other.m_manage)
+	{
+		if (m_manage)
+			m_manage(MANAGE_COPY, &m_storage, &other.m_storage);
+	}
+	~DelegateStorage() { Reset(); }
+
+	DelegateStorage &operator=(const DelegateStorage &other)
+	{
+		if (this != &other) {
+			Reset();
+			if (other.m_manage)
+				other.m_manage(MANAGE_COPY, &m_storage, &other.m_storage);
+			m_manage = other.m_manage;
+		}
+		return *this;
+	}
+
+	// Copy f into our storage.  Only call when empty.
+	template <typename F>
+	void Store(const F &f)
+	{
+		// F too big for this Delegate: make STORAGE_SIZE bigger, or bind
+		// fewer arguments
+		BOOST_STATIC_ASSERT(sizeof(F) <= STORAGE_SIZE);
+		BOOST_STATIC_ASSERT(boost::alignment_of<F>::value <=
+							boost::alignment_of<Storage>::value);
+		b2bassert(!m_manage);
+		new (m_storage.bytes) F(f);
+		m_manage = &Manage<F>;
+	}
+
+	// Stored F.  Calling it may change it (boost::bind can), so callable
+	// from our const operator()
+	template <typename F>
+	static F &Stored(const Storage &storage)
+		{ return *reinterpret_cast<F *>(const_cast<char *>(storage.bytes)); }
+
+	void Reset()
+	{
+		if (m_manage)
+			m_manage(MANAGE_DESTROY, &m_storage, NULL);
+		m_manage = NULL;
+	}
+
+	bool IsStored() const { return m_manage != NULL; }
+
+	Storage m_storage;
+
+  private:
+	typedef enum {
+		MANAGE_COPY = 0,	// copy src into dst
+		MANAGE_DESTROY		// destroy dst
+	} ManageOp;
+
+	template <typename F>
+	static void Manage(ManageOp op, Storage *dst, const Storage *src)
+	{
+		if (op == MANAGE_COPY)
+			new (dst->bytes) F(Stored<F>(*src));
+		else
+			reinterpret_cast<F *>(dst->bytes)->~F();
+	}
+
+	void (*m_manage)(ManageOp op, Storage *dst, const Storage *src);
+};
+
+template <typename SIGNATURE, size_t STORAGE_SIZE = 4*sizeof(void *)>
+class Delegate;
+
+template <typename R, typename A1, size_t STORAGE_SIZE>
+class Delegate<R (A1), STORAGE_SIZE> : public DelegateStorage<STORAGE_SIZE> {
+	typedef DelegateStorage<STORAGE_SIZE> Base;
+	typedef typename Base::Storage Storage;
+
+  public:
+	typedef R result_type;
+
+	// Empty, calling it is an error (b2bassert)
+	Delegate() : m_invoke(&InvokeEmpty) {}
+
+	Delegate(R (*function)(A1)) : m_invoke(&InvokeEmpty)
+	{
+		if (function)
+			Bind(function);
+	}
+
+	template <typename T>
+	Delegate(T *object, R (T::*method)(A1)) :
+		m_invoke(&InvokeEmpty)
+	{
+		Bind(MethodCall<T, R (T::*)(A1)>(object, method));
+	}
+
+	template <typename T>
+	Delegate(const T *object, R (T::*method)(A1) const) :
+		m_invoke(&InvokeEmpty)
+	{
+		Bind(MethodCall<const T, R (T::*)(A1) const>(object, method));
+	}
+
+	// Function object: boost::bind result, boost::function, functor
+	template <typename F>
+	Delegate(const F &function) : m_invoke(&InvokeEmpty)
+	{
+		Bind(function);
+	}
+
+	// Calls *pFunction, which caller must keep alive.  For callers that
+	// keep their boost::function and pass a pointer to it.
+	// pFunction: NULL for an empty Delegate
+	template <typename F>
+	static Delegate FromPointer(const F *pFunction)
+	{
+		Delegate delegate;
+		if (pFunction)
+			delegate.Bind(PointerCall<F>(pFunction));
+		return delegate;
+	}
+
+	R operator()(A1 a1) const { return m_invoke(this->m_storage, a1); }
+
+	bool empty() const { return !this->IsStored(); }
+
+	void clear()
+	{
+		this->Reset();
+		m_invoke = &InvokeEmpty;
+	}
+
+  private:
+	template <typename T, typename M>
+	struct MethodCall {
+		MethodCall(T *newObject, M newMethod) :
+			object(newObject), method(newMethod) {}
+		R operator()(A1 a1) { return (object->*method)(a1); }
+
+		T *object;
+		M method;
+	};
+
+	template <typename F>
+	struct PointerCall {
+		explicit PointerCall(const F *newPFunction) : pFunction(newPFunction) {}
+		R operator()(A1 a1) { return (*pFunction)(a1); }
+
+		const F *pFunction;
+	};
+
+	template <typename F>
+	void Bind(const F &function)
+	{
+		this->Store(function);
+		m_invoke = &Invoke<F>;
+	}
+
+	template <typename F>
+	static R Invoke(const Storage &storage, A1 a1)
+		{ return Base::template Stored<F>(storage)(a1); }
+
+	static R InvokeEmpty(const Storage &storage, A1 a1)
+	{
+		b2bassert(false); // called empty Delegate
+		return R();
+	}
+
+	R (*m_invoke)(const Storage &storage, A1 a1);
+};
@@ -1,6 +1,11 @@
 //
 // FileUtil: Common file utilities for use at B2B
 //
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "FileUtil.h"
@@ -11,3 +16,43 @@ bool FileUtil::Exists(const char *fileName)
 	struct stat buf;
 	return stat(fileName, &buf) == 0;
 }
+
+bool FileUtil::MappedFile::Map(const char *fileName, std::string *pErr)
+{
+	Unmap();
+
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		if (pErr) *pErr = std::string("open failed: ") + strerror(errno);
+		return false; // FAIL
+	}
+
+	struct stat buf;
+	if (fstat(fd, &buf) != 0) {
+		if (pErr) *pErr = std::string("fstat failed: ") + strerror(errno);
+		close(fd);
+		return false; // FAIL
+	}
+
+	if (buf.st_size > 0) {
+		void *data = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			if (pErr) *pErr = std::string("mmap failed: ") + strerror(errno);
+			close(fd);
+			return false; // FAIL
+		}
+		m_data = static_cast<const char *>(data);
+		m_size = buf.st_size;
+	} // else: empty file, nothing to map
+
+	close(fd); // mapping stays valid after close
+	return true; // SUCCESS
+}
+
+void FileUtil::MappedFile::Unmap()
+{
+	if (m_data)
+		munmap(const_cast<char *>(m_data), m_size);
+	m_data = NULL;
+	m_size = 0;
+}
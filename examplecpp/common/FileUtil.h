@@ -2,9 +2,40 @@
 //
 // FileUtil: Common file utilities for use at B2B
 //
+#include <stddef.h>
+#include <string>
+
 #include "b2btypes.h"
 
 namespace FileUtil {
 	// Returns true if the file with fileName exists, false otherwise.
 	bool Exists(const char *fileName);
+
+	// Read-only memory mapping of a whole file.  Pages are loaded by the OS
+	// as they are touched, so there is no read() copy and no heap buffer.
+	// The mapping is removed by Unmap() or the destructor.
+	class MappedFile {
+	  public:
+		MappedFile() : m_data(NULL), m_size(0) {}
+		~MappedFile() { Unmap(); }
+
+		// Map fileName.  Any previous mapping is removed first.
+		// pErr: errors, only valid if method returns false.  Can be NULL.
+		// RETURNS: true on success, false otherwise.
+		//		An empty file succeeds with Data() NULL and Size() 0.
+		bool Map(const char *fileName, std::string *pErr=NULL);
+		void Unmap();
+
+		bool IsMapped() const { return m_data != NULL; }
+		const char *Data() const { return m_data; }
+		size_t Size() const { return m_size; }
+
+	  private:
+		// Copying would unmap twice
+		MappedFile(const MappedFile &);
+		MappedFile &operator=(const MappedFile &);
+
+		const char *m_data; // start of mapping, NULL if not mapped
+		size_t m_size;		// size of file in bytes
+	};
 }
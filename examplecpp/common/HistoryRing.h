@@ -0,0 +1,165 @@
+#pragma once
+//
+// HistoryRing: the last Capacity() values of T, written by one thread and
+//		read by any number of threads without a lock.
+//		Each value gets a position: 0 for the first Append, 1 for the next,
+//		and so on.  Append overwrites the oldest value once the ring is
+//		full.  Readers ask for a position, or visit from a position to the
+//		newest, and never block the writer or each other.
+//
+//		Each slot has its own sequence number, like SeqLock, so a reader
+//		racing an Append that overwrites the slot it is copying gets
+//		"overwritten" (false) instead of a torn value.  Slots start on
+//		their own cache lines, so the writer filling one slot doesn't slow
+//		down readers of the others.
+//
+//		Append is NOT thread safe with other Appends.  If there can be more
+//		than one writer, the caller must serialize them.
+//
+//		T is copied with operator= while an Append may be changing it: same
+//		rules as SeqLock, T must be plain data.
+//
+//		For example:
+//			HistoryRing<SensorHWData> history(64);
+//			history.Append(data);				// one thread
+//			history.Visit(since, visitor);		// any thread
+//
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+
+#include "boost/atomic.hpp"
+
+#include "common/b2bassert.h"
+
+template <typename T>
+class HistoryRing {
+  public:
+	static const uint32_t CACHE_LINE_SIZE = 64;
+
+	// capacity: number of values kept.  Rounded up to a power of 2.
+	explicit HistoryRing(uint32_t capacity) :
+		m_mask(0),
+		m_slotSize(((sizeof(Slot) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE) *
+				   CACHE_LINE_SIZE),
+		m_slots(NULL),
+		m_end(0)
+	{
+		b2bassert(capacity);
+		while (m_mask + 1 < capacity)
+			m_mask = (m_mask << 1) | 1;
+
+		void *slots = NULL;
+		if (posix_memalign(&slots, CACHE_LINE_SIZE, Capacity() * m_slotSize))
+			throw std::bad_alloc();
+		m_slots = static_cast<char *>(slots);
+		for (uint32_t i = 0; i < Capacity(); ++i)
+			new (m_slots + (i * m_slotSize)) Slot();
+	}
+
+	~HistoryRing()
+	{
+		for (uint32_t i = 0; i < Capacity(); ++i)
+			reinterpret_cast<Slot *>(m_slots + (i * m_slotSize))->~Slot();
+		free(m_slots);
+	}
+
+	uint32_t Capacity() const { return m_mask + 1; }
+
+	// Add value as the newest.  See top of file: one writer at a time.
+	void Append(const T &value)
+	{
+		uint64_t position = m_end.load(boost::memory_order_relaxed);
+		Slot &slot = SlotAt(position);
+		// Odd: readers of this slot see it is being written
+		slot.sequence.store((2 * position) + 1, boost::memory_order_relaxed);
+		boost::atomic_thread_fence(boost::memory_order_release);
+		slot.value = value;
+		slot.sequence.store((2 * position) + 2, boost::memory_order_release);
+		m_end.store(position + 1, boost::memory_order_release);
+	}
+
+	// RETURNS: number of values ever appended, which is also the position
+	//			the next Append gets.  0 if empty.
+	uint64_t End() const { return m_end.load(boost::memory_order_acquire); }
+
+	// RETURNS: position of oldest value still held (an Append may be
+	//			overwriting it right now)
+	uint64_t Begin() const
+	{
+		uint64_t end = End();
+		return (end > Capacity()) ? (end - Capacity()) : 0;
+	}
+
+	// Copy value at position to *pValue.
+	// RETURNS: true on success, false if there is no value at position
+	//			(not appended yet, or overwritten).
+	bool Read(uint64_t position, T *pValue) const
+	{
+		if (position >= End())
+			return false; // FAIL: not appended yet
+
+		const Slot &slot = SlotAt(position);
+		uint64_t sequence = (2 * position) + 2;
+		if (slot.sequence.load(boost::memory_order_acquire) != sequence)
+			return false; // FAIL: overwritten, or being overwritten
+		*pValue = slot.value;
+		boost::atomic_thread_fence(boost::memory_order_acquire);
+		return slot.sequence.load(boost::memory_order_relaxed) == sequence;
+	}
+
+	// Call visitor(value) for each value from position to the newest,
+	// oldest first.  Values overwritten before we get to them are skipped.
+	// Values appended after the call starts are not visited.
+	// Each value is copied once, to a T on our stack; nothing is allocated.
+	// visitor: bool operator()(const T &value) const.  Return false to stop.
+	// RETURNS: number of values visited
+	template <typename VISITOR>
+	uint32_t Visit(uint64_t position, const VISITOR &visitor) const
+		{ return Visit(position, End(), visitor); }
+
+	// Same as above, but stops before position end (an End() from before)
+	template <typename VISITOR>
+	uint32_t Visit(uint64_t position, uint64_t end,
+				   const VISITOR &visitor) const
+	{
+		if ((end > Capacity()) && (position < end - Capacity()))
+			position = end - Capacity(); // older ones are gone
+
+		uint32_t visited = 0;
+		T value;
+		for (; position < end; ++position) {
+			if (!Read(position, &value))
+				continue; // overwritten while we visited the ones before
+			++visited;
+			if (!visitor(value))
+				break; // visitor is done
+		}
+		return visited;
+	}
+
+  private:
+	struct Slot {
+		Slot() : sequence(0) {}
+
+		// (2 * position) + 1 while being written, + 2 once written
+		boost::atomic<uint64_t> sequence;
+		T value;
+	};
+
+	Slot &SlotAt(uint64_t position)
+		{ return *reinterpret_cast<Slot *>(m_slots +
+									((position & m_mask) * m_slotSize)); }
+	const Slot &SlotAt(uint64_t position) const
+		{ return *reinterpret_cast<const Slot *>(m_slots +
+									((position & m_mask) * m_slotSize)); }
+
+	// Not copyable
+	HistoryRing(const HistoryRing &);
+	HistoryRing &operator=(const HistoryRing &);
+
+	uint32_t m_mask;		// Capacity() - 1
+	uint32_t m_slotSize;	// sizeof(Slot) rounded up to CACHE_LINE_SIZE
+	char *m_slots;			// Capacity() slots, m_slotSize apart
+	boost::atomic<uint64_t> m_end;	// see End()
+};
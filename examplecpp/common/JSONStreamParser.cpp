@@ -0,0 +1,320 @@
+//
+// JSONStreamParser: single pass (SAX style) json parser.
+//
+#include <stdio.h>
+
+#include "JSONStreamParser.h"
+
+static const std::string EMPTY_KEY;
+
+bool JSONStreamParser::Parse(const char *data, size_t size,
+							 JSONStreamHandler *handler, std::string *pErr)
+{
+	m_begin = data;
+	m_pos = data;
+	m_end = data + size;
+	m_handler = handler;
+	m_err.clear();
+	m_errPos = data;
+	if (m_keys.size() < MAX_DEPTH)
+		m_keys.resize(MAX_DEPTH);
+
+	bool returnVal = true;
+	SkipWhitespace();
+	if ((m_pos < m_end) && ((*m_pos == '{') || (*m_pos == '['))) {
+		returnVal = ParseContainer(EMPTY_KEY, *m_pos == '[', 0);
+		if (returnVal) {
+			SkipWhitespace();
+			if (m_pos != m_end)
+				returnVal = Error("unexpected data after root");
+		}
+	} else {
+		returnVal = Error("expected '{' or '[' at root");
+	}
+
+	if (!returnVal && pErr) {
+		// Only count lines on failure, keeps the success path lean
+		int line = 1;
+		int column = 1;
+		for (const char *pos = m_begin; pos < m_errPos; ++pos) {
+			if (*pos == '\n') {
+				++line;
+				column = 1;
+			} else {
+				++column;
+			}
+		}
+		char buf[64];
+		snprintf(buf, sizeof(buf), "line %d column %d: ", line, column);
+		*pErr = std::string(buf) + m_err;
+	}
+
+	return returnVal;
+}
+
+bool JSONStreamParser::ParseContainer(const std::string &key, bool isArray,
+									  size_t depth)
+{
+	if (depth >= MAX_DEPTH)
+		return Error("nesting too deep");
+
+	++m_pos; // skip '{' or '['
+	if (!m_handler->JSONStartContainer(key, isArray))
+		return Error("rejected by handler");
+
+	const char closeChar = isArray ? ']' : '}';
+	std::string &memberKey = m_keys[depth];
+	memberKey.clear(); // array elements always have empty key
+
+	SkipWhitespace();
+	if ((m_pos < m_end) && (*m_pos == closeChar)) {
+		++m_pos; // empty container
+	} else {
+		for (;;) {
+			if (!isArray) {
+				SkipWhitespace();
+				if ((m_pos >= m_end) || (*m_pos != '"'))
+					return Error("expected string key");
+				if (!ParseString(&memberKey))
+					return false; // FAIL: ParseString set error
+				SkipWhitespace();
+				if ((m_pos >= m_end) || (*m_pos != ':'))
+					return Error("expected ':'");
+				++m_pos;
+			}
+
+			SkipWhitespace();
+			if (m_pos >= m_end)
+				return Error("unexpected end of data");
+
+			bool ok = true;
+			bool isContainer = false;
+			JSONStreamHandler::ValueType type =
+									JSONStreamHandler::VALUETYPE_STRING;
+			switch (*m_pos) {
+			  case '{':
+			  case '[':
+				if (!ParseContainer(memberKey, *m_pos == '[', depth+1))
+					return false; // FAIL: error already set
+				isContainer = true;
+				break;
+			  case '"':
+				ok = ParseString(&m_value);
+				break;
+			  case 't':
+				ok = ParseLiteral("true");
+				type = JSONStreamHandler::VALUETYPE_BOOL;
+				break;
+			  case 'f':
+				ok = ParseLiteral("false");
+				type = JSONStreamHandler::VALUETYPE_BOOL;
+				break;
+			  case 'n':
+				ok = ParseLiteral("null");
+				type = JSONStreamHandler::VALUETYPE_NULL;
+				break;
+			  default:
+				ok = ParseNumber(&m_value);
+				type = JSONStreamHandler::VALUETYPE_NUMBER;
+				break;
+			}
+			if (!ok)
+				return false; // FAIL: error already set
+			if (!isContainer) {
+				if (!m_handler->JSONValue(memberKey, m_value, type))
+					return Error("rejected by handler");
+			}
+
+			SkipWhitespace();
+			if (m_pos >= m_end)
+				return Error("unexpected end of data");
+			if (*m_pos == ',') {
+				++m_pos;
+			} else if (*m_pos == closeChar) {
+				++m_pos;
+				break; // done with container
+			} else {
+				return Error(isArray ? "expected ',' or ']'" :
+									   "expected ',' or '}'");
+			}
+		}
+	}
+
+	if (!m_handler->JSONEndContainer(isArray))
+		return Error("rejected by handler");
+
+	return true; // SUCCESS
+}
+
+// Append code point cp to pValue as UTF-8
+static void AppendUTF8(unsigned long cp, std::string *pValue)
+{
+	if (cp < 0x80) {
+		pValue->push_back((char)cp);
+	} else if (cp < 0x800) {
+		pValue->push_back((char)(0xC0 | (cp >> 6)));
+		pValue->push_back((char)(0x80 | (cp & 0x3F)));
+	} else if (cp < 0x10000) {
+		pValue->push_back((char)(0xE0 | (cp >> 12)));
+		pValue->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+		pValue->push_back((char)(0x80 | (cp & 0x3F)));
+	} else {
+		pValue->push_back((char)(0xF0 | (cp >> 18)));
+		pValue->push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+		pValue->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+		pValue->push_back((char)(0x80 | (cp & 0x3F)));
+	}
+}
+
+// Parse 4 hex digits at pos.
+// RETURNS: true on success, false otherwise
+static bool ParseHex4(const char *pos, unsigned long *pValue)
+{
+	unsigned long value = 0;
+	for (int i = 0; i < 4; ++i) {
+		char c = pos[i];
+		value <<= 4;
+		if ((c >= '0') && (c <= '9'))
+			value |= c - '0';
+		else if ((c >= 'a') && (c <= 'f'))
+			value |= c - 'a' + 10;
+		else if ((c >= 'A') && (c <= 'F'))
+			value |= c - 'A' + 10;
+		else
+			return false; // FAIL
+	}
+	*pValue = value;
+	return true; // SUCCESS
+}
+
+bool JSONStreamParser::ParseString(std::string *pValue)
+{
+	++m_pos; // skip opening '"'
+	pValue->clear();
+
+	for (;;) {
+		// Copy run of plain characters in one go
+		const char *start = m_pos;
+		while ((m_pos < m_end) && (*m_pos != '"') && (*m_pos != '\\') &&
+			   ((unsigned char)*m_pos >= 0x20))
+		{
+			++m_pos;
+		}
+		pValue->append(start, m_pos - start);
+
+		if (m_pos >= m_end)
+			return Error("unterminated string");
+		if (*m_pos == '"') {
+			++m_pos;
+			return true; // SUCCESS
+		}
+		if (*m_pos != '\\')
+			return Error("control character in string");
+
+		// Escape sequence
+		++m_pos;
+		if (m_pos >= m_end)
+			return Error("unterminated string");
+		switch (*m_pos) {
+		  case '"':  pValue->push_back('"');  break;
+		  case '\\': pValue->push_back('\\'); break;
+		  case '/':  pValue->push_back('/');  break;
+		  case 'b':  pValue->push_back('\b'); break;
+		  case 'f':  pValue->push_back('\f'); break;
+		  case 'n':  pValue->push_back('\n'); break;
+		  case 'r':  pValue->push_back('\r'); break;
+		  case 't':  pValue->push_back('\t'); break;
+		  case 'u':
+		  {
+			unsigned long cp;
+			if (((m_end - m_pos) < 5) || !ParseHex4(m_pos+1, &cp))
+				return Error("bad \\u escape");
+			m_pos += 4;
+			if ((cp >= 0xD800) && (cp <= 0xDBFF)) {
+				// High surrogate, must be followed by low surrogate
+				unsigned long low;
+				if (((m_end - m_pos) < 7) || (m_pos[1] != '\\') ||
+					(m_pos[2] != 'u') || !ParseHex4(m_pos+3, &low) ||
+					(low < 0xDC00) || (low > 0xDFFF))
+				{
+					return Error("bad \\u surrogate pair");
+				}
+				m_pos += 6;
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+			}
+			AppendUTF8(cp, pValue);
+			break;
+		  }
+		  default:
+			return Error("bad escape in string");
+		}
+		++m_pos;
+	}
+}
+
+bool JSONStreamParser::ParseNumber(std::string *pValue)
+{
+	// Validate json number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+	// The text is reported as written (like ptree does).
+	const char *start = m_pos;
+
+	if ((m_pos < m_end) && (*m_pos == '-'))
+		++m_pos;
+	if ((m_pos >= m_end) || (*m_pos < '0') || (*m_pos > '9'))
+		return Error("expected value");
+	if (*m_pos == '0') {
+		++m_pos;
+	} else {
+		while ((m_pos < m_end) && (*m_pos >= '0') && (*m_pos <= '9'))
+			++m_pos;
+	}
+	if ((m_pos < m_end) && (*m_pos == '.')) {
+		++m_pos;
+		if ((m_pos >= m_end) || (*m_pos < '0') || (*m_pos > '9'))
+			return Error("expected digit after '.'");
+		while ((m_pos < m_end) && (*m_pos >= '0') && (*m_pos <= '9'))
+			++m_pos;
+	}
+	if ((m_pos < m_end) && ((*m_pos == 'e') || (*m_pos == 'E'))) {
+		++m_pos;
+		if ((m_pos < m_end) && ((*m_pos == '+') || (*m_pos == '-')))
+			++m_pos;
+		if ((m_pos >= m_end) || (*m_pos < '0') || (*m_pos > '9'))
+			return Error("expected digit in exponent");
+		while ((m_pos < m_end) && (*m_pos >= '0') && (*m_pos <= '9'))
+			++m_pos;
+	}
+
+	pValue->assign(start, m_pos - start);
+	return true; // SUCCESS
+}
+
+bool JSONStreamParser::ParseLiteral(const char *literal)
+{
+	const char *start = m_pos;
+	for (const char *pos = literal; *pos; ++pos, ++m_pos) {
+		if ((m_pos >= m_end) || (*m_pos != *pos)) {
+			m_pos = start;
+			return Error("expected value");
+		}
+	}
+	m_value.assign(literal, m_pos - start);
+	return true; // SUCCESS
+}
+
+void JSONStreamParser::SkipWhitespace()
+{
+	while ((m_pos < m_end) &&
+		   ((*m_pos == ' ') || (*m_pos == '\t') ||
+			(*m_pos == '\n') || (*m_pos == '\r')))
+	{
+		++m_pos;
+	}
+}
+
+bool JSONStreamParser::Error(const char *what)
+{
+	m_err = what;
+	m_errPos = m_pos;
+	return false; // FAIL
+}
@@ -0,0 +1,88 @@
+#pragma once
+//
+// JSONStreamParser: single pass (SAX style) json parser.
+//		Walks a json text buffer once and reports each object, array and
+//		value to a JSONStreamHandler as it is found.  No tree is built, so
+//		memory use is bounded by the nesting depth and the longest string.
+//		Works well with FileUtil::MappedFile.
+//
+//		Values are reported as text, the same way boost::property_tree
+//		stores them: strings unescaped, numbers exactly as written, and
+//		true/false/null as "true"/"false"/"null".  Array elements have an
+//		empty key (as in ptree).
+//
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+class JSONStreamHandler {
+  public:
+	typedef enum {
+	   VALUETYPE_STRING = 0,
+	   VALUETYPE_NUMBER,
+	   VALUETYPE_BOOL,
+	   VALUETYPE_NULL,
+	   VALUETYPE_TOTAL		// size of enum (never used as a valid value)
+	} ValueType;
+
+	virtual ~JSONStreamHandler() {}
+
+	// Called at the start of an object or array.
+	// key: key of object or array in its parent ("" for array elements and
+	//		for the root)
+	// RETURNS: true to continue parsing, false to stop (parse fails)
+	virtual bool JSONStartContainer(const std::string &key, bool isArray) = 0;
+
+	// Called at the end of the object or array most recently started.
+	// RETURNS: true to continue parsing, false to stop (parse fails)
+	virtual bool JSONEndContainer(bool isArray) = 0;
+
+	// Called for each value that is not an object or array.
+	// key: key of value in its parent ("" for array elements)
+	// RETURNS: true to continue parsing, false to stop (parse fails)
+	virtual bool JSONValue(const std::string &key, const std::string &value,
+							ValueType type) = 0;
+};
+
+class JSONStreamParser {
+  public:
+	JSONStreamParser() :
+		m_begin(NULL), m_pos(NULL), m_end(NULL), m_handler(NULL), m_errPos(NULL)
+	{}
+
+	// Parse data and report to handler.  The root must be an object
+	//		or array.
+	// data, size: json text (does not need to be NUL terminated)
+	// pErr: errors, only valid if method returns false.  Contains the
+	//		line and column of error.
+	// RETURNS: true on success, false otherwise.
+	bool Parse(const char *data, size_t size, JSONStreamHandler *handler,
+			   std::string *pErr);
+
+  private:
+	// All RETURN: true on success, false otherwise (m_err is set)
+	bool ParseContainer(const std::string &key, bool isArray, size_t depth);
+	bool ParseString(std::string *pValue);
+	bool ParseNumber(std::string *pValue);
+	bool ParseLiteral(const char *literal);
+	void SkipWhitespace();
+
+	// Set m_err and m_errPos to describe error at current position
+	// RETURNS: false always, so caller can "return Error(...)"
+	bool Error(const char *what);
+
+	// Limit on nesting so a bad file cannot overflow our stack
+	static const size_t MAX_DEPTH = 64;
+
+	const char *m_begin;
+	const char *m_pos;
+	const char *m_end;
+	JSONStreamHandler *m_handler;
+	std::string m_err;
+	const char *m_errPos;
+
+	// Reused for each key (one per depth) and value to avoid a heap
+	// allocation per token
+	std::vector<std::string> m_keys;
+	std::string m_value;
+};
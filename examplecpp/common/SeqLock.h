@@ -0,0 +1,73 @@
+#pragma once
+//
+// SeqLock: holds the latest value of T, written by one thread and read by
+//		any number of threads without a lock.
+//		Readers never block and never write to shared memory, so a busy
+//		reader does not slow the writer or other readers down.  A reader
+//		that overlaps a Write copies again, so it always gets a value from
+//		one Write, never half of one and half of another.
+//
+//		Write is NOT thread safe with other Writes.  If there can be more
+//		than one writer, the caller must serialize them (a mutex the
+//		writers hold, say).  Readers need no lock.
+//
+//		T is copied with operator= while a Write may be changing it.  The
+//		copy is thrown away when that happens, but the copy itself must be
+//		safe: T must be plain data (numbers, enums, B2BMath vectors), with
+//		no pointers it owns, no std::string, no std::vector.
+//
+//		For example:
+//			SeqLock<SensorHWData> latest;
+//			latest.Write(data);		// one thread
+//			latest.Read(&data);		// any thread
+//
+#include <stdint.h>
+
+#include "boost/atomic.hpp"
+
+template <typename T>
+class SeqLock {
+  public:
+	SeqLock() : m_sequence(0) {}
+	explicit SeqLock(const T &value) : m_sequence(0), m_value(value) {}
+
+	// Publish value.  See top of file: one writer at a time.
+	void Write(const T &value)
+	{
+		uint32_t sequence = m_sequence.load(boost::memory_order_relaxed);
+		// Odd: readers that see this copy again
+		m_sequence.store(sequence + 1, boost::memory_order_relaxed);
+		boost::atomic_thread_fence(boost::memory_order_release);
+		m_value = value;
+		m_sequence.store(sequence + 2, boost::memory_order_release);
+	}
+
+	// Copy latest value to *pValue.  Never blocks, but copies again if a
+	// Write overlapped the copy.
+	// RETURNS: Version of the value copied
+	uint32_t Read(T *pValue) const
+	{
+		for (;;) {
+			uint32_t sequence = m_sequence.load(boost::memory_order_acquire);
+			if (sequence & 1)
+				continue; // Write in progress
+			*pValue = m_value;
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if (m_sequence.load(boost::memory_order_relaxed) == sequence)
+				return sequence; // SUCCESS: no Write overlapped us
+		}
+	}
+
+	// RETURNS: number that changes on every Write.  0 if never written.
+	//			Cheap way to see if there is anything new since the last Read.
+	uint32_t Version() const
+		{ return m_sequence.load(boost::memory_order_acquire) & ~1U; }
+
+  private:
+	// Not copyable: copy the value instead
+	SeqLock(const SeqLock &);
+	SeqLock &operator=(const SeqLock &);
+
+	boost::atomic<uint32_t> m_sequence;	// odd while a Write is in progress
+	T m_value;
+};
@@ -14,6 +14,15 @@ SimpleTimer::SimpleTimer(const char *name,
 {
 }
 
+SimpleTimer::SimpleTimer(const char *name, 
+					TimeIntervalMS intervalMS, bool firstExpirationIsImmediate,
+					const SimpleTimerDelegate &callback, void *arg) :
+	TimerModule(name, intervalMS, firstExpirationIsImmediate),
+	m_callback(callback),
+	m_callbackArg(arg)
+{
+}
+
 SimpleTimer::~SimpleTimer()
 {
 	Stop(); // Stop our timer
@@ -10,6 +10,7 @@
 
 #include "boost/function.hpp"
 
+#include "common/Delegate.h"
 #include "apps/common/TimerModule.h"
 
 class SimpleTimer : public TimerModule {
@@ -17,6 +18,8 @@ class SimpleTimer : public TimerModule {
 	// Type for our SimpleTimer callback.
 	// RETURNS: true on success, false otherwise.
 	typedef boost::function<bool (void *arg)> SimpleTimerCallback;
+	// Same, without heap or boost::function indirection (see Delegate)
+	typedef Delegate<bool (void *arg)> SimpleTimerDelegate;
 
 	// name: used for debugging
 	// intervalMS: See TimerModule for documentation 
@@ -26,6 +29,10 @@ class SimpleTimer : public TimerModule {
 	SimpleTimer(const char *name, 
 				TimeIntervalMS intervalMS, bool firstExpirationIsImmediate,
 				const SimpleTimerCallback &callback, void *arg=NULL);
+	// Same, with a SimpleTimerDelegate
+	SimpleTimer(const char *name, 
+				TimeIntervalMS intervalMS, bool firstExpirationIsImmediate,
+				const SimpleTimerDelegate &callback, void *arg=NULL);
 	virtual ~SimpleTimer();
 
 	// START: TimerModule required methods.  See that class for documentation
@@ -40,6 +47,7 @@ class SimpleTimer : public TimerModule {
 	bool Stop() { return TimerModule::Stop(NULL); }
 
   private:
-	const SimpleTimerCallback m_callback;	// from ctor
+	// from ctor.  A SimpleTimerCallback is kept in it.
+	const SimpleTimerDelegate m_callback;
 	void *m_callbackArg;					// from ctor arg
 };
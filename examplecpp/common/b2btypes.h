@@ -4,6 +4,7 @@
 //		that are pretty common across the project.
 //
 #include <stdint.h>
+#include <vector>
 
 namespace b2b {
 	typedef float Distance;  	// meters (m for short)
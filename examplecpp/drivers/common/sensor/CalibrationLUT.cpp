@@ -0,0 +1,147 @@
+#include <stdlib.h>
+
+#include "log/B2BLog.h"
+
+#include "CalibrationLUT.h"
+
+const char * const CalibrationLUTType::IOCONFIG_LABEL_CALRAW =
+																"calRaw";
+const char * const CalibrationLUTType::IOCONFIG_LABEL_CALVALUE =
+																"calValue";
+
+bool CalibrationLUTType::CalPointsValid(const CalPoint *points,
+										size_t numPoints)
+{
+	if (!points || (numPoints < 2))
+		return false; // FAIL: need at least one segment
+
+	for (size_t i = 1; i < numPoints; ++i) {
+		if (!(points[i-1].raw < points[i].raw))
+			return false; // FAIL: raw must be strictly increasing
+	}
+
+	return true; // SUCCESS
+}
+
+float CalibrationLUTType::CalPointsInterpolate(const CalPoint *points,
+											size_t numPoints, float raw)
+{
+	if (raw <= points[0].raw)
+		return points[0].value;
+	if (raw >= points[numPoints-1].raw)
+		return points[numPoints-1].value;
+
+	// Binary search for segment [lo, lo+1] that contains raw
+	size_t lo = 0;
+	size_t hi = numPoints-1;
+	while ((hi - lo) > 1) {
+		size_t mid = (lo + hi) / 2;
+		if (points[mid].raw <= raw)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	float frac = (raw - points[lo].raw) / (points[hi].raw - points[lo].raw);
+	return points[lo].value + ((points[hi].value - points[lo].value) * frac);
+}
+
+// Parse a string of comma (or space) separated numbers into pNumbers
+// RETURNS: true on success, false otherwise
+static bool ParseNumberList(const char *numberList,
+							std::vector<float> *pNumbers)
+{
+	const char *pos = numberList;
+	while (*pos) {
+		if ((*pos == ',') || (*pos == ' ') || (*pos == '\t')) {
+			++pos; // skip separators
+			continue;
+		}
+		char *end;
+		float value = strtof(pos, &end);
+		if (end == pos)
+			return false; // FAIL: not a number
+		pNumbers->push_back(value);
+		pos = end;
+	}
+
+	return true; // SUCCESS
+}
+
+// Read label's numbers from IOConfig entry.  Value can be a json array of
+// numbers or a string of comma separated numbers.
+// RETURNS: true on success, false otherwise (logged if logError)
+static bool LoadNumberList(const IOConfig &ioConfig,
+						IOConfig::IOHandle ioHandle, const char *label,
+						std::vector<float> *pNumbers, bool logError)
+{
+	IOConfig::LabelHandle labelHandle = ioConfig.GetLabelHandle(label);
+	if (ioConfig.GetExtraSettingsType(ioHandle, labelHandle) ==
+											IOConfig::SETTINGTYPE_STRING)
+	{
+		const char *numberList;
+		ioConfig.GetExtraSettingsValue(ioHandle, labelHandle, &numberList,
+									   logError);
+		if (!ParseNumberList(numberList, pNumbers)) {
+			if (logError) {
+				B2BLog::Err(LogFilt::LM_DRIVERS,
+					"%s: IOConfig \"%s\" is not a list of numbers",
+					ioConfig.Lookup(ioHandle)->ioName.c_str(), label);
+			}
+			return false; // FAIL
+		}
+		return true; // SUCCESS
+	}
+
+	return ioConfig.GetExtraSettingsValue(ioHandle, labelHandle, pNumbers,
+										  logError);
+}
+
+bool CalibrationLUTType::LoadCalPoints(const IOConfig &ioConfig,
+					const IOConfig::IOName &ioName,
+					CalPoints *pPoints, bool logError)
+{
+	IOConfig::IOHandle ioHandle = ioConfig.GetIOHandle(ioName);
+	if (ioHandle == IOConfig::IOHANDLE_INVALID) {
+		if (logError) {
+			B2BLog::Err(LogFilt::LM_DRIVERS, "%s not defined in IOConfig",
+						ioName.c_str());
+		}
+		return false; // FAIL
+	}
+
+	std::vector<float> raws;
+	std::vector<float> values;
+	if (!LoadNumberList(ioConfig, ioHandle, IOCONFIG_LABEL_CALRAW, &raws,
+						logError) ||
+		!LoadNumberList(ioConfig, ioHandle, IOCONFIG_LABEL_CALVALUE, &values,
+						logError))
+	{
+		return false; // FAIL: LoadNumberList already logged
+	}
+	if (raws.size() != values.size()) {
+		if (logError) {
+			B2BLog::Err(LogFilt::LM_DRIVERS,
+				"%s: IOConfig \"%s\" and \"%s\" must have same number of values",
+				ioName.c_str(), IOCONFIG_LABEL_CALRAW, IOCONFIG_LABEL_CALVALUE);
+		}
+		return false; // FAIL
+	}
+
+	CalPoints points(raws.size());
+	for (size_t i = 0; i < raws.size(); ++i) {
+		points[i].raw = raws[i];
+		points[i].value = values[i];
+	}
+	if (!CalPointsValid(points.empty() ? NULL : &points[0], points.size())) {
+		if (logError) {
+			B2BLog::Err(LogFilt::LM_DRIVERS,
+				"%s: IOConfig \"%s\" needs 2 or more increasing values",
+				ioName.c_str(), IOCONFIG_LABEL_CALRAW);
+		}
+		return false; // FAIL
+	}
+
+	pPoints->swap(points);
+	return true; // SUCCESS
+}
@@ -0,0 +1,336 @@
+#pragma once
+//
+// CalibrationLUT: lookup table that converts a raw sensor reading (ADC counts,
+//		volts, etc) into engineering units (meters, lux, etc).
+//		Analog sensors like IR range, light and ADC channels have a nonlinear
+//		response.  Instead of calling expensive math (pow, log, curve fits)
+//		on every sample, a driver builds a CalibrationLUT once and then every
+//		conversion is an index calculation plus an interpolation.
+//
+// The table size is a compile-time template parameter (SIZE).  The table
+// lives inside the object (no heap), so drivers usually make it a member or
+// a static const object (which is then built once at program load).
+// Table contents are generated from one of these:
+//	 * a calibration function: called SIZE times, never again after that.
+//	 * sample points: measured (raw, value) pairs sorted by raw.  They are
+//	   resampled onto the table's uniform raw grid.
+//	 * IOConfig extraSettings: see LoadFromIOConfig().
+//
+// Raw values outside of [rawMin, rawMax] are clamped to the end of the table.
+//
+// Interpolation between table entries is chosen at runtime:
+//	 LINEAR: straight line between the two closest entries (fastest).
+//	 CUBIC: Catmull-Rom spline through the four closest entries.  Use it
+//		for small tables of a strongly curved response.
+//
+// Example (Sharp IR range sensor on a 12-bit ADC):
+//	 static float IRCountsToMeters(float counts) {...slow curve fit...}
+//	 static const CalibrationLUT<64> s_irLUT(0, 4095, IRCountsToMeters);
+//	 b2b::Distance d = s_irLUT.Convert(adcCounts);
+//
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "boost/static_assert.hpp"
+
+#include "common/b2bassert.h"
+
+#include "apps/common/IOConfig.h"
+
+namespace CalibrationLUTType {
+	typedef enum {
+		INTERP_LINEAR = 0,
+		INTERP_CUBIC,
+		INTERP_TOTAL		// size of enum (never used as a valid value)
+	} Interpolation;
+
+	// Calibration function: converts raw to engineering units
+	typedef float (*CalFunction)(float raw);
+
+	// One measured calibration point
+	class CalPoint {
+	  public:
+		float raw;		// raw sensor reading
+		float value;	// engineering units for raw
+	};
+	typedef std::vector<CalPoint> CalPoints;
+
+	// RETURNS: true if points can be used to build a table (at least 2
+	//			points and raw values strictly increasing), false otherwise.
+	bool CalPointsValid(const CalPoint *points, size_t numPoints);
+
+	// Piecewise linear evaluation of the curve through points at raw.
+	// points must be valid (see CalPointsValid).
+	// raw outside of the points is clamped to the first/last point.
+	float CalPointsInterpolate(const CalPoint *points, size_t numPoints,
+								float raw);
+
+	// IOConfig labels used by LoadCalPoints.  Both are arrays of numbers
+	// (or strings of comma separated numbers) and both must have the same
+	// count of numbers:
+	//	 "IOName" : { "ANALOG" : 2, "dir" : "input",
+	//				  "calRaw" : [ 200, 1000, 2500, 3900 ],
+	//				  "calValue" : [ 1.50, 0.60, 0.20, 0.10 ] },
+	extern const char * const IOCONFIG_LABEL_CALRAW;
+	extern const char * const IOCONFIG_LABEL_CALVALUE;
+
+	// Read calibration points of ioName from ioConfig.
+	// pPoints: only set if return value is true.
+	// logError: if true, log errors; if false, do not log
+	// RETURNS: true on success, false otherwise
+	bool LoadCalPoints(const IOConfig &ioConfig, const IOConfig::IOName &ioName,
+						CalPoints *pPoints, bool logError=true);
+}
+
+template <size_t SIZE>
+class CalibrationLUT {
+  public:
+	typedef CalibrationLUTType::Interpolation Interpolation;
+	typedef CalibrationLUTType::CalFunction CalFunction;
+	typedef CalibrationLUTType::CalPoint CalPoint;
+
+	// Creates an empty table.  IsValid() is false until a Generate or
+	// LoadFromIOConfig call succeeds.  Convert() returns raw unchanged.
+	CalibrationLUT() :
+		m_valid(false),
+		m_interp(CalibrationLUTType::INTERP_LINEAR),
+		m_rawMin(0),
+		m_rawMax(0),
+		m_rawToIdx(0)
+	{
+		for (size_t i = 0; i < SIZE; ++i)
+			m_table[i] = 0;
+	}
+
+	// Same as empty ctor followed by Generate()
+	CalibrationLUT(float rawMin, float rawMax, CalFunction calFunction,
+			Interpolation interp=CalibrationLUTType::INTERP_LINEAR) :
+		m_valid(false),
+		m_interp(interp),
+		m_rawMin(0),
+		m_rawMax(0),
+		m_rawToIdx(0)
+	{
+		Generate(rawMin, rawMax, calFunction, interp);
+	}
+	CalibrationLUT(const CalPoint *points, size_t numPoints,
+			Interpolation interp=CalibrationLUTType::INTERP_LINEAR) :
+		m_valid(false),
+		m_interp(interp),
+		m_rawMin(0),
+		m_rawMax(0),
+		m_rawToIdx(0)
+	{
+		Generate(points, numPoints, interp);
+	}
+
+	// Build table by calling calFunction at SIZE evenly spaced raw values
+	//		from rawMin to rawMax (both inclusive).
+	// RETURNS: true on success, false otherwise (rawMin >= rawMax or
+	//			calFunction is NULL).  On failure the table is invalid.
+	bool Generate(float rawMin, float rawMax, CalFunction calFunction,
+			Interpolation interp=CalibrationLUTType::INTERP_LINEAR)
+	{
+		m_valid = false;
+		if (!calFunction || !SetRange(rawMin, rawMax, interp))
+			return false; // FAIL
+
+		for (size_t i = 0; i < SIZE; ++i)
+			m_table[i] = calFunction(IdxToRaw(i));
+
+		m_valid = true;
+		return true; // SUCCESS
+	}
+
+	// Build table from sample points.  Table covers first to last point.
+	// points: sorted by raw, see CalibrationLUTType::CalPointsValid
+	// RETURNS: true on success, false otherwise.  On failure the table is
+	//			invalid.
+	bool Generate(const CalPoint *points, size_t numPoints,
+			Interpolation interp=CalibrationLUTType::INTERP_LINEAR)
+	{
+		m_valid = false;
+		if (!CalibrationLUTType::CalPointsValid(points, numPoints))
+			return false; // FAIL
+		if (!SetRange(points[0].raw, points[numPoints-1].raw, interp))
+			return false; // FAIL
+
+		for (size_t i = 0; i < SIZE; ++i) {
+			m_table[i] = CalibrationLUTType::CalPointsInterpolate(points,
+												numPoints, IdxToRaw(i));
+		}
+
+		m_valid = true;
+		return true; // SUCCESS
+	}
+
+	// Build table from the calibration points of IOConfig entry ioName.
+	// See CalibrationLUTType::LoadCalPoints for the json format.
+	// RETURNS: true on success, false otherwise.  On failure the table is
+	//			unchanged if the IOConfig points could not be read, and invalid
+	//			if the points were read but are not usable.
+	bool LoadFromIOConfig(const IOConfig &ioConfig,
+			const IOConfig::IOName &ioName,
+			Interpolation interp=CalibrationLUTType::INTERP_LINEAR,
+			bool logError=true)
+	{
+		CalibrationLUTType::CalPoints points;
+		if (!CalibrationLUTType::LoadCalPoints(ioConfig, ioName, &points,
+												logError))
+		{
+			return false; // FAIL: LoadCalPoints already logged
+		}
+
+		return Generate(&points[0], points.size(), interp);
+	}
+
+	// RETURNS: raw converted to engineering units.
+	//			If table is not valid, returns raw.
+	//			NaN raw converts as rawMin (a bad reading must not index
+	//			outside the table).
+	float Convert(float raw) const
+	{
+		if (!m_valid)
+			return raw;
+
+		float pos = RawToPos(raw);
+		size_t idx = static_cast<size_t>(pos);
+		if (idx >= (SIZE-1))
+			idx = SIZE-2; // raw == rawMax: use last segment with frac 1
+		float frac = pos - idx;
+
+		if (m_interp == CalibrationLUTType::INTERP_CUBIC)
+			return CubicInterp(idx, frac);
+		return m_table[idx] + ((m_table[idx+1] - m_table[idx]) * frac);
+	}
+
+	// Convert count raw values into pValues.  Same results as calling
+	// Convert() on each value, but LINEAR tables are processed four values
+	// at a time using the CPU's SIMD unit (NEON on ARM, SSE on x86).
+	// raw and pValues can be the same array.
+	void ConvertBatch(const float *raw, float *pValues, size_t count) const;
+
+	// RETURNS: true if table has been generated, false otherwise.
+	bool IsValid() const { return m_valid; }
+
+	float RawMin() const { return m_rawMin; }
+	float RawMax() const { return m_rawMax; }
+	Interpolation GetInterpolation() const { return m_interp; }
+
+	// RETURNS: table entry idx (raw value of entry is IdxToRaw(idx))
+	float Entry(size_t idx) const { b2bassert(idx < SIZE); return m_table[idx]; }
+	float IdxToRaw(size_t idx) const
+		{ return m_rawMin + ((m_rawMax - m_rawMin) * idx) / (SIZE-1); }
+
+  private:
+	// Need two entries for a segment to interpolate
+	BOOST_STATIC_ASSERT(SIZE >= 2);
+
+	bool SetRange(float rawMin, float rawMax, Interpolation interp)
+	{
+		if (!(rawMin < rawMax) || (interp >= CalibrationLUTType::INTERP_TOTAL))
+			return false; // FAIL
+
+		m_rawMin = rawMin;
+		m_rawMax = rawMax;
+		m_rawToIdx = (SIZE-1) / (rawMax - rawMin);
+		m_interp = interp;
+		return true; // SUCCESS
+	}
+
+	// RETURNS: fractional table position of raw, clamped to [0, SIZE-1].
+	//			NaN gives 0.
+	float RawToPos(float raw) const
+	{
+		float pos = (raw - m_rawMin) * m_rawToIdx;
+		if (!(pos > 0))
+			return 0; // below table, or NaN (compares false)
+		if (pos > (SIZE-1))
+			return SIZE-1;
+		return pos;
+	}
+
+	// Catmull-Rom spline between m_table[idx] and m_table[idx+1]
+	// At the ends of the table, the missing outer point is linearly
+	// extrapolated (repeating the end entry bends the curve flat there).
+	float CubicInterp(size_t idx, float frac) const
+	{
+		float p1 = m_table[idx];
+		float p2 = m_table[idx+1];
+		float p0 = (idx > 0) ? m_table[idx-1] : ((2*p1) - p2);
+		float p3 = ((idx+2) < SIZE) ? m_table[idx+2] : ((2*p2) - p1);
+
+		float a = (-0.5f*p0) + (1.5f*p1) - (1.5f*p2) + (0.5f*p3);
+		float b = p0 - (2.5f*p1) + (2.0f*p2) - (0.5f*p3);
+		float c = (-0.5f*p0) + (0.5f*p2);
+		return (((((a * frac) + b) * frac) + c) * frac) + p1;
+	}
+
+	bool m_valid;			// true if table has been generated
+	Interpolation m_interp;	// from ctor or Generate
+	float m_rawMin;			// raw value of m_table[0]
+	float m_rawMax;			// raw value of m_table[SIZE-1]
+	float m_rawToIdx;		// (SIZE-1)/(m_rawMax-m_rawMin)
+	float m_table[SIZE];
+};
+
+// Four floats processed as one SIMD register by GCC vector extensions
+// (compiles to NEON on ARM and SSE on x86).  Needs __builtin_convertvector,
+// older compilers use the scalar loop.
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 9))
+  #define CALIBRATIONLUT_SIMD
+  typedef float CalibrationLUTFloat4 __attribute__((vector_size(16)));
+  typedef int32_t CalibrationLUTInt4 __attribute__((vector_size(16)));
+#endif
+
+template <size_t SIZE>
+void CalibrationLUT<SIZE>::ConvertBatch(const float *raw, float *pValues,
+										size_t count) const
+{
+	size_t i = 0;
+
+	#ifdef CALIBRATIONLUT_SIMD
+	if (m_valid && (m_interp == CalibrationLUTType::INTERP_LINEAR)) {
+		const float posMax = SIZE-1;
+		const int32_t idxMax = SIZE-2;
+		const CalibrationLUTFloat4 rawMin4 = 
+							{ m_rawMin, m_rawMin, m_rawMin, m_rawMin };
+		const CalibrationLUTFloat4 rawToIdx4 =
+							{ m_rawToIdx, m_rawToIdx, m_rawToIdx, m_rawToIdx };
+		const CalibrationLUTFloat4 zero4 = { 0, 0, 0, 0 };
+		const CalibrationLUTFloat4 posMax4 = { posMax, posMax, posMax, posMax };
+		const CalibrationLUTInt4 idxMax4 = { idxMax, idxMax, idxMax, idxMax };
+
+		for (; (i + 4) <= count; i += 4) {
+			// Same math as Convert(), four values at a time
+			CalibrationLUTFloat4 pos;
+			memcpy(&pos, &raw[i], sizeof(pos)); // raw may be unaligned
+			pos = (pos - rawMin4) * rawToIdx4;
+			pos = (pos > zero4) ? pos : zero4; // NaN goes to 0 too
+			pos = (pos > posMax4) ? posMax4 : pos;
+			CalibrationLUTInt4 idx = 
+						__builtin_convertvector(pos, CalibrationLUTInt4);
+			idx = (idx > idxMax4) ? idxMax4 : idx;
+			CalibrationLUTFloat4 frac = 
+					pos - __builtin_convertvector(idx, CalibrationLUTFloat4);
+
+			// There is no SIMD gather on our targets, so load entries one
+			// at a time.
+			CalibrationLUTFloat4 lo = { m_table[idx[0]], m_table[idx[1]],
+										m_table[idx[2]], m_table[idx[3]] };
+			CalibrationLUTFloat4 hi = { m_table[idx[0]+1], m_table[idx[1]+1],
+										m_table[idx[2]+1], m_table[idx[3]+1] };
+
+			CalibrationLUTFloat4 result = lo + ((hi - lo) * frac);
+			memcpy(&pValues[i], &result, sizeof(result));
+		}
+	}
+	#endif // CALIBRATIONLUT_SIMD
+
+	// Remainder (or everything when no SIMD or CUBIC)
+	for (; i < count; ++i)
+		pValues[i] = Convert(raw[i]);
+}
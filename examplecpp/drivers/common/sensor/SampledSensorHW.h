@@ -0,0 +1,290 @@
+#pragma once
+//
+// SampledSensorHW: base for SensorHW that read their device at a fixed
+//		output data rate (ODR).  It owns the acquisition thread SensorHW
+//		asks for, so a driver only reads its device.
+//
+//		DEVICE derives from SampledSensorHW<DEVICE> and has
+//			bool ReadSample(SensorHWData *pData);
+//		(public, or make SampledSensorHW<DEVICE> a friend).  It reads one
+//		sample from the device into pData, raw: not fixed for geometry.
+//		RETURNS true if it read one.  It is called only from our thread.
+//		Timestamp is set for it if left 0.
+//
+//		Our thread calls ReadSample every 1/ODR seconds.  Deadlines are
+//		absolute, each one period after the one before, so a late wakeup
+//		or a slow read doesn't push the next sample back and the rate
+//		doesn't drift.  If we fall a whole period behind, those deadlines
+//		are skipped and counted as missed; we don't read several samples
+//		in a row to catch up.
+//
+//		Each sample is published with PublishLatest (so into history and
+//		to any SensorEventBus), fixed for geometry if the IOConfig entry
+//		has one.  SensorHWGetLatest takes no lock.  Our thread is the only
+//		writer, so it takes no lock either.
+//
+//		GetSampleStats has the sample rate we got, missed deadlines and
+//		how long ReadSample takes.
+//
+//		For example:
+//			class FooDistanceHW : public SampledSensorHW<FooDistanceHW> {
+//			  public:
+//				FooDistanceHW(const IOConfig &ioConfig) :
+//					SampledSensorHW<FooDistanceHW>("FooDistanceHW", ioConfig,
+//												   "fooDistance", 100) {}
+//				~FooDistanceHW() { StopSampling(); }
+//				bool ReadSample(SensorHWData *pData);	// register I/O
+//			};
+//
+//		WARNING: DEVICE's dtor must call StopSampling, before its members
+//		that ReadSample uses are gone.
+//
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "boost/atomic.hpp"
+
+#include "common/b2bassert.h"
+#include "common/B2BTime.h"
+#include "common/SeqLock.h"
+#include "log/B2BLog.h"
+#include "apps/common/ThreadModule.h"
+
+#include "SensorHW.h"
+
+template <class DEVICE>
+class SampledSensorHW : public SensorHW {
+  public:
+	// name: name of our thread
+	// ioConfig,ioConfigEntryName,rangeOptimization: see SensorHW
+	// outputDataRateHz: samples per second.  0 is treated as 1.
+	SampledSensorHW(const char *name, const IOConfig &ioConfig,
+					const char *ioConfigEntryName, uint32_t outputDataRateHz,
+					RangeOptimization rangeOptimization=RANGEOPT_DEFAULT) :
+		SensorHW(ioConfig, ioConfigEntryName, rangeOptimization),
+		m_thread(name, this),
+		m_periodNS(PeriodNS(outputDataRateHz)),
+		m_deadlineNS(0),
+		m_firstDeadlineNS(0),
+		m_resetStats(false)
+	{
+		ClearStats(&m_stats);
+		m_sampleStats.Write(m_stats);
+
+		pthread_mutex_init(&m_lockWait, NULL);
+		// Deadlines are against B2BTime::GetCurrTimeMonotonicNS's clock
+		pthread_condattr_t condAttr;
+		pthread_condattr_init(&condAttr);
+		pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+		pthread_cond_init(&m_condWait, &condAttr);
+		pthread_condattr_destroy(&condAttr);
+	}
+	virtual ~SampledSensorHW()
+	{
+		StopSampling(); // DEVICE should have already
+		pthread_cond_destroy(&m_condWait);
+		pthread_mutex_destroy(&m_lockWait);
+	}
+
+	// Start our thread.  First sample is read right away.
+	// RETURNS: true on success, false if not valid or thread didn't start
+	bool StartSampling()
+	{
+		if (!IsValid()) {
+			B2BLog::Err(LogFilt::LM_DRIVERS,
+						"%s::StartSampling: not valid", m_thread.Name());
+			return false; // FAIL
+		}
+		m_deadlineNS = 0; // our thread starts the deadlines
+		return m_thread.Start(NULL);
+	}
+	// Stop our thread.  Returns as soon as any ReadSample in progress does.
+	// RETURNS: true on success, false if not started
+	bool StopSampling() { return m_thread.Stop(NULL); }
+
+	// Change ODR, from next sample on
+	// outputDataRateHz: samples per second.  0 is treated as 1.
+	void SetOutputDataRate(uint32_t outputDataRateHz)
+		{ m_periodNS.store(PeriodNS(outputDataRateHz)); }
+	// RETURNS: ODR in samples per second
+	uint32_t OutputDataRate() const
+		{ return 1000000000ULL / m_periodNS.load(); }
+
+	// START: SensorHW required virtuals.  See SensorHW for documentation
+	bool SensorHWGetLatest(SensorHWData *pData, SensorHWStatus *pStatus=NULL,
+						   bool raw=false)
+	{
+		b2bassert(pData);
+
+		if (!IsValid()) {
+			if (pStatus) *pStatus = HWSTATUS_ERROR;
+			return false; // FAIL: error in init
+		}
+		if (!raw)
+			return GetPublishedLatest(pData, pStatus);
+
+		m_latestRawData.Read(pData);
+		if (!pData->timestamp) {
+			if (pStatus) *pStatus = HWSTATUS_NODATA;
+			return false; // FAIL: nothing read yet
+		}
+		if (pStatus) *pStatus = HWSTATUS_OK;
+		return true; // SUCCESS
+	}
+	// END: SensorHW required virtuals
+
+	// How sampling went, since ctor or ResetSampleStats
+	// samples: ReadSample calls that read a sample
+	// readFailures: ReadSample calls that didn't
+	// missedDeadlines: deadlines skipped because we were a period late
+	// elapsedNS: from first deadline to last, for the rate we got
+	// maxLateNS: most we started a ReadSample after its deadline
+	// sumReadNS, maxReadNS: time in ReadSample
+	struct SampleStats {
+		uint64_t samples;
+		uint64_t readFailures;
+		uint64_t missedDeadlines;
+		uint64_t elapsedNS;
+		uint64_t maxLateNS;
+		uint64_t sumReadNS;
+		uint64_t maxReadNS;
+	};
+	// Never blocks our thread
+	void GetSampleStats(SampleStats *pStats) const
+		{ b2bassert(pStats); m_sampleStats.Read(pStats); }
+	// Takes effect at our thread's next sample
+	void ResetSampleStats() { m_resetStats.store(true); }
+	// B2BLog::Info SampleStats
+	void LogSampleStats() const
+	{
+		SampleStats stats;
+		GetSampleStats(&stats);
+
+		uint64_t reads = stats.samples + stats.readFailures;
+		B2BLog::Info(LogFilt::LM_DRIVERS,
+			"%s: %llu samples at %.1fHz (ODR %uHz), %llu read failures, "
+			"%llu missed, late max %.1fus, read avg %.1fus max %.1fus",
+			m_thread.Name(), (unsigned long long)stats.samples,
+			stats.elapsedNS ? (reads - 1) * 1e9 / stats.elapsedNS : 0.0,
+			OutputDataRate(), (unsigned long long)stats.readFailures,
+			(unsigned long long)stats.missedDeadlines, stats.maxLateNS / 1e3,
+			reads ? (stats.sumReadNS / 1e3) / reads : 0.0,
+			stats.maxReadNS / 1e3);
+	}
+
+  private:
+	// Our thread.  Worker calls back to our AcquireNext.
+	class AcquisitionThread : public ThreadModule {
+	  public:
+		AcquisitionThread(const char *name, SampledSensorHW *owner) :
+			ThreadModule(name), m_owner(owner) {}
+		// Not stopped here: owner's dtor stops us, while m_lockWait exists
+		bool Init() { return true; }
+
+	  protected:
+		void *Worker(void *arg) { m_owner->AcquireNext(); return NULL; }
+		// Wakes Worker if it is waiting for a deadline, so it can quit
+		void WakeWorker()
+		{
+			pthread_mutex_lock(&m_owner->m_lockWait);
+			pthread_cond_broadcast(&m_owner->m_condWait);
+			pthread_mutex_unlock(&m_owner->m_lockWait);
+		}
+
+	  private:
+		SampledSensorHW *m_owner;
+	};
+
+	static uint64_t PeriodNS(uint32_t outputDataRateHz)
+		{ return 1000000000ULL / (outputDataRateHz ? outputDataRateHz : 1); }
+
+	static void ClearStats(SampleStats *pStats)
+	{
+		pStats->samples = 0;
+		pStats->readFailures = 0;
+		pStats->missedDeadlines = 0;
+		pStats->elapsedNS = 0;
+		pStats->maxLateNS = 0;
+		pStats->sumReadNS = 0;
+		pStats->maxReadNS = 0;
+	}
+
+	// Wait for next deadline and read one sample.  Called in our thread
+	// only.
+	void AcquireNext()
+	{
+		uint64_t nowNS = B2BTime::GetCurrTimeMonotonicNS();
+		if (!m_deadlineNS) {
+			m_deadlineNS = nowNS; // first sample right away
+			m_firstDeadlineNS = nowNS;
+		}
+
+		if (nowNS < m_deadlineNS) {
+			// Not yet.  Stop wakes us early.
+			struct timespec deadline;
+			deadline.tv_sec = m_deadlineNS / 1000000000ULL;
+			deadline.tv_nsec = m_deadlineNS % 1000000000ULL;
+			pthread_mutex_lock(&m_lockWait);
+			if (!m_thread.IsThreadCancelRequested())
+				pthread_cond_timedwait(&m_condWait, &m_lockWait, &deadline);
+			pthread_mutex_unlock(&m_lockWait);
+			return; // Worker calls us again, we check the time again
+		}
+
+		if (m_resetStats.exchange(false)) {
+			ClearStats(&m_stats);
+			m_firstDeadlineNS = m_deadlineNS;
+		}
+
+		// A period or more late: skip to the latest deadline that has
+		// passed, keeping the phase
+		const uint64_t periodNS = m_periodNS.load();
+		uint64_t lateNS = nowNS - m_deadlineNS;
+		if (lateNS >= periodNS) {
+			uint64_t missed = lateNS / periodNS;
+			m_stats.missedDeadlines += missed;
+			m_deadlineNS += missed * periodNS;
+			lateNS -= missed * periodNS;
+		}
+		if (lateNS > m_stats.maxLateNS)
+			m_stats.maxLateNS = lateNS;
+
+		SensorHWData data;
+		bool read = static_cast<DEVICE *>(this)->ReadSample(&data);
+		uint64_t readNS = B2BTime::GetCurrTimeMonotonicNS() - nowNS;
+		if (read) {
+			if (!data.timestamp)
+				data.timestamp = B2BTime::GetCurrentB2BTimestamp();
+			m_latestRawData.Write(data);
+			if (!m_sensorHWGeometries.empty())
+				FixVectorForSensorGeometry(0, &data);
+			PublishLatest(data); // we are the only writer, no lock
+			++m_stats.samples;
+		} else {
+			++m_stats.readFailures;
+		}
+		m_stats.sumReadNS += readNS;
+		if (readNS > m_stats.maxReadNS)
+			m_stats.maxReadNS = readNS;
+		m_stats.elapsedNS = m_deadlineNS - m_firstDeadlineNS;
+		m_sampleStats.Write(m_stats);
+
+		m_deadlineNS += periodNS; // from the deadline, not from now
+	}
+
+	AcquisitionThread m_thread;
+	boost::atomic<uint64_t> m_periodNS;	// 1/ODR
+
+	// Our thread's, no lock
+	uint64_t m_deadlineNS;			// time of next sample, 0 before first
+	uint64_t m_firstDeadlineNS;		// for SampleStats::elapsedNS
+	SampleStats m_stats;
+
+	SeqLock<SensorHWData> m_latestRawData;	// for SensorHWGetLatest raw
+	SeqLock<SampleStats> m_sampleStats;		// m_stats, for GetSampleStats
+	boost::atomic<bool> m_resetStats;		// set by ResetSampleStats
+
+	pthread_mutex_t m_lockWait;		// for m_condWait
+	pthread_cond_t m_condWait;		// CLOCK_MONOTONIC, signalled by Stop
+};
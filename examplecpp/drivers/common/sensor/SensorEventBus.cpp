@@ -0,0 +1,226 @@
+#include <algorithm>
+
+#include "common/b2bassert.h"
+#include "common/B2BTime.h"
+#include "log/B2BLog.h"
+
+#include "SensorEventBus.h"
+
+SensorEventBus::SensorEventBus(const char *name) :
+	ThreadModule(name),
+	m_pending(false),
+	m_notifyNS(0)
+{
+	pthread_mutex_init(&m_lockBus, NULL);
+	pthread_mutex_init(&m_lockDeliver, NULL);
+	pthread_mutex_init(&m_lockNotify, NULL);
+	pthread_cond_init(&m_cond, NULL);
+	ResetBusStats();
+}
+
+SensorEventBus::~SensorEventBus()
+{
+	// Detach producers first, so a publish from here on doesn't Notify
+	// us while we stop.  See WARNING above class.
+	for (size_t i = 0; i < m_producers.size(); ++i)
+		m_producers[i].sensorHW->SensorHWClearEventBus(this);
+
+	Stop(NULL); // Stop our thread
+
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_lockNotify);
+	pthread_mutex_destroy(&m_lockDeliver);
+	pthread_mutex_destroy(&m_lockBus);
+}
+
+void SensorEventBus::WakeWorker()
+{
+	pthread_mutex_lock(&m_lockNotify);
+	pthread_cond_broadcast(&m_cond);
+	pthread_mutex_unlock(&m_lockNotify);
+}
+
+bool SensorEventBus::AddProducer(SensorHW *sensorHW)
+{
+	b2bassert(sensorHW);
+
+	pthread_mutex_lock(&m_lockBus);
+	for (size_t i = 0; i < m_producers.size(); ++i) {
+		if (m_producers[i].sensorHW == sensorHW) {
+			pthread_mutex_unlock(&m_lockBus);
+			return true; // SUCCESS: already added
+		}
+	}
+	if (!sensorHW->SensorHWSetEventBus(this)) {
+		pthread_mutex_unlock(&m_lockBus);
+		B2BLog::Err(LogFilt::LM_DRIVERS,
+					"%s::AddProducer: SensorHW is on another bus", Name());
+		return false; // FAIL
+	}
+	Producer producer;
+	producer.sensorHW = sensorHW;
+	producer.position = sensorHW->SensorHWHistoryCount(); // only new ones
+	m_producers.push_back(producer);
+	pthread_mutex_unlock(&m_lockBus);
+
+	return true; // SUCCESS
+}
+
+bool SensorEventBus::RemoveProducer(SensorHW *sensorHW)
+{
+	b2bassert(sensorHW);
+
+	pthread_mutex_lock(&m_lockBus);
+	size_t i = 0;
+	while ((i < m_producers.size()) && (m_producers[i].sensorHW != sensorHW))
+		++i;
+	if (i >= m_producers.size()) {
+		pthread_mutex_unlock(&m_lockBus);
+		B2BLog::Err(LogFilt::LM_DRIVERS,
+					"%s::RemoveProducer: SensorHW is not a producer", Name());
+		return false; // FAIL
+	}
+	sensorHW->SensorHWClearEventBus(this);
+	m_producers.erase(m_producers.begin() + i);
+	pthread_mutex_unlock(&m_lockBus);
+
+	// Wait for a batch taken before we removed it to be delivered
+	pthread_mutex_lock(&m_lockDeliver);
+	pthread_mutex_unlock(&m_lockDeliver);
+
+	return true; // SUCCESS
+}
+
+bool SensorEventBus::Subscribe(const Handler &handler, const SensorHW *source)
+{
+	if (handler.empty()) {
+		B2BLog::Err(LogFilt::LM_DRIVERS, "%s::Subscribe: no handler", Name());
+		return false; // FAIL
+	}
+
+	Subscriber subscriber;
+	subscriber.handler = handler;
+	subscriber.source = source;
+
+	pthread_mutex_lock(&m_lockBus);
+	m_subscribers.push_back(subscriber);
+	pthread_mutex_unlock(&m_lockBus);
+
+	return true; // SUCCESS
+}
+
+void SensorEventBus::Notify()
+{
+	if (m_pending.exchange(true))
+		return; // already woken, Worker takes our sample with the others
+
+	pthread_mutex_lock(&m_lockNotify);
+	m_notifyNS = B2BTime::GetCurrTimeMonotonicNS();
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_lockNotify);
+}
+
+bool SensorEventBus::BatchCollector::operator()(const SensorHWData &data) const
+{
+	SensorEvent event;
+	event.source = m_source;
+	event.data = data;
+	m_pBatch->push_back(event);
+	return true; // take them all
+}
+
+/*static*/ bool SensorEventBus::TimestampLess(const SensorEvent &a,
+											  const SensorEvent &b)
+{
+	return a.data.timestamp < b.data.timestamp;
+}
+
+void *SensorEventBus::Worker(void *arg)
+{
+	pthread_mutex_lock(&m_lockNotify);
+	while (!m_pending.load() && !IsThreadCancelRequested())
+		pthread_cond_wait(&m_cond, &m_lockNotify);
+	uint64_t notifyNS = m_notifyNS;
+	m_notifyNS = 0;
+	pthread_mutex_unlock(&m_lockNotify);
+	if (IsThreadCancelRequested())
+		return NULL;
+
+	// Clear before we take samples: a publish from now on wakes us again
+	m_pending.store(false);
+
+	pthread_mutex_lock(&m_lockBus);
+	m_batch.clear();
+	for (size_t i = 0; i < m_producers.size(); ++i) {
+		Producer &producer = m_producers[i];
+		BatchCollector collector(&m_batch, producer.sensorHW);
+		m_busStats.lost += producer.sensorHW->SensorHWVisitHistoryFrom(
+										&producer.position,
+										SensorHWDataVisitor(collector));
+	}
+	// Each producer's samples are in order already, stable keeps them so
+	std::stable_sort(m_batch.begin(), m_batch.end(), TimestampLess);
+
+	m_busStats.events += m_batch.size();
+	if (!m_batch.empty()) {
+		// notifyNS is 0 if we took the samples before their Notify got
+		// the lock: latency was 0 then
+		++m_busStats.wakeups;
+		uint64_t latencyNS = notifyNS ? (B2BTime::GetCurrTimeMonotonicNS() - notifyNS) : 0;
+		m_busStats.sumLatencyNS += latencyNS;
+		if (latencyNS > m_busStats.maxLatencyNS)
+			m_busStats.maxLatencyNS = latencyNS;
+	}
+
+	// Deliver without m_lockBus, so handlers can use the bus
+	if (!m_batch.empty())
+		m_deliverSubscribers = m_subscribers;
+	pthread_mutex_lock(&m_lockDeliver);
+	pthread_mutex_unlock(&m_lockBus);
+
+	for (size_t e = 0; e < m_batch.size(); ++e) {
+		const SensorEvent &event = m_batch[e];
+		for (size_t s = 0; s < m_deliverSubscribers.size(); ++s) {
+			const Subscriber &subscriber = m_deliverSubscribers[s];
+			if (!subscriber.source || (subscriber.source == event.source))
+				subscriber.handler(event);
+		}
+	}
+	pthread_mutex_unlock(&m_lockDeliver);
+
+	return NULL;
+}
+
+void SensorEventBus::GetBusStats(BusStats *pStats) const
+{
+	b2bassert(pStats);
+
+	pthread_mutex_lock(&m_lockBus);
+	*pStats = m_busStats;
+	pthread_mutex_unlock(&m_lockBus);
+}
+
+void SensorEventBus::ResetBusStats()
+{
+	pthread_mutex_lock(&m_lockBus);
+	m_busStats.events = 0;
+	m_busStats.wakeups = 0;
+	m_busStats.lost = 0;
+	m_busStats.maxLatencyNS = 0;
+	m_busStats.sumLatencyNS = 0;
+	pthread_mutex_unlock(&m_lockBus);
+}
+
+void SensorEventBus::LogBusStats() const
+{
+	BusStats stats;
+	GetBusStats(&stats);
+
+	B2BLog::Info(LogFilt::LM_DRIVERS,
+		"%s: %llu events in %llu wakeups, %llu lost, "
+		"latency avg %.1fus max %.1fus",
+		Name(), (unsigned long long)stats.events,
+		(unsigned long long)stats.wakeups, (unsigned long long)stats.lost,
+		stats.wakeups ? (stats.sumLatencyNS / 1000.0) / stats.wakeups : 0.0,
+		stats.maxLatencyNS / 1000.0);
+}
@@ -0,0 +1,166 @@
+#pragma once
+//
+// SensorEventBus: delivers SensorHW samples to subscribers as they are
+//		published, instead of subscribers polling every SensorHW on every
+//		tick.
+//		WARNING: Client must call Init() and Start() to enable this class.
+//
+//		Each producer is a SensorHW, added with AddProducer.  Its samples
+//		are the ones it passes to SensorHW::PublishLatest, which already
+//		go into its lock-free history ring: that ring is the producer's
+//		queue, and we keep our own read position in it.  PublishLatest
+//		then wakes our thread.  Only the first publish since our thread
+//		last woke takes our mutex, so a busy producer doesn't contend with
+//		us.
+//
+//		Our thread takes all new samples from all producers, sorts them by
+//		timestamp and calls subscribers' handlers in that order.  Order is
+//		by timestamp within one wakeup.  A sample published after a wakeup
+//		with an older timestamp than one already delivered is delivered
+//		next wakeup, late.
+//
+//		When nothing is published our thread sleeps, so an idle bus uses
+//		no CPU, and how soon a subscriber sees a sample doesn't depend on
+//		any tick period.  GetBusStats has how soon that is.
+//
+//		SensorHW that do not call PublishLatest (they read their hardware
+//		in SensorHWGetLatest) never produce anything here; poll those.
+//
+//		WARNING: Stop publishing on every producer (stop its thread)
+//		before the bus is destroyed.  Our dtor takes each producer off the
+//		bus, but a PublishLatest already past that check still calls
+//		Notify on us.
+//		WARNING: We keep a pointer to each producer.  RemoveProducer it
+//		before it is destroyed (~SensorHW asserts it is on no bus).
+//
+//		For example:
+//			bus.AddProducer(soundHW);
+//			bus.Subscribe(SensorEventBus::Handler(this, &Foo::OnSound),
+//						  soundHW);
+//
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include "boost/atomic.hpp"
+
+#include "common/Delegate.h"
+#include "apps/common/ThreadModule.h"
+
+#include "SensorHW.h"
+
+class SensorEventBus : public ThreadModule {
+  public:
+	// One published sample
+	// source: SensorHW that published it
+	// data: what it published
+	struct SensorEvent {
+		SensorHW *source;
+		SensorHWData data;
+	};
+
+	// Called in our thread for each SensorEvent.  Should be quick: no other
+	// handler is called until it returns.  Called without our lock, so it
+	// may call AddProducer, Subscribe (takes effect next wakeup) or
+	// GetBusStats, but must not call RemoveProducer: that waits for
+	// handlers to return.
+	typedef Delegate<void (const SensorEvent &event)> Handler;
+
+	// name: passed to ThreadModule
+	SensorEventBus(const char *name);
+	virtual ~SensorEventBus();
+
+	// START: B2BModule virtuals.  See ThreadModule for documentation
+	bool Init() { return true; } // nothing to do
+	// END: B2BModule virtuals
+
+	// Deliver sensorHW's samples.  Only ones published from now on.
+	// RETURNS: true on success, false if sensorHW is on another bus
+	bool AddProducer(SensorHW *sensorHW);
+
+	// Stop delivering sensorHW's samples and forget it.  When this
+	// returns no handler is running with one of its samples, so sensorHW
+	// can be destroyed.  Its subscribers stay, they get nothing more.
+	// RETURNS: true on success, false if sensorHW is not our producer
+	bool RemoveProducer(SensorHW *sensorHW);
+
+	// Call handler for each sample from source
+	// handler: copied
+	// source: NULL for every producer's samples
+	// RETURNS: true on success, false if handler is empty
+	bool Subscribe(const Handler &handler, const SensorHW *source=NULL);
+
+	// Called by SensorHW::PublishLatest.  Wakes our thread.
+	void Notify();
+
+	// How we did, since ctor or ResetBusStats.
+	// events: samples delivered
+	// wakeups: times our thread woke and had samples to deliver
+	// lost: samples a producer overwrote before we took them
+	// latency: first Notify of a wakeup to its samples' delivery starting
+	struct BusStats {
+		uint64_t events;
+		uint64_t wakeups;
+		uint64_t lost;
+		uint64_t maxLatencyNS;
+		uint64_t sumLatencyNS;
+	};
+	void GetBusStats(BusStats *pStats) const;
+	void ResetBusStats();
+	// B2BLog::Info BusStats
+	void LogBusStats() const;
+
+  protected:
+	// START: required protected virtual from ThreadModule
+	// Waits for Notify and delivers what was published
+	void *Worker(void *arg);
+	// END: required protected virtual from ThreadModule
+
+	// ThreadModule virtual: wakes Worker if it is waiting, so it can quit
+	void WakeWorker();
+
+  private:
+	struct Producer {
+		SensorHW *sensorHW;
+		uint64_t position;	// next history position to take
+	};
+
+	struct Subscriber {
+		Handler handler;
+		const SensorHW *source;
+	};
+
+	// Adds each SensorHWData visited to m_batch
+	class BatchCollector {
+	  public:
+		BatchCollector(std::vector<SensorEvent> *pBatch, SensorHW *source) :
+			m_pBatch(pBatch), m_source(source) {}
+		bool operator()(const SensorHWData &data) const;
+
+	  private:
+		std::vector<SensorEvent> *m_pBatch;
+		SensorHW *m_source;
+	};
+
+	static bool TimestampLess(const SensorEvent &a, const SensorEvent &b);
+
+	// Producers and subscribers
+	std::vector<Producer> m_producers;
+	std::vector<Subscriber> m_subscribers;
+	BusStats m_busStats;
+	mutable pthread_mutex_t m_lockBus;	// for all of the above
+
+	// Our thread's only, what it delivers without m_lockBus.  Kept to
+	// reuse their memory.
+	std::vector<SensorEvent> m_batch;
+	std::vector<Subscriber> m_deliverSubscribers;
+	// Held by our thread while it delivers.  Taken before m_lockBus is
+	// released, so RemoveProducer can wait for a batch to be delivered.
+	pthread_mutex_t m_lockDeliver;
+
+	// Notify and our thread's wait
+	boost::atomic<bool> m_pending;		// Notify since our thread woke
+	uint64_t m_notifyNS;				// first Notify's time, 0 if none
+	pthread_mutex_t m_lockNotify;		// for m_notifyNS and m_cond
+	pthread_cond_t m_cond;				// signalled by Notify and Stop
+};
@@ -1,5 +1,7 @@
+#include "common/b2bassert.h"
 #include "log/B2BLog.h"
 
+#include "SensorEventBus.h"
 #include "SensorHW.h"
 
 SensorHW::SensorHW(const IOConfig &ioConfig, 
@@ -7,8 +9,10 @@ SensorHW::SensorHW(const IOConfig &ioConfig,
 					RangeOptimization rangeOptimization) :
 	//m_sensorHWGeometries, // init'ed by own ctor to 0s
 	m_rangeOptimization(rangeOptimization),
+	m_history(HISTORY_CAPACITY),
 	m_enabled(true),  // Assume driver is enabled
-	m_isValid(false)  // Driver not initialized yet
+	m_isValid(false),  // Driver not initialized yet
+	m_eventBus(NULL)
 {
 	CTORCommon(ioConfig, ioConfigEntryNames);
 }
@@ -18,7 +22,10 @@ SensorHW::SensorHW(const IOConfig &ioConfig,
 					RangeOptimization rangeOptimization) :
 	//m_sensorHWGeometries, // init'ed by own ctor to 0s
 	m_rangeOptimization(rangeOptimization),
-	m_isValid(false)
+	m_history(HISTORY_CAPACITY),
+	m_enabled(true),  // Assume driver is enabled
+	m_isValid(false),  // Driver not initialized yet
+	m_eventBus(NULL)
 {
 	IOConfigEntryNames ioConfigEntryNames;
 	if (ioConfigEntryName)
@@ -28,6 +35,9 @@ SensorHW::SensorHW(const IOConfig &ioConfig,
 
 SensorHW::~SensorHW()
 {
+	// SensorEventBus keeps a pointer to us: RemoveProducer first
+	b2bassert(!m_eventBus.load());
+
 	pthread_mutex_destroy(&m_lockSensorHW);
 }
 
@@ -36,14 +46,27 @@ bool SensorHW::CTORCommon(const IOConfig &ioConfig,
 {
 	bool returnVal = true; // assume SUCCESS
 
+	// Look labels up once, then each entry is handle lookups only
+	const IOConfig::LabelHandle offsetUHandle =
+									ioConfig.GetLabelHandle("offsetU");
+	const IOConfig::LabelHandle offsetVHandle =
+									ioConfig.GetLabelHandle("offsetV");
+	const IOConfig::LabelHandle offsetWHandle =
+									ioConfig.GetLabelHandle("offsetW");
+	const IOConfig::LabelHandle horizAngleHandle =
+									ioConfig.GetLabelHandle("horizAngle");
+	const IOConfig::LabelHandle azimuthHandle =
+									ioConfig.GetLabelHandle("azimuth");
+
 	for (uint8_t entryCount = 0; entryCount < ioConfigEntryNames.size();
 		 ++entryCount)
 	{
 		m_thresholdsEntries.push_back(IOConfig::IOThresholds());
 		m_sensorHWGeometries.push_back(SensorHWGeometry());
 
-		const IOConfig::IOConfigEntry *entry = 
-							ioConfig.Lookup(ioConfigEntryNames[entryCount]);
+		const IOConfig::IOHandle ioHandle =
+						ioConfig.GetIOHandle(ioConfigEntryNames[entryCount]);
+		const IOConfig::IOConfigEntry *entry = ioConfig.Lookup(ioHandle);
 		if (entry) {
 
 			if (!entry->enable) {
@@ -57,24 +80,21 @@ bool SensorHW::CTORCommon(const IOConfig &ioConfig,
 
 			SensorHWGeometry &geom = m_sensorHWGeometries[entryCount];
 			// sensorLoc
-			if (ioConfig.GetExtraSettingsValue<float>(
-						ioConfigEntryNames[entryCount], "offsetU",
+			if (ioConfig.GetExtraSettingsValue<float>(ioHandle, offsetUHandle,
 						&geom.sensorLoc.U, false))
 			{
 				if (geom.sensorLoc.U != 0)
 					geom.locAtOrigin = false;
 			} // else: leave value set to 0
 
-			if (ioConfig.GetExtraSettingsValue<float>(
-						ioConfigEntryNames[entryCount], "offsetV",
+			if (ioConfig.GetExtraSettingsValue<float>(ioHandle, offsetVHandle,
 						&geom.sensorLoc.V, false))
 			{
 				if (geom.sensorLoc.V != 0)
 					geom.locAtOrigin = false;
 			} // else: leave value set to 0
 
-			if (ioConfig.GetExtraSettingsValue<float>(
-						ioConfigEntryNames[entryCount], "offsetW",
+			if (ioConfig.GetExtraSettingsValue<float>(ioHandle, offsetWHandle,
 						&geom.sensorLoc.W, false))
 			{
 				if (geom.sensorLoc.W != 0)
@@ -82,11 +102,9 @@ bool SensorHW::CTORCommon(const IOConfig &ioConfig,
 			} // else: leave value set to 0
 
 			// sensorOrientation
-			ioConfig.GetExtraSettingsValue<float>(
-						ioConfigEntryNames[entryCount], "horizAngle",
+			ioConfig.GetExtraSettingsValue<float>(ioHandle, horizAngleHandle,
 						&geom.sensorOrientation.angle, false);
-			ioConfig.GetExtraSettingsValue<float>(
-						ioConfigEntryNames[entryCount], "azimuth",
+			ioConfig.GetExtraSettingsValue<float>(ioHandle, azimuthHandle,
 						&geom.sensorOrientation.azimuth, false);
 		} else {
 			B2BLog::Err(LogFilt::LM_DRIVERS,
@@ -117,6 +135,84 @@ bool SensorHW::CheckForTestData(SensorHWData *pData, SensorHWStatus *pStatus)
 	return false; // no injected test data
 } 
 
+bool SensorHW::GetPublishedLatest(SensorHWData *pData,
+								  SensorHWStatus *pStatus) const
+{
+	m_latestSensorHWData.Read(pData);
+	if (!pData->timestamp) {
+		if (pStatus) *pStatus = HWSTATUS_NODATA;
+		return false; // FAIL: nothing published yet
+	}
+
+	if (pStatus) *pStatus = HWSTATUS_OK;
+	return true; // SUCCESS
+}
+
+uint32_t SensorHW::SensorHWVisitHistorySince(b2b::Timestamp since,
+								const SensorHWDataVisitor &visitor) const
+{
+	// Walk back from newest to the first sample newer than since.
+	// Timestamps only go up, so everything after it is newer too.
+	uint64_t begin = m_history.Begin();
+	uint64_t position = m_history.End();
+	SensorHWData data;
+	while ((position > begin) && m_history.Read(position - 1, &data) &&
+		   (data.timestamp > since))
+	{
+		--position;
+	}
+
+	return m_history.Visit(position, visitor);
+}
+
+uint32_t SensorHW::SensorHWVisitHistoryLast(uint32_t count,
+								const SensorHWDataVisitor &visitor) const
+{
+	uint64_t end = m_history.End();
+	return m_history.Visit((end > count) ? (end - count) : 0, visitor);
+}
+
+uint64_t SensorHW::SensorHWVisitHistoryFrom(uint64_t *pPosition,
+								const SensorHWDataVisitor &visitor) const
+{
+	b2bassert(pPosition);
+
+	uint64_t position = *pPosition;
+	uint64_t end = m_history.End();
+	if (position >= end)
+		return 0; // nothing new
+
+	uint32_t visited = m_history.Visit(position, end, visitor);
+	*pPosition = end;
+	return (end - position) - visited;
+}
+
+bool SensorHW::SensorHWSetEventBus(SensorEventBus *bus)
+{
+	b2bassert(bus);
+
+	SensorEventBus *noBus = NULL;
+	if (!m_eventBus.compare_exchange_strong(noBus, bus) && (noBus != bus))
+		return false; // FAIL: on another bus
+
+	return true; // SUCCESS
+}
+
+bool SensorHW::SensorHWClearEventBus(SensorEventBus *bus)
+{
+	b2bassert(bus);
+
+	// Only if still on bus: we may have moved to another one since
+	return m_eventBus.compare_exchange_strong(bus, NULL);
+}
+
+void SensorHW::NotifyEventBus()
+{
+	SensorEventBus *bus = m_eventBus.load(boost::memory_order_acquire);
+	if (bus)
+		bus->Notify();
+}
+
 /*static*/ const char * const SensorHW::RangeOptimizationString[SensorHW::RANGEOPT_TOTAL] =
 {
 	"DEFAULT", "ACCURACY", "LONG", "SHORT", "SPEED"
@@ -92,6 +92,9 @@
 #include "common/B2BMath.h"
 #include "common/B2BLogic.h"
 #include "common/B2BTime.h"
+#include "common/Delegate.h"
+#include "common/HistoryRing.h"
+#include "common/SeqLock.h"
 
 #include "apps/common/IOConfig.h"
 
@@ -131,6 +134,13 @@ class SensorHWData {
 	b2b::Timestamp timestamp; // When the data was read, 0 if data is invalid
 };
 
+class SensorEventBus;
+
+// Called for each SensorHWData in a history visit, see
+// SensorHW::SensorHWVisitHistorySince.
+// RETURNS: true to keep visiting, false to stop
+typedef Delegate<bool (const SensorHWData &data)> SensorHWDataVisitor;
+
 class SensorHW {
   public:
 	// Ranging optimization choices:
@@ -215,6 +225,8 @@ class SensorHW {
 	// the data *quickly*.  And once again, MAKE SURE that the thread never 
 	// causes a long mutex wait as a side-effect in this SensorHWGetLatest.
 	// method.  We must not block for more than a few *micro*-seconds here.
+	// Derived classes that keep one latest SensorHWData can avoid the mutex
+	// altogether: see PublishLatest.
 	virtual bool SensorHWGetLatest(SensorHWData *pData, SensorHWStatus *pStatus=NULL, bool raw=false) = 0;
 
 	//Optional GetLatest that returns different data based on what level is wanted,
@@ -224,6 +236,61 @@ class SensorHW {
 			SensorHWStatus *pStatus=NULL, bool raw=false)
 	{return SensorHWGetLatest(pData, pStatus, raw);}
 
+	// RETURNS: true if data is what SensorHWGetLatestOfLevel(level) would
+	//			return.  Lets callers of the history below filter it the
+	//			same way.  Default ignores level, like the default
+	//			SensorHWGetLatestOfLevel.
+	virtual bool SensorHWMatchesLevel(const SensorHWData &data,
+									  B2BLogic::Level level) const
+	{ return true; }
+
+	// History: the last HISTORY_CAPACITY SensorHWData passed to
+	// PublishLatest, so a caller polling slower than the sensor publishes
+	// still sees every sample.  None of these take a lock.
+	// Sensors that do not call PublishLatest keep no history: count is 0
+	// and visits visit nothing.  Use SensorHWGetLatest for those.
+	static const uint32_t HISTORY_CAPACITY = 64;
+
+	// RETURNS: number of SensorHWData ever published, 0 if no history
+	uint64_t SensorHWHistoryCount() const { return m_history.End(); }
+
+	// Calls visitor for each SensorHWData in history newer than since,
+	// oldest first.
+	// since: timestamp, 0 for all of history.  Samples with the same
+	//			timestamp as since are not visited, so two samples in the
+	//			same millisecond can be told apart only in one visit.
+	// RETURNS: number visited
+	uint32_t SensorHWVisitHistorySince(b2b::Timestamp since,
+								const SensorHWDataVisitor &visitor) const;
+
+	// Calls visitor for the last count SensorHWData in history, oldest
+	// first.
+	// RETURNS: number visited (less than count if history is shorter)
+	uint32_t SensorHWVisitHistoryLast(uint32_t count,
+								const SensorHWDataVisitor &visitor) const;
+
+	// Calls visitor for each SensorHWData in history from *pPosition to the
+	// newest, oldest first, and sets *pPosition past the newest.  For a
+	// caller that must see each sample exactly once, whatever its
+	// timestamp (SensorEventBus say).
+	// pPosition: 0, or SensorHWHistoryCount() to skip what is there now.
+	//			Updated.
+	// visitor: should return true.  Samples after one it returns false
+	//			for are lost.
+	// RETURNS: number of samples lost: overwritten before we got to them,
+	//			because the caller fell more than HISTORY_CAPACITY behind.
+	uint64_t SensorHWVisitHistoryFrom(uint64_t *pPosition,
+								const SensorHWDataVisitor &visitor) const;
+
+	// Called by SensorEventBus::AddProducer.  PublishLatest then notifies
+	// bus of each new sample.
+	// RETURNS: true on success, false if already on a different bus
+	bool SensorHWSetEventBus(SensorEventBus *bus);
+	// Called by SensorEventBus::RemoveProducer and its dtor.  Stop
+	// notifying bus.  Does nothing if we are on another bus, or none.
+	// RETURNS: true if we were on bus, false otherwise
+	bool SensorHWClearEventBus(SensorEventBus *bus);
+
 	// RETURNS: true if SensorHW has been enabled, false otherwise.
 	//			Only false if either of the following is true:
 	//			* IOConfig entry has "enable":false
@@ -290,6 +357,29 @@ class SensorHW {
 	// For protecting any derived class' data
 	mutable pthread_mutex_t m_lockSensorHW;
 
+	// Latest data, for SensorHWGetLatest without a lock.
+	// Thread that measures calls PublishLatest with each new data, holding
+	// m_lockSensorHW if other threads can publish too (SeqLock allows one
+	// writer at a time).  SensorHWGetLatest calls GetPublishedLatest, which
+	// never blocks, however often the measuring thread publishes.
+	// data also goes into history, see SensorHWVisitHistorySince.
+	// data also goes to our SensorEventBus, if any.
+	void PublishLatest(const SensorHWData &data)
+	{
+		m_latestSensorHWData.Write(data);
+		m_history.Append(data);
+		if (m_eventBus.load(boost::memory_order_acquire))
+			NotifyEventBus();
+	}
+	// Copies latest published data to pData.
+	// pStatus: OK, or NODATA if nothing with a timestamp was published.
+	//			Can be NULL.
+	// RETURNS: true if data exists, false otherwise
+	bool GetPublishedLatest(SensorHWData *pData,
+							SensorHWStatus *pStatus=NULL) const;
+	SeqLock<SensorHWData> m_latestSensorHWData;
+	HistoryRing<SensorHWData> m_history;	// every PublishLatest data
+
 	// DEBUG ONLY: 
 	// Inject test data so that next call to SensorHWGetLatest
 	//	 will return this value instead of real data.  Sets m_fakeSensorHWData.
@@ -307,6 +397,11 @@ class SensorHW {
   	bool m_enabled;   // true if driver enabled; see IsEnabled()
   	bool m_isValid;   // true if driver init'ed successfully; see IsValid()
 
+	boost::atomic<SensorEventBus *> m_eventBus; // see SensorHWSetEventBus
+
+	// Tell m_eventBus we published
+	void NotifyEventBus();
+
     // Helper function for the ctors
 	// RETURNS: true on success, false otherwise
 	bool CTORCommon(const IOConfig &ioConfig, 
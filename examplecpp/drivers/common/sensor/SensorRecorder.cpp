@@ -0,0 +1,212 @@
+//
+// SensorRecorder: appends every sample SensorHW publish to a recording file
+//
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "common/b2bassert.h"
+#include "common/B2BTime.h"
+#include "log/B2BLog.h"
+
+#include "SensorRecorder.h"
+
+SensorRecorder::SensorRecorder() :
+	m_fd(-1),
+	m_header(NULL),
+	m_records(NULL),
+	m_capacity(0),
+	m_mapSize(0),
+	m_numDropped(0)
+{
+	pthread_mutex_init(&m_lock, NULL);
+}
+
+SensorRecorder::~SensorRecorder()
+{
+	Close();
+	pthread_mutex_destroy(&m_lock);
+}
+
+bool SensorRecorder::MapRecords(uint64_t numRecords, std::string *pErr)
+{
+	size_t mapSize = sizeof(SensorRecording::RecordingHeader) +
+						(numRecords * sizeof(SensorRecording::Record));
+	if (ftruncate(m_fd, mapSize) != 0) {
+		if (pErr) *pErr = std::string("ftruncate failed: ") + strerror(errno);
+		return false; // FAIL
+	}
+
+	void *data = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+					  m_fd, 0);
+	if (data == MAP_FAILED) {
+		if (pErr) *pErr = std::string("mmap failed: ") + strerror(errno);
+		return false; // FAIL
+	}
+
+	// Old mapping's records are in the file, the new one sees them
+	Unmap();
+	m_header = static_cast<SensorRecording::RecordingHeader *>(data);
+	m_records = reinterpret_cast<SensorRecording::Record *>(m_header + 1);
+	m_capacity = numRecords;
+	m_mapSize = mapSize;
+
+	return true; // SUCCESS
+}
+
+void SensorRecorder::Unmap()
+{
+	if (m_header)
+		munmap(m_header, m_mapSize);
+	m_header = NULL;
+	m_records = NULL;
+	m_capacity = 0;
+	m_mapSize = 0;
+}
+
+bool SensorRecorder::Open(const char *fileName, std::string *pErr)
+{
+	b2bassert(fileName);
+
+	Close();
+
+	pthread_mutex_lock(&m_lock);
+	m_fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (m_fd < 0) {
+		if (pErr) *pErr = std::string("open failed: ") + strerror(errno);
+		pthread_mutex_unlock(&m_lock);
+		return false; // FAIL
+	}
+	if (!MapRecords(GROW_RECORDS, pErr)) {
+		close(m_fd);
+		m_fd = -1;
+		pthread_mutex_unlock(&m_lock);
+		return false; // FAIL
+	}
+
+	// ftruncate zeroed it, numSensors and numRecords are 0
+	memcpy(m_header->magic, SensorRecording::MAGIC,
+		   sizeof(SensorRecording::MAGIC));
+	m_header->version = SensorRecording::VERSION;
+	m_header->recordSize = sizeof(SensorRecording::Record);
+	m_header->levelTotal = B2BLogic::LEVEL_TOTAL;
+	m_numDropped = 0;
+	m_sensorHWs.clear();
+	pthread_mutex_unlock(&m_lock);
+
+	return true; // SUCCESS
+}
+
+void SensorRecorder::Close()
+{
+	pthread_mutex_lock(&m_lock);
+	if (m_header) {
+		uint64_t numRecords = m_header->numRecords;
+		Unmap();
+		// Cut the room we didn't use, so the file is just its records
+		if (ftruncate(m_fd, sizeof(SensorRecording::RecordingHeader) +
+						(numRecords * sizeof(SensorRecording::Record))) != 0)
+		{
+			B2BLog::Warn(LogFilt::LM_DRIVERS,
+						 "SensorRecorder::Close: ftruncate failed: %s",
+						 strerror(errno));
+		}
+	}
+	if (m_fd >= 0)
+		close(m_fd);
+	m_fd = -1;
+	pthread_mutex_unlock(&m_lock);
+}
+
+SensorRecorder::SensorId SensorRecorder::AddSensor(const SensorHW *sensorHW,
+												   const char *name)
+{
+	b2bassert(name);
+
+	pthread_mutex_lock(&m_lock);
+	if (!m_header ||
+			(m_header->numSensors >= SensorRecording::MAX_SENSORS)) {
+		pthread_mutex_unlock(&m_lock);
+		B2BLog::Err(LogFilt::LM_DRIVERS,
+					"SensorRecorder::AddSensor(%s): not open or too many sensors",
+					name);
+		return SensorRecording::MAX_SENSORS; // FAIL
+	}
+
+	SensorId id = m_header->numSensors;
+	strncpy(m_header->sensorNames[id], name,
+			SensorRecording::MAX_NAME_LENGTH); // last char stays 0
+	m_sensorHWs.push_back(sensorHW);
+	++m_header->numSensors;
+	pthread_mutex_unlock(&m_lock);
+
+	return id;
+}
+
+bool SensorRecorder::Record(SensorId id, const SensorHWData &data,
+							uint64_t timeNS)
+{
+	pthread_mutex_lock(&m_lock);
+	bool result = RecordLocked(id, data, timeNS);
+	pthread_mutex_unlock(&m_lock);
+
+	return result;
+}
+
+bool SensorRecorder::RecordLocked(SensorId id, const SensorHWData &data,
+								  uint64_t timeNS)
+{
+	if (!m_header || (id >= m_header->numSensors))
+		return false; // FAIL: not open or bad id
+
+	uint64_t numRecords = m_header->numRecords;
+	if ((numRecords == m_capacity) &&
+			!MapRecords(m_capacity + GROW_RECORDS, NULL)) {
+		if (!m_numDropped++) {
+			B2BLog::Err(LogFilt::LM_DRIVERS,
+						"SensorRecorder::Record: can't grow file, dropping");
+		}
+		return false; // FAIL
+	}
+
+	SensorRecording::ToRecord(id, data, timeNS, &m_records[numRecords]);
+	// After the record, so a reader never counts half of one
+	m_header->numRecords = numRecords + 1;
+
+	return true; // SUCCESS
+}
+
+void SensorRecorder::OnSensorEvent(const SensorEventBus::SensorEvent &event)
+{
+	uint64_t timeNS = B2BTime::GetCurrTimeMonotonicNS();
+
+	// Few sensors, a search is quicker than a map
+	pthread_mutex_lock(&m_lock);
+	for (SensorId id = 0; id < m_sensorHWs.size(); ++id) {
+		if (m_sensorHWs[id] == event.source) {
+			RecordLocked(id, event.data, timeNS);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&m_lock);
+}
+
+uint64_t SensorRecorder::NumRecords() const
+{
+	pthread_mutex_lock(&m_lock);
+	uint64_t numRecords = m_header ? m_header->numRecords : 0;
+	pthread_mutex_unlock(&m_lock);
+
+	return numRecords;
+}
+
+uint64_t SensorRecorder::NumDropped() const
+{
+	pthread_mutex_lock(&m_lock);
+	uint64_t numDropped = m_numDropped;
+	pthread_mutex_unlock(&m_lock);
+
+	return numDropped;
+}
@@ -0,0 +1,93 @@
+#pragma once
+//
+// SensorRecorder: appends every sample SensorHW publish to a recording
+//		file, for replay offline with SensorReplay.  See SensorRecording
+//		for the file.
+//
+//		The file is memory mapped and grown GROW_RECORDS at a time, so a
+//		record is one 32 byte copy into the mapping: no write() per record
+//		and no formatting.  The OS writes the pages out.
+//
+//		Samples usually come from a SensorEventBus: subscribe
+//		OnSensorEvent and each sample a producer publishes is recorded,
+//		with the time the bus delivered it.  Record can also be called
+//		directly.
+//
+//		For example:
+//			recorder.Open("/tmp/sensors.rec");
+//			recorder.AddSensor(soundHW, "sound");
+//			bus.Subscribe(SensorEventBus::Handler(&recorder,
+//									&SensorRecorder::OnSensorEvent));
+//			...
+//			recorder.Close();
+//
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "SensorEventBus.h"
+#include "SensorRecording.h"
+
+class SensorRecorder {
+  public:
+	typedef SensorRecording::SensorId SensorId;
+
+	// File grows by this many records at a time
+	static const uint32_t GROW_RECORDS = 65536;
+
+	SensorRecorder();
+	~SensorRecorder();	// Closes
+
+	// Create fileName, replacing any file there.  Any open file is closed
+	// first.
+	// pErr: errors, only valid if method returns false.  Can be NULL.
+	// RETURNS: true on success, false otherwise
+	bool Open(const char *fileName, std::string *pErr=NULL);
+	// Cut the file to the records written and close it.  OK if not open.
+	void Close();
+	bool IsOpen() const { return m_header != NULL; }
+
+	// Record samples of sensorHW under name.  Only while open.
+	// name: copied, cut to SensorRecording::MAX_NAME_LENGTH
+	// RETURNS: SensorId, SensorRecording::MAX_SENSORS if not open or
+	//			MAX_SENSORS already added
+	SensorId AddSensor(const SensorHW *sensorHW, const char *name);
+
+	// Append one sample
+	// id: from AddSensor
+	// timeNS: B2BTime::GetCurrTimeMonotonicNS() when the sample came
+	// RETURNS: true on success, false if not open, id is bad or the file
+	//			could not grow
+	bool Record(SensorId id, const SensorHWData &data, uint64_t timeNS);
+
+	// SensorEventBus::Handler: records event if its source was added
+	void OnSensorEvent(const SensorEventBus::SensorEvent &event);
+
+	// RETURNS: records written since Open
+	uint64_t NumRecords() const;
+	// RETURNS: samples not recorded, since Open: the file could not grow
+	uint64_t NumDropped() const;
+
+  private:
+	// Copying would unmap twice
+	SensorRecorder(const SensorRecorder &);
+	SensorRecorder &operator=(const SensorRecorder &);
+
+	// Map the file with room for numRecords.  Called with m_lock held.
+	// RETURNS: true on success, false otherwise
+	bool MapRecords(uint64_t numRecords, std::string *pErr);
+	void Unmap();
+	// Record, called with m_lock held
+	bool RecordLocked(SensorId id, const SensorHWData &data, uint64_t timeNS);
+
+	int m_fd;							// -1 if not open
+	SensorRecording::RecordingHeader *m_header;	// start of mapping
+	SensorRecording::Record *m_records;	// after m_header
+	uint64_t m_capacity;				// records mapping has room for
+	size_t m_mapSize;					// bytes
+	uint64_t m_numDropped;
+	std::vector<const SensorHW *> m_sensorHWs;	// index is SensorId
+	mutable pthread_mutex_t m_lock;		// for all of the above
+};
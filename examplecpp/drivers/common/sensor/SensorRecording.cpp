@@ -0,0 +1,165 @@
+//
+// SensorRecording: a recording of SensorHW samples
+//
+#include <string.h>
+#include <vector>
+
+#include "boost/static_assert.hpp"
+
+#include "common/b2bassert.h"
+#include "log/B2BLog.h"
+
+#include "SensorRecording.h"
+
+/*static*/ const char SensorRecording::MAGIC[8] =
+									{ 'B', '2', 'B', 'S', 'R', 'E', 'C', 0 };
+
+/*static*/ void SensorRecording::ToRecord(SensorId id, const SensorHWData &data,
+										  uint64_t timeNS, Record *pRecord)
+{
+	b2bassert(pRecord);
+
+	pRecord->timeNS = timeNS;
+	pRecord->sensorId = id;
+	pRecord->timestamp = data.timestamp;
+	pRecord->magnitude = data.vector.magnitude;
+	pRecord->angle = data.vector.angle;
+	pRecord->azimuth = data.vector.azimuth;
+	pRecord->level = data.level;
+}
+
+/*static*/ void SensorRecording::FromRecord(const Record &record,
+											SensorHWData *pData)
+{
+	b2bassert(pData);
+
+	pData->vector.magnitude = record.magnitude;
+	pData->vector.angle = record.angle;
+	pData->vector.azimuth = record.azimuth;
+	pData->level = (B2BLogic::Level)record.level;
+	pData->timestamp = record.timestamp;
+}
+
+bool SensorRecording::Open(const char *fileName, std::string *pErr)
+{
+	// Records follow the header, keep their uint64_t aligned
+	BOOST_STATIC_ASSERT((sizeof(RecordingHeader) % sizeof(uint64_t)) == 0);
+	BOOST_STATIC_ASSERT((sizeof(Record) % sizeof(uint64_t)) == 0);
+
+	Close();
+
+	if (!m_file.Map(fileName, pErr))
+		return false; // FAIL: no file
+
+	// Validate before we use it, a bad recording must not crash us
+	const size_t size = m_file.Size();
+	if (size < sizeof(RecordingHeader)) {
+		if (pErr) *pErr = "too small";
+		m_file.Unmap();
+		return false; // FAIL
+	}
+	const RecordingHeader *header =
+			reinterpret_cast<const RecordingHeader *>(m_file.Data());
+	if ((memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) ||
+		(header->version != VERSION) ||
+		(header->recordSize != sizeof(Record)) ||
+		(header->levelTotal != B2BLogic::LEVEL_TOTAL) ||
+		(header->numSensors > MAX_SENSORS))
+	{
+		if (pErr) *pErr = "not a recording, or other version";
+		m_file.Unmap();
+		return false; // FAIL
+	}
+
+	// Recorder may have grown the file past its records, or crashed
+	// before updating numRecords: trust whichever is less
+	uint64_t inFile = (size - sizeof(RecordingHeader)) / sizeof(Record);
+	m_numRecords = (header->numRecords < inFile) ? header->numRecords : inFile;
+	m_records = reinterpret_cast<const Record *>(
+								m_file.Data() + sizeof(RecordingHeader));
+	m_header = header;
+
+	return true; // SUCCESS
+}
+
+void SensorRecording::Close()
+{
+	m_header = NULL;
+	m_records = NULL;
+	m_numRecords = 0;
+	m_file.Unmap();
+}
+
+const char *SensorRecording::SensorName(SensorId id) const
+{
+	if (!m_header || (id >= m_header->numSensors))
+		return NULL; // FAIL: id out of range
+
+	return m_header->sensorNames[id]; // SUCCESS
+}
+
+SensorRecording::SensorId SensorRecording::FindSensor(const char *name) const
+{
+	b2bassert(name);
+
+	for (SensorId id = 0; id < NumSensors(); ++id) {
+		if (strncmp(m_header->sensorNames[id], name, MAX_NAME_LENGTH) == 0)
+			return id; // SUCCESS
+	}
+	return MAX_SENSORS; // FAIL: not found
+}
+
+void SensorRecording::GetSensorStats(uint64_t gapNS, SensorStats *pStats) const
+{
+	b2bassert(pStats);
+
+	const uint32_t numSensors = NumSensors();
+	memset(pStats, 0, numSensors * sizeof(SensorStats));
+	for (uint64_t i = 0; i < m_numRecords; ++i) {
+		const Record &record = m_records[i];
+		if (record.sensorId >= numSensors)
+			continue; // damaged record
+
+		SensorStats &stats = pStats[record.sensorId];
+		if (stats.count) {
+			uint64_t gap = (record.timeNS > stats.lastNS) ?
+									record.timeNS - stats.lastNS : 0;
+			if (gap > stats.maxGapNS)
+				stats.maxGapNS = gap;
+			if (gapNS && (gap > gapNS))
+				++stats.numGaps;
+		} else {
+			stats.firstNS = record.timeNS;
+		}
+		stats.lastNS = record.timeNS;
+		++stats.count;
+	}
+}
+
+void SensorRecording::LogReport(uint64_t gapNS) const
+{
+	if (!m_header) {
+		B2BLog::Info(LogFilt::LM_DRIVERS, "SensorRecording: not open");
+		return;
+	}
+
+	std::vector<SensorStats> stats(NumSensors());
+	if (!stats.empty())
+		GetSensorStats(gapNS, &stats[0]);
+
+	uint64_t lengthNS = m_numRecords ?
+			m_records[m_numRecords - 1].timeNS - m_records[0].timeNS : 0;
+	B2BLog::Info(LogFilt::LM_DRIVERS,
+				 "SensorRecording: %llu records, %u sensors, %.3fs",
+				 (unsigned long long)m_numRecords, NumSensors(),
+				 lengthNS / 1e9);
+	for (SensorId id = 0; id < stats.size(); ++id) {
+		const SensorStats &s = stats[id];
+		uint64_t spanNS = s.lastNS - s.firstNS;
+		B2BLog::Info(LogFilt::LM_DRIVERS,
+			"  %-20s n=%llu rate=%.1fHz maxGap=%.1fms gaps>%.1fms=%llu",
+			SensorName(id), (unsigned long long)s.count,
+			spanNS ? ((s.count - 1) * 1e9) / spanNS : 0.0,
+			s.maxGapNS / 1e6, gapNS / 1e6, (unsigned long long)s.numGaps);
+	}
+}
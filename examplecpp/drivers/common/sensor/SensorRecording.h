@@ -0,0 +1,115 @@
+#pragma once
+//
+// SensorRecording: a recording of SensorHW samples, as written by
+//		SensorRecorder and played back by SensorReplay.  This class reads
+//		one: it memory maps the file and hands out its records in place,
+//		no parsing and no copy.  LogReport says what is in it.
+//
+//		File layout (native byte order):
+//			RecordingHeader
+//			Record[numRecords]	in the order recorded
+//		Records are fixed size and the header comes first, so a record is
+//		found by index.  numRecords is updated after each record is
+//		written, so a file from a recorder that crashed is still good up
+//		to its last whole record.
+//
+#include <stdint.h>
+#include <string>
+
+#include "common/b2btypes.h"
+#include "common/FileUtil.h"
+
+#include "SensorHW.h"
+
+class SensorRecording {
+  public:
+	typedef uint32_t SensorId;	// index into header's sensor names
+	static const uint32_t MAX_SENSORS = 64;
+	static const uint32_t MAX_NAME_LENGTH = 31;	// without terminating 0
+
+	// Bump when RecordingHeader or Record changes
+	static const uint32_t VERSION = 1;
+
+	// One SensorHWData
+	// timeNS: when it was recorded, CLOCK_MONOTONIC in nanoseconds.
+	//		Replay is paced by this.
+	// sensorId: which sensor, see SensorName
+	// The rest is the SensorHWData, level as int32_t.
+	struct Record {
+		uint64_t timeNS;
+		uint32_t sensorId;
+		b2b::Timestamp timestamp;
+		b2b::Magnitude magnitude;
+		b2b::Angle angle;
+		b2b::Angle azimuth;
+		int32_t level;
+	};
+
+	struct RecordingHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t recordSize;	// sizeof(Record) when written
+		uint32_t levelTotal;	// B2BLogic::LEVEL_TOTAL when written
+		uint32_t numSensors;
+		uint64_t numRecords;	// whole records written
+		char sensorNames[MAX_SENSORS][MAX_NAME_LENGTH + 1];
+	};
+
+	// Magic at start of every recording file
+	static const char MAGIC[8];
+
+	// Copy SensorHWData to and from a Record
+	static void ToRecord(SensorId id, const SensorHWData &data,
+						 uint64_t timeNS, Record *pRecord);
+	static void FromRecord(const Record &record, SensorHWData *pData);
+
+	SensorRecording() : m_header(NULL), m_records(NULL), m_numRecords(0) {}
+
+	// Map fileName.  Any previous recording is closed first.
+	// pErr: errors, only valid if method returns false.  Can be NULL.
+	// RETURNS: true on success, false if file is missing or not a
+	//			recording
+	bool Open(const char *fileName, std::string *pErr=NULL);
+	void Close();
+
+	bool IsOpen() const { return m_header != NULL; }
+	uint32_t NumSensors() const { return m_header ? m_header->numSensors : 0; }
+	// RETURNS: name sensor was recorded with, NULL if id is out of range
+	const char *SensorName(SensorId id) const;
+	// RETURNS: SensorId of name, MAX_SENSORS if not in recording
+	SensorId FindSensor(const char *name) const;
+
+	// Records, in place in the file.  Valid until Close.
+	uint64_t NumRecords() const { return m_numRecords; }
+	const Record *Records() const { return m_records; }
+
+	// One sensor's samples in recording
+	// count: number of records
+	// firstNS, lastNS: timeNS of its first and last record
+	// maxGapNS: longest time between two of its records
+	// numGaps: times between two of its records longer than gapNS
+	struct SensorStats {
+		uint64_t count;
+		uint64_t firstNS;
+		uint64_t lastNS;
+		uint64_t maxGapNS;
+		uint64_t numGaps;
+	};
+	// Stats for every sensor in one pass over the records
+	// gapNS: see SensorStats::numGaps.  0 to not count gaps.
+	// pStats: NumSensors() of them, indexed by SensorId
+	void GetSensorStats(uint64_t gapNS, SensorStats *pStats) const;
+	// B2BLog::Info a line per sensor: samples, rate, gaps.  For looking at
+	// a recording from a menu or test program.
+	void LogReport(uint64_t gapNS) const;
+
+  private:
+	// Copying would unmap twice
+	SensorRecording(const SensorRecording &);
+	SensorRecording &operator=(const SensorRecording &);
+
+	FileUtil::MappedFile m_file;
+	const RecordingHeader *m_header;	// in m_file, NULL if not open
+	const Record *m_records;			// in m_file
+	uint64_t m_numRecords;
+};
@@ -0,0 +1,208 @@
+//
+// SensorReplay: plays a SensorRecording back through SensorHW
+//
+#include <time.h>
+
+#include "common/b2bassert.h"
+#include "common/B2BTime.h"
+#include "log/B2BLog.h"
+
+#include "SensorReplay.h"
+
+SensorReplayHW::SensorReplayHW(const IOConfig &ioConfig) :
+	SensorHW(ioConfig, (const char *)NULL) // no ioConfig entry
+{
+	SetValid();
+}
+
+SensorReplayHW::~SensorReplayHW()
+{
+}
+
+bool SensorReplayHW::SensorHWGetLatest(SensorHWData *pData,
+									   SensorHWStatus *pStatus, bool raw)
+{
+	// No lock: Replay publishes each record
+	return GetPublishedLatest(pData, pStatus);
+}
+
+void SensorReplayHW::Replay(const SensorHWData &data)
+{
+	// ReplayTo and our thread take turns, but PublishLatest wants one
+	// writer for sure
+	pthread_mutex_lock(&m_lockSensorHW);
+	PublishLatest(data);
+	pthread_mutex_unlock(&m_lockSensorHW);
+}
+
+SensorReplay::SensorReplay(const char *name, const SensorRecording &recording,
+						   const IOConfig &ioConfig) :
+	ThreadModule(name),
+	m_recording(recording),
+	m_next(0),
+	m_speed(1),
+	m_startSpeed(1),
+	m_startNS(0),
+	m_startOffsetNS(0)
+{
+	for (SensorId id = 0; id < recording.NumSensors(); ++id)
+		m_sensorHWs.push_back(new SensorReplayHW(ioConfig));
+	m_replayStats.replayed = 0;
+	m_replayStats.maxLateNS = 0;
+
+	pthread_mutex_init(&m_lock, NULL);
+	// Paced waits are against B2BTime::GetCurrTimeMonotonicNS's clock
+	pthread_condattr_t condAttr;
+	pthread_condattr_init(&condAttr);
+	pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+	pthread_cond_init(&m_cond, &condAttr);
+	pthread_condattr_destroy(&condAttr);
+}
+
+SensorReplay::~SensorReplay()
+{
+	Stop(NULL); // Stop our thread
+	for (size_t i = 0; i < m_sensorHWs.size(); ++i)
+		delete m_sensorHWs[i];
+
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_lock);
+}
+
+bool SensorReplay::Start(void *arg)
+{
+	pthread_mutex_lock(&m_lock);
+	const SensorRecording::Record *records = m_recording.Records();
+	m_startSpeed = m_speed;
+	m_startNS = B2BTime::GetCurrTimeMonotonicNS();
+	m_startOffsetNS = (m_next < m_recording.NumRecords()) ?
+					records[m_next].timeNS - records[0].timeNS : 0;
+	m_replayStats.replayed = 0;
+	m_replayStats.maxLateNS = 0;
+	pthread_mutex_unlock(&m_lock);
+
+	return ThreadModule::Start(arg);
+}
+
+void SensorReplay::WakeWorker()
+{
+	pthread_mutex_lock(&m_lock);
+	pthread_cond_broadcast(&m_cond);
+	pthread_mutex_unlock(&m_lock);
+}
+
+SensorHW *SensorReplay::GetSensorHW(SensorId id)
+{
+	if (id >= m_sensorHWs.size())
+		return NULL; // FAIL: id out of range
+
+	return m_sensorHWs[id]; // SUCCESS
+}
+
+SensorHW *SensorReplay::FindSensorHW(const char *name)
+{
+	return GetSensorHW(m_recording.FindSensor(name));
+}
+
+void SensorReplay::SetSpeed(float speed)
+{
+	pthread_mutex_lock(&m_lock);
+	m_speed = (speed > 0) ? speed : 0;
+	pthread_mutex_unlock(&m_lock);
+}
+
+void SensorReplay::ReplayNext()
+{
+	const SensorRecording::Record &record = m_recording.Records()[m_next++];
+	if (record.sensorId >= m_sensorHWs.size())
+		return; // damaged record
+
+	SensorHWData data;
+	SensorRecording::FromRecord(record, &data);
+	m_sensorHWs[record.sensorId]->Replay(data);
+	++m_replayStats.replayed;
+}
+
+uint64_t SensorReplay::ReplayTo(uint64_t offsetNS)
+{
+	uint64_t replayed = 0;
+	pthread_mutex_lock(&m_lock);
+	const SensorRecording::Record *records = m_recording.Records();
+	const uint64_t numRecords = m_recording.NumRecords();
+	while ((m_next < numRecords) &&
+		   ((records[m_next].timeNS - records[0].timeNS) <= offsetNS))
+	{
+		ReplayNext();
+		++replayed;
+	}
+	pthread_mutex_unlock(&m_lock);
+
+	return replayed;
+}
+
+void SensorReplay::Rewind()
+{
+	pthread_mutex_lock(&m_lock);
+	m_next = 0;
+	pthread_mutex_unlock(&m_lock);
+}
+
+bool SensorReplay::IsDone() const
+{
+	pthread_mutex_lock(&m_lock);
+	bool done = (m_next >= m_recording.NumRecords());
+	pthread_mutex_unlock(&m_lock);
+
+	return done;
+}
+
+void SensorReplay::GetReplayStats(ReplayStats *pStats) const
+{
+	b2bassert(pStats);
+
+	pthread_mutex_lock(&m_lock);
+	*pStats = m_replayStats;
+	pthread_mutex_unlock(&m_lock);
+}
+
+void *SensorReplay::Worker(void *arg)
+{
+	pthread_mutex_lock(&m_lock);
+	if (IsThreadCancelRequested()) {
+		pthread_mutex_unlock(&m_lock);
+		return NULL;
+	}
+
+	if (m_next >= m_recording.NumRecords()) {
+		// All replayed, nothing to do until Stop
+		pthread_cond_wait(&m_cond, &m_lock);
+		pthread_mutex_unlock(&m_lock);
+		return NULL;
+	}
+
+	const SensorRecording::Record *records = m_recording.Records();
+	uint64_t dueNS = m_startNS;
+	if (m_startSpeed > 0) {
+		uint64_t offsetNS = records[m_next].timeNS - records[0].timeNS
+														- m_startOffsetNS;
+		dueNS += (uint64_t)(offsetNS / (double)m_startSpeed);
+	}
+
+	uint64_t nowNS = B2BTime::GetCurrTimeMonotonicNS();
+	if (nowNS < dueNS) {
+		// Not yet.  Stop wakes us early.
+		struct timespec due;
+		due.tv_sec = dueNS / 1000000000ULL;
+		due.tv_nsec = dueNS % 1000000000ULL;
+		pthread_cond_timedwait(&m_cond, &m_lock, &due);
+		pthread_mutex_unlock(&m_lock);
+		return NULL;
+	}
+
+	if ((nowNS - dueNS) > m_replayStats.maxLateNS)
+		m_replayStats.maxLateNS = nowNS - dueNS;
+	ReplayNext();
+	pthread_mutex_unlock(&m_lock);
+
+	return NULL;
+}
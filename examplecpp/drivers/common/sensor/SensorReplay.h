@@ -0,0 +1,130 @@
+#pragma once
+//
+// SensorReplay: plays a SensorRecording back through SensorHW, so what a
+//		robot's sensors saw can be fed to SensorEngines offline, over and
+//		over, and faster than it happened.
+//		WARNING: Client must call Init() and Start() to enable this class,
+//		or call ReplayTo without starting it.
+//
+//		There is one SensorReplayHW per sensor in the recording.  Give
+//		those to SensorEngines (or a SensorEventBus) in place of the real
+//		SensorHW.  Each record is published by its SensorReplayHW with
+//		PublishLatest, as the real driver would: it is the latest sample,
+//		it goes into history and it notifies the bus.  Records are read
+//		in place from the mapped file, nothing is parsed.
+//
+//		Our thread publishes each record at its recorded time divided by
+//		speed, from when Start was called: speed 1 is the original timing,
+//		10 is ten times as fast, 0 is as fast as we can.  SensorHWData
+//		timestamps are the recorded ones, whatever the speed.
+//
+//		Replay can go faster than consumers can take: like any SensorHW,
+//		a SensorReplayHW keeps only HISTORY_CAPACITY samples, and a
+//		SensorEventBus more than that behind counts the rest as lost.  Use
+//		a speed where the bus's lost stays 0.
+//
+//		ReplayTo publishes records up to a time without our thread, for a
+//		caller that steps time itself (a test, say).
+//
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include "apps/common/IOConfig.h"
+#include "apps/common/ThreadModule.h"
+
+#include "SensorHW.h"
+#include "SensorRecording.h"
+
+// A SensorHW whose samples come from a SensorReplay
+class SensorReplayHW : public SensorHW {
+  public:
+	SensorReplayHW(const IOConfig &ioConfig);
+	virtual ~SensorReplayHW();
+
+	// START: SensorHW required virtuals.  See SensorHW for documentation
+	// Last record replayed.  raw is ignored, recording has what was
+	// published.
+	bool SensorHWGetLatest(SensorHWData *pData, SensorHWStatus *pStatus=NULL,
+						   bool raw=false);
+	// END: SensorHW required virtuals
+
+  private:
+	// Publish data, called by SensorReplay
+	void Replay(const SensorHWData &data);
+
+	friend class SensorReplay;
+};
+
+class SensorReplay : public ThreadModule {
+  public:
+	typedef SensorRecording::SensorId SensorId;
+
+	// name: passed to ThreadModule
+	// recording: must be open and stay open while we exist
+	// ioConfig: passed to each SensorReplayHW
+	SensorReplay(const char *name, const SensorRecording &recording,
+				 const IOConfig &ioConfig);
+	virtual ~SensorReplay();
+
+	// START: B2BModule virtuals.  See ThreadModule for documentation
+	bool Init() { return true; } // nothing to do
+	// Replays from where we are, paced from now
+	bool Start(void *arg);
+	// END: B2BModule virtuals
+
+	// RETURNS: SensorHW that replays sensor id, NULL if id is out of range
+	SensorHW *GetSensorHW(SensorId id);
+	// RETURNS: SensorHW that replays sensor name, NULL if not in recording
+	SensorHW *FindSensorHW(const char *name);
+
+	// speed: see above.  Takes effect at next Start.
+	void SetSpeed(float speed);
+
+	// Publish every record up to offsetNS after the recording's first
+	// record, that isn't published yet.  Not while our thread runs.
+	// RETURNS: number published
+	uint64_t ReplayTo(uint64_t offsetNS);
+
+	// Go back to the start of the recording.  Not while our thread runs.
+	void Rewind();
+
+	// RETURNS: true if every record has been published
+	bool IsDone() const;
+
+	// How replay is doing, since Start
+	// replayed: records published
+	// maxLateNS: most a record was published after its paced time.  How
+	//		fast replay can go is where this starts to grow.
+	struct ReplayStats {
+		uint64_t replayed;
+		uint64_t maxLateNS;
+	};
+	void GetReplayStats(ReplayStats *pStats) const;
+
+  protected:
+	// START: required protected virtual from ThreadModule
+	// Waits for next record's time and publishes it
+	void *Worker(void *arg);
+	// END: required protected virtual from ThreadModule
+
+	// ThreadModule virtual: wakes Worker if it is waiting, so it can quit
+	void WakeWorker();
+
+  private:
+	// Publish m_recording's record m_next and move on.  Called with
+	// m_lock held.
+	void ReplayNext();
+
+	const SensorRecording &m_recording;		// from ctor
+	std::vector<SensorReplayHW *> m_sensorHWs;	// index is SensorId
+
+	uint64_t m_next;			// index of next record to publish
+	float m_speed;				// from SetSpeed, for next Start
+	float m_startSpeed;			// m_speed at Start, what Worker paces by
+	uint64_t m_startNS;			// GetCurrTimeMonotonicNS at Start
+	uint64_t m_startOffsetNS;	// m_next's offset at Start
+	ReplayStats m_replayStats;
+	mutable pthread_mutex_t m_lock;	// for all of the above
+	pthread_cond_t m_cond;		// CLOCK_MONOTONIC, signalled by Stop
+};
@@ -197,6 +197,7 @@ void NaoSpeechRecognitionHW::onEvent(const std::string &key,
   m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
   m_speechHWData.m_textString = textString;
   m_speechHWData.m_confidence = confidence;
+  PublishLatest(m_data);
   pthread_mutex_unlock(&m_lockSensorHW);
 
   /// Parse the list of words that has been recognized by ALSpeechRecognition
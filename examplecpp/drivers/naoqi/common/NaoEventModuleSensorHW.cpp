@@ -107,6 +107,7 @@ void NaoEventModuleSensorHW::onEvent(const std::string &key,
 	  m_data.level = B2BLogic::LEVEL_MEDIUM;
 	  m_data.vector.magnitude = floatValue;
 	  m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
+	  PublishLatest(m_data);
 	  pthread_mutex_unlock(&m_lockSensorHW);
   	} // else: value is 0, sensor is not "present" (falling edge)
   } else if (value.isInt()) {
@@ -116,6 +117,7 @@ void NaoEventModuleSensorHW::onEvent(const std::string &key,
 	  m_data.level = B2BLogic::LEVEL_MEDIUM;
 	  m_data.vector.magnitude = intValue;
 	  m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
+	  PublishLatest(m_data);
 	  pthread_mutex_unlock(&m_lockSensorHW);
   	} // else: value is 0, sensor is not "present" (falling edge)
   } else if (value.isBool()) {
@@ -125,6 +127,7 @@ void NaoEventModuleSensorHW::onEvent(const std::string &key,
 	  m_data.level = B2BLogic::LEVEL_MEDIUM;
 	  m_data.vector.magnitude = 1.0;
 	  m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
+	  PublishLatest(m_data);
 	  pthread_mutex_unlock(&m_lockSensorHW);
   	} // else: value is 0, sensor is not "present" (falling edge)
   } else if (value.isArray()) {
@@ -134,6 +137,7 @@ void NaoEventModuleSensorHW::onEvent(const std::string &key,
 	  m_data.level = B2BLogic::LEVEL_MEDIUM;
 	  m_data.vector.magnitude = 1.0;
 	  m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
+	  PublishLatest(m_data);
 	  pthread_mutex_unlock(&m_lockSensorHW);
   	} // else: nothing in array, sensor is not "present" (falling edge)
   } else {
@@ -144,6 +148,7 @@ void NaoEventModuleSensorHW::onEvent(const std::string &key,
 	  m_data.level = B2BLogic::LEVEL_MEDIUM;
 	  m_data.vector.magnitude = 1.0;
 	  m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
+	  PublishLatest(m_data);
 	  pthread_mutex_unlock(&m_lockSensorHW);
   	} // else: nothing in value, sensor is not "present" (falling edge)
   }
@@ -157,16 +162,6 @@ bool NaoEventModuleSensorHW::SensorHWGetLatest(SensorHWData *pData,
 		return false; // FAIL: error in init()
 	}
 
-	bool result = true; // assume SUCCESS
-	pthread_mutex_lock(&m_lockSensorHW);
-	if (m_data.timestamp) {
-		*pData = m_data; // SUCCESS
-		if (pStatus) *pStatus = HWSTATUS_OK;
-	} else {
-		result = false; // FAIL: no data
-		if (pStatus) *pStatus = HWSTATUS_NODATA;
-	}
-	pthread_mutex_unlock(&m_lockSensorHW);
-
-	return result;
+	// No lock: onEvent publishes m_data each time it changes
+	return GetPublishedLatest(pData, pStatus);
 }
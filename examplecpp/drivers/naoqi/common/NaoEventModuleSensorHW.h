@@ -149,6 +149,8 @@ class NaoEventModuleSensorHW : public AL::ALModule, public virtual SensorHW
 
     AL::ALMemoryProxy fMemoryProxy;
 
-	// Holding area for latest data
+	// Holding area for latest data.  Whoever changes it calls
+	// PublishLatest(m_data) before unlocking m_lockSensorHW, since
+	// SensorHWGetLatest reads what was published, not m_data.
 	SensorHWData m_data;
 };
@@ -40,12 +40,6 @@ NaoSoundDirectionHW::NaoSoundDirectionHW(boost::shared_ptr<AL::ALBroker> broker,
 	B2BLog::Debug(LogFilt::LM_DRIVERS, "%s: confidenceThreshold: %.1g sensitivityThreshold: %.1g",
 			  		getName().c_str(), 
 					m_confidenceThreshold, m_sensitivityThreshold);
-
-	// Create vector with all timestamp 0.  Indexed from LOW to HIGH.
-	for (int level = B2BLogic::LEVEL_LOW; level < B2BLogic::LEVEL_TOTAL;++level)
-	{
-		m_levelSoundData.push_back(SensorHWData());
-	}
 }
 
 void NaoSoundDirectionHW::init()
@@ -110,7 +104,8 @@ void NaoSoundDirectionHW::onEvent(const std::string &key,
   m_data.vector.azimuth = B2BMath::RadiansToDegrees(localizationInfo[1]);
   m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
   m_data.level = level;
-  m_levelSoundData[level] = m_data;
+  m_levelSoundData[level].Write(m_data);
+  PublishLatest(m_data);
   //B2BLog::Info(LogFilt::LM_DRIVERS, "%s: %s %s",
   //				getName().c_str(), localizationInfo.toString().c_str(),
   //				B2BLogic::LevelToString(level));
@@ -133,17 +128,15 @@ bool NaoSoundDirectionHW::SensorHWGetLatestOfLevel(B2BLogic::Level level,
 		return false; // invalid level
 	}
 
-	bool result = true; // assume SUCCESS
-	SensorHWData *dataP = &m_levelSoundData[level];
-	pthread_mutex_lock(&m_lockSensorHW);
-	if (dataP->timestamp && (dataP->timestamp > since)) {
-		*pData = *dataP; // SUCCESS
-		if (pStatus) *pStatus = HWSTATUS_OK;
-	} else {
-		result = false; // FAIL: no data
+	// No lock: onEvent publishes each level as it changes
+	SensorHWData data;
+	m_levelSoundData[level].Read(&data);
+	if (!data.timestamp || (data.timestamp <= since)) {
 		if (pStatus) *pStatus = HWSTATUS_NODATA;
+		return false; // FAIL: no data
 	}
-	pthread_mutex_unlock(&m_lockSensorHW);
 
-	return result;
+	*pData = data; // SUCCESS
+	if (pStatus) *pStatus = HWSTATUS_OK;
+	return true;
 }
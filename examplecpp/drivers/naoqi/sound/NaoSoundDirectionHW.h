@@ -34,13 +34,18 @@ class NaoSoundDirectionHW : public NaoEventModuleSensorHW {
 	virtual bool SensorHWGetLatestOfLevel(B2BLogic::Level level,
 			b2b::Timestamp since, SensorHWData *pData,
 			SensorHWStatus *pStatus=NULL, bool raw=false);
+	// Matches only data of exactly level, like SensorHWGetLatestOfLevel
+	virtual bool SensorHWMatchesLevel(const SensorHWData &data,
+									  B2BLogic::Level level) const
+	{ return data.level == level; }
 	////// END: override virtual from SensorHW.  See that class for doc
 
   private:
   	float m_confidenceThreshold; // from IOConfig "confidenceThreshold"
   	float m_sensitivityThreshold; // from IOConfig "sensitivityThreshold"
 
-	// one entry for each level.  Index from LOW to HIGH
-	typedef std::vector<SensorHWData> LevelSoundData;
-	LevelSoundData m_levelSoundData;
+	// Latest data of each level, indexed by level (LEVEL_NONE is never
+	// written).  onEvent writes with m_lockSensorHW held,
+	// SensorHWGetLatestOfLevel reads without a lock.
+	SeqLock<SensorHWData> m_levelSoundData[B2BLogic::LEVEL_TOTAL];
 };
@@ -182,6 +182,7 @@ void NaoFaceDetectionHW::onEvent(const std::string &key,
     		m_data.vector.magnitude = m_faceHWData.m_confidence;
   		}
     	m_data.timestamp = B2BTime::GetCurrentB2BTimestamp();
+    	PublishLatest(m_data);
   		pthread_mutex_unlock(&m_lockSensorHW);
 	}
 }
@@ -0,0 +1,233 @@
+#include "common/b2bassert.h"
+#include "common/B2BMath.h"
+#include "common/B2BTime.h"
+#include "log/B2BLog.h"
+
+#include "FusionSensorEngine.h"
+
+FusionSensorEngine::FusionSensorEngine(const char *name,
+					   ModuleApplicator* applicator,
+					   PersonalityEngine* pe, char singleCharID,
+					   b2b::TimeMS gridPeriodMS,
+					   b2b::TimeMS risingEdgeMinPeriodMS,
+					   B2BLogic::Level triggerLevel) :
+	SensorEngine(name, applicator, pe, singleCharID, NULL, triggerLevel),
+	m_fusionSensorData(Name()),
+	m_totalWeight(0),
+	m_gridPeriodMS(gridPeriodMS ? gridPeriodMS : 1),
+	m_risingEdgeMinPeriodMS(risingEdgeMinPeriodMS),
+	m_timeOfLastRisingEdge(0)
+{
+	AddTrait("Object");
+}
+
+FusionSensorEngine::~FusionSensorEngine()
+{
+}
+
+FusionSensorEngine::InputId FusionSensorEngine::AddInput(SensorHW *sensorHW,
+					 float weight, b2b::TimeMS latencyMS, b2b::TimeMS staleMS)
+{
+	if (!sensorHW || (weight <= 0)) {
+		B2BLog::Err(LogFilt::LM_SENSOR,
+					"%s::AddInput: no SensorHW or weight %f <= 0",
+					Name(), weight);
+		return INPUT_INVALID; // FAIL
+	}
+
+	Input input;
+	input.sensorHW = sensorHW;
+	input.weight = weight;
+	input.latencyMS = latencyMS;
+	input.staleMS = staleMS;
+	input.usedTimestamp = 0;
+	m_inputs.push_back(input);
+	m_totalWeight += weight;
+
+	return m_inputs.size() - 1;
+}
+
+bool FusionSensorEngine::PrePoll()
+{
+    //Before we poll, remove the current sensor data.
+    if(!IsFakeDataAvailable()){
+        DecrementValue(m_fusionSensorData.GetValue());
+        m_fusionSensorData.SetValue(0);
+        GetData()->RemoveSourceByPointer(&m_fusionSensorData);
+    }
+    return Neuron::PrePoll();
+}
+
+bool FusionSensorEngine::OnPollAction()
+{
+	if(!GetData())
+		return false;
+
+	// One clock read per poll, for the grid and the rising edge
+	b2b::Timestamp now = B2BTime::GetCurrentB2BTimestamp();
+	if (FuseInputs(now, &m_fusionSensorData)
+			&& m_fusionSensorData.m_numInputsUsed) {
+		// We have new sensor data, and we have a object (or edge), set P
+		if((m_risingEdgeMinPeriodMS == 0)
+				||
+			((now - m_timeOfLastRisingEdge) > m_risingEdgeMinPeriodMS))
+		{
+			m_timeOfLastRisingEdge = now;
+		    m_fusionSensorData.SetValue(1);
+			StartAtRisingEdge();
+		} // else: too soon since last rising edge, don't do it again
+
+	    IncrementValue(m_fusionSensorData.GetValue());
+	    GetData()->AddSource(&m_fusionSensorData);
+	} // else: no new data
+
+    return Neuron::OnPollAction();
+}
+
+// Finds newest sample at or before a grid time, for AlignInput.  Visits
+// oldest first, so the last one it keeps is the newest.
+class AlignedSampleFinder {
+  public:
+	AlignedSampleFinder(const SensorHW *sensorHW, B2BLogic::Level level,
+						b2b::Timestamp lastTimestamp, SensorHWData *pSample) :
+		m_sensorHW(sensorHW),
+		m_level(level),
+		m_lastTimestamp(lastTimestamp),
+		m_pSample(pSample)
+	{}
+
+	bool operator()(const SensorHWData &data) const
+	{
+		if (data.timestamp > m_lastTimestamp)
+			return false; // after grid time, and so is the rest
+		if ((m_level == B2BLogic::LEVEL_TOTAL) ||
+				m_sensorHW->SensorHWMatchesLevel(data, m_level))
+			*m_pSample = data;
+		return true; // keep going
+	}
+
+  private:
+	const SensorHW *m_sensorHW;
+	B2BLogic::Level m_level;
+	b2b::Timestamp m_lastTimestamp;	// newest timestamp at or before grid
+	SensorHWData *m_pSample;
+};
+
+void FusionSensorEngine::AlignInput(Input *pInput, b2b::Timestamp gridTime)
+{
+	SensorHW *sensorHW = pInput->sensorHW;
+
+	if (!sensorHW->SensorHWHistoryCount()) {
+		// No history, newest sample is all there is.  Take it even if it
+		// is after gridTime: it won't be there next poll.
+		SensorHWData sensorHWData;
+		bool gotLatest;
+		if (m_triggerLevel == B2BLogic::LEVEL_TOTAL) {
+			// Any level: SensorHWGetLatestOfLevel takes no wildcard
+			gotLatest = sensorHW->SensorHWGetLatest(&sensorHWData);
+		} else {
+			gotLatest = sensorHW->SensorHWGetLatestOfLevel(m_triggerLevel,
+								pInput->sample.timestamp, &sensorHWData);
+		}
+		if (gotLatest)
+			pInput->sample = sensorHWData;
+		return;
+	}
+
+	// A sample's event time is its timestamp minus latencyMS: samples up
+	// to gridTime plus latencyMS are at or before gridTime.  Only those
+	// newer than the sample we have can be better.
+	AlignedSampleFinder finder(sensorHW, m_triggerLevel,
+							   gridTime + pInput->latencyMS, &pInput->sample);
+	sensorHW->SensorHWVisitHistorySince(pInput->sample.timestamp,
+							SensorHWDataVisitor::FromPointer(&finder));
+}
+
+bool FusionSensorEngine::FuseInputs(b2b::Timestamp now,
+									FusionSensorEngineData *pData)
+{
+	b2bassert(pData);
+
+	b2b::Timestamp gridTime = now - (now % m_gridPeriodMS);
+
+	bool newData = false;
+	float usedWeight = 0;
+	float maxWeight = 0;
+	uint32_t numInputsUsed = 0;
+	B2BMath::Vector3DRect sum;
+	B2BLogic::Level level = B2BLogic::LEVEL_TOTAL;
+	for (size_t i = 0; i < m_inputs.size(); ++i) {
+		Input &input = m_inputs[i];
+		AlignInput(&input, gridTime);
+		if (!input.sample.timestamp)
+			continue; // no data yet
+
+		// Age at gridTime of the event, not of the timestamp
+		b2b::Timestamp eventTime = (input.sample.timestamp > input.latencyMS) ?
+							input.sample.timestamp - input.latencyMS : 0;
+		b2b::TimeMS age = (gridTime > eventTime) ? gridTime - eventTime : 0;
+		float weight = input.weight;
+		if (input.staleMS) {
+			if (age >= input.staleMS)
+				continue; // stale, counts for nothing
+			weight *= (float)(input.staleMS - age) / input.staleMS;
+		}
+
+		if (input.sample.timestamp != input.usedTimestamp) {
+			input.usedTimestamp = input.sample.timestamp;
+			newData = true;
+		}
+
+		sum += (B2BMath::Vector3DRect)input.sample.vector * weight;
+		usedWeight += weight;
+		++numInputsUsed;
+		if (weight > maxWeight) {
+			maxWeight = weight;
+			level = input.sample.level;
+		}
+	}
+
+	pData->m_numInputsUsed = numInputsUsed;
+	if (!numInputsUsed) {
+		pData->m_fusedData.timestamp = 0; // mark as invalid
+		pData->m_confidence = 0;
+		return false; // nothing to fuse
+	}
+
+	pData->m_fusedData.vector = (B2BMath::Vector3D)(sum / usedWeight);
+	pData->m_fusedData.level = level;
+	pData->m_fusedData.timestamp = gridTime ? gridTime : 1; // 0 is invalid
+	pData->m_confidence = usedWeight / m_totalWeight;
+
+	return newData;
+}
+
+// TEST and DEBUG ONLY!!!
+void FusionSensorEngine::DebugSetSensorPValue(Cue newValue, bool setSensorData)
+{
+	if(!GetData())
+		return;
+
+    PrePoll();
+
+	if (setSensorData && (newValue > 0)) {
+	  // Reset vector to all 0 angles, which is legal
+	  m_fusionSensorData.m_fusedData.vector.Reset();
+	  m_fusionSensorData.m_fusedData.vector.magnitude = 0.3; // half of max
+	  m_fusionSensorData.m_fusedData.level = B2BLogic::LEVEL_MEDIUM;
+	  // Load w/ valid "now" timestmap
+	  m_fusionSensorData.m_fusedData.timestamp =
+	  						B2BTime::GetCurrentB2BTimestamp();
+	  m_fusionSensorData.m_confidence = 1;
+	  m_fusionSensorData.m_numInputsUsed = m_inputs.size();
+
+	  // NeuronData stuff
+	  m_fusionSensorData.SetValue(1);
+	  IncrementValue(m_fusionSensorData.GetValue());
+
+	  // Add this data to our Neuron
+	  GetData()->AddSource(&m_fusionSensorData);
+	}
+
+	SensorEngine::DebugSetSensorPValue(newValue, false);
+}
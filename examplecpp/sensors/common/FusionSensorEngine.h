@@ -0,0 +1,137 @@
+#pragma once
+//
+// FusionSensorEngine: fuses any number of SensorHW into one vector, like
+//		FrontRearObjectSensorEngine does for two but without always
+//		preferring one of them.
+//
+//		Each input (AddInput) has:
+//		* weight: how much it counts against the others
+//		* latencyMS: how long after the event its sample's timestamp is.
+//			We subtract it, so a slow sensor's sample is compared with a
+//			fast one's from the same moment.
+//		* staleMS: sample older than this counts for nothing.  A sample's
+//			weight goes down linearly as it ages towards staleMS.
+//
+//		Each poll is aligned on a grid of gridPeriodMS: the poll's time is
+//		rounded down to it, and from each input we take the newest sample
+//		whose event time (timestamp minus latencyMS) is at or before that
+//		grid time.  So every input is sampled at the same moment, whatever
+//		order or rate they publish at.  Samples after the grid time wait
+//		for a later poll.  For inputs that keep history (see SensorHW)
+//		these are picked from history; for others it is the latest sample.
+//
+//		Fused vector is the weighted average of the inputs' vectors, in
+//		rectangular coordinates.  Confidence is the weight that took part
+//		over all the weight there is: 1 when every input is fresh, 0 when
+//		none has anything.
+//
+//		Inputs are sized by AddInput, so polls allocate nothing.
+//
+//		For example:
+//			FusionSensorEngine fusion("Fusion", applicator, pe, 'F', 20, 2000);
+//			fusion.AddInput(frontHW, 1.0, 0, 500);
+//			fusion.AddInput(rearHW, 0.5, 30, 500);	// slower, counts less
+//
+#include <stdint.h>
+#include <vector>
+
+#include "common/b2btypes.h"
+#include "drivers/common/sensor/SensorHW.h"
+#include "SensorData.h"
+
+#include "SensorEngine.h"
+
+class FusionSensorEngine : public SensorEngine {
+  public:
+	// name,singleCharID: see SensorEngine for documentation
+	// gridPeriodMS: poll time is rounded down to this, see above.  0 is
+	//		treated as 1 (no rounding).
+	// risingEdgeMinPeriodMS: used by OnPollAction().   We send a rising edge
+	//		no faster than this time period.  Set to 0 to disable this feature.
+	// triggerLevel: only samples of this level count, see
+	//		SensorHW::SensorHWMatchesLevel.  LEVEL_TOTAL (default): samples
+	//		of any level count, SensorHWMatchesLevel is not asked.
+	FusionSensorEngine(const char *name, ModuleApplicator* applicator,
+					   PersonalityEngine* pe, char singleCharID,
+					   b2b::TimeMS gridPeriodMS,
+					   b2b::TimeMS risingEdgeMinPeriodMS,
+					   B2BLogic::Level triggerLevel=B2BLogic::LEVEL_TOTAL);
+	virtual ~FusionSensorEngine();
+
+	typedef uint32_t InputId;	// in order added, from 0
+	static const InputId INPUT_INVALID = 0xffffffff;
+
+	// Add sensorHW to fuse.  Not while polling.
+	// weight: must be > 0
+	// latencyMS: see above
+	// staleMS: see above.  0 to never go stale (and never lose weight)
+	// RETURNS: InputId, INPUT_INVALID if sensorHW is NULL or weight <= 0
+	InputId AddInput(SensorHW *sensorHW, float weight,
+					 b2b::TimeMS latencyMS, b2b::TimeMS staleMS);
+
+	uint32_t NumInputs() const { return m_inputs.size(); }
+
+	class FusionSensorEngineData: public SensorData {
+	public:
+		FusionSensorEngineData(const char *source) :
+			SensorData(source), m_confidence(0), m_numInputsUsed(0) {}
+		virtual ~FusionSensorEngineData() {}
+
+		virtual FusionSensorEngineData *clone() const
+			{ return new FusionSensorEngineData(*this); }
+
+		// vector: weighted average of inputs
+		// level: level of the input that counted most
+		// timestamp: grid time, 0 if invalid
+		SensorHWData m_fusedData;
+		float m_confidence;			// 0 to 1, see above
+		uint32_t m_numInputsUsed;	// inputs that counted, not stale
+	};
+
+	//Store and update the sensor data.
+	FusionSensorEngineData m_fusionSensorData;
+
+    // START: SensorEngine required methods.  See that class for documentation
+    virtual bool PrePoll();
+    virtual bool OnPollAction(); // Fuse inputs at this poll's grid time
+    // END: SensorEngine required methods.
+
+    // START: SensorEngine override.  See that class for documentation.
+	// setSensorData: if true and P has been changed to 1, sets
+	//					m_fusionSensorData.m_fusedData.timestamp to "now"
+	//					and magnitude 0.3, vector all 0s, level MEDIUM,
+	//					confidence 1.
+	// 				  if false, m_fusionSensorData is not altered.
+	// PAY ATTENTION!!!! This method is for TEST AND DEBUG ONLY!!!!
+	virtual void DebugSetSensorPValue(Cue newValue, bool setSensorData=true);
+
+  protected:
+	// Pick each input's sample for the grid time of now and fuse them into
+	// pData.
+	// now: B2BTime::GetCurrentB2BTimestamp(), read once per poll
+	// RETURNS: true if some input has a sample it didn't have last call,
+	//			false otherwise (pData is still set)
+	bool FuseInputs(b2b::Timestamp now, FusionSensorEngineData *pData);
+
+  private:
+	struct Input {
+		SensorHW *sensorHW;
+		float weight;
+		b2b::TimeMS latencyMS;
+		b2b::TimeMS staleMS;
+		SensorHWData sample;		// aligned sample, timestamp 0 if none
+		b2b::Timestamp usedTimestamp; // sample's timestamp at last fuse
+	};
+
+	// Update input.sample to the newest sample at or before gridTime
+	void AlignInput(Input *pInput, b2b::Timestamp gridTime);
+
+	std::vector<Input> m_inputs;
+	float m_totalWeight;				// of all m_inputs
+	b2b::TimeMS m_gridPeriodMS;			// from ctor
+	b2b::TimeMS m_risingEdgeMinPeriodMS; // from ctor
+	b2b::Timestamp m_timeOfLastRisingEdge;
+
+	// tests and test menus needs access to privates
+	friend class CreatureMenu;
+};
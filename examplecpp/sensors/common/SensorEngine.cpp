@@ -70,6 +70,78 @@ bool SensorEngine::GetLatestSensorHWData(SensorHW *sensorHW,
 	return ret;
 }
 
+// Passes VisitNewSensorHWData's samples on to the caller's visitor
+class NewSensorHWDataFilter {
+  public:
+	NewSensorHWDataFilter(const SensorHW *sensorHW, B2BLogic::Level level,
+						  b2b::TimeMS timeWindow,
+						  b2b::Timestamp *pLastSensorHWDataTimestamp,
+						  const SensorHWDataVisitor &visitor) :
+		m_sensorHW(sensorHW),
+		m_level(level),
+		m_now(B2BTime::GetCurrentB2BTimestamp()),
+		m_timeWindow(timeWindow),
+		m_pLastSensorHWDataTimestamp(pLastSensorHWDataTimestamp),
+		m_visitor(visitor),
+		m_visited(0)
+	{}
+
+	bool operator()(const SensorHWData &data) const
+	{
+		if (!m_sensorHW->SensorHWMatchesLevel(data, m_level))
+			return true; // not ours, keep going
+
+		// Seen, even if too old, same as GetLatestSensorHWData
+		*m_pLastSensorHWDataTimestamp = data.timestamp;
+		if (m_timeWindow && ((m_now - data.timestamp) > m_timeWindow))
+			return true; // too old, keep going
+
+		++m_visited;
+		return m_visitor(data);
+	}
+
+	uint32_t Visited() const { return m_visited; }
+
+  private:
+	const SensorHW *m_sensorHW;
+	B2BLogic::Level m_level;
+	b2b::Timestamp m_now;
+	b2b::TimeMS m_timeWindow;
+	b2b::Timestamp *m_pLastSensorHWDataTimestamp;
+	const SensorHWDataVisitor &m_visitor;
+	mutable uint32_t m_visited;
+};
+
+uint32_t SensorEngine::VisitNewSensorHWData(SensorHW *sensorHW,
+							 b2b::Timestamp *pLastSensorHWDataTimestamp,
+							 const SensorHWDataVisitor &visitor,
+							 b2b::TimeMS timeWindow)
+{
+	if (!sensorHW)
+		return 0; // no sensor
+
+	if (!sensorHW->SensorHWHistoryCount()) {
+		// No history, newest sample is all there is
+		SensorHWData sensorHWData;
+		if (!GetLatestSensorHWData(sensorHW, pLastSensorHWDataTimestamp,
+								   &sensorHWData, timeWindow))
+		{
+			return 0; // no new sensor data
+		}
+		visitor(sensorHWData);
+		return 1;
+	}
+
+	pthread_mutex_lock(&m_lck);
+	NewSensorHWDataFilter filter(sensorHW, m_triggerLevel, timeWindow,
+								 pLastSensorHWDataTimestamp, visitor);
+	sensorHW->SensorHWVisitHistorySince(*pLastSensorHWDataTimestamp,
+							SensorHWDataVisitor::FromPointer(&filter));
+	pthread_mutex_unlock(&m_lck);
+
+	return filter.Visited();
+}
+
 // TEST and DEBUG ONLY!!!
 void SensorEngine::DebugSetSensorPValue(Cue newValue, bool setSensorData)
 {
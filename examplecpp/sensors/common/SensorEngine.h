@@ -20,8 +20,7 @@ Design
 #include "neural/Typedefs.h"
 #include "common/B2BLogic.h"
 
-class SensorHW;
-class SensorHWData;
+#include "drivers/common/sensor/SensorHW.h"
 
 class SensorEngine : public Neuron {
   public:
@@ -68,6 +67,24 @@ class SensorEngine : public Neuron {
 									pSensorHWData, timeWindow);
 	}
 
+	// Same as GetLatestSensorHWData, but calls visitor for every new sample
+	// instead of returning only the newest one.  So a sample that came and
+	// was replaced between two calls is still seen.
+	// Samples visited are the ones in sensorHW's history (see
+	// SensorHW::SensorHWVisitHistorySince) newer than last call, matching
+	// triggerLevel (see SensorHW::SensorHWMatchesLevel) and within
+	// timeWindow, oldest first.
+	// If sensorHW keeps no history, visits the sample GetLatestSensorHWData
+	// returns, if it returns true.
+	// visitor: called with m_lck held.  Must not call back into us.
+	// RETURNS: number of samples visited
+	uint32_t VisitNewSensorHWData(const SensorHWDataVisitor &visitor,
+								  b2b::TimeMS timeWindow=0)
+	{
+		return VisitNewSensorHWData(m_sensorHW, &m_lastSensorHWDataTimestamp,
+									visitor, timeWindow);
+	}
+
 	virtual void ChangePersonalities();
 
   protected:
@@ -76,6 +93,10 @@ class SensorEngine : public Neuron {
 							 b2b::Timestamp *pLastSensorHWDataTimestamp,
 							 SensorHWData *pSensorHWData, 
 							 b2b::TimeMS timeWindow=0);
+	uint32_t VisitNewSensorHWData(SensorHW *sensorHW,
+							 b2b::Timestamp *pLastSensorHWDataTimestamp,
+							 const SensorHWDataVisitor &visitor,
+							 b2b::TimeMS timeWindow=0);
 
 	// START: Override of Neuron
 	// Set the sensor's P value to newValue
@@ -112,4 +133,6 @@ class SensorEngine : public Neuron {
 	// tests and GUI need access to privates
     friend class GraphicNode;
 	friend class CreatureMenu;
+	// polls us in place of the clock
+	friend class SensorPollScheduler;
 };
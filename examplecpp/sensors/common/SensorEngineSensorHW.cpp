@@ -71,22 +71,49 @@ bool SensorEngineSensorHW::PrePoll()
     return Neuron::PrePoll();
 }
 
+// Keeps newest sample that triggers the neuron
+class SensorHWTriggerFinder {
+  public:
+	SensorHWTriggerFinder(B2BLogic::Level triggerLevel,
+						  SensorHWData *pSensorHWData, bool *pFound) :
+		m_triggerLevel(triggerLevel),
+		m_pSensorHWData(pSensorHWData),
+		m_pFound(pFound)
+	{}
+
+	bool operator()(const SensorHWData &sensorHWData) const
+	{
+		if ((m_triggerLevel == B2BLogic::LEVEL_NONE) ||
+			(sensorHWData.level >= m_triggerLevel))
+		{
+			*m_pSensorHWData = sensorHWData;
+			*m_pFound = true;
+		}
+		return true; // look at all of them, a later one may trigger too
+	}
+
+  private:
+	B2BLogic::Level m_triggerLevel;
+	SensorHWData *m_pSensorHWData;
+	bool *m_pFound;
+};
+
 bool SensorEngineSensorHW::PollSensorHW(B2BLogic::Level triggerLevel)
 {
+	// Look at every sample since last poll, not just the newest, so one
+	// that triggers isn't lost behind a newer one that doesn't
 	SensorHWData sensorHWData;
-	if (GetLatestSensorHWData(&sensorHWData)) {
-		// We have new sensor HW data
-		if ((triggerLevel == B2BLogic::LEVEL_NONE) ||
-			(sensorHWData.level >= triggerLevel))
-		{
-			// We have HW data that triggers the neuron, set P and store HW data
-		    //m_sensorData.SetValue(sensorHWData.vector.magnitude);
-		    m_sensorData.SetValue(1); //FIXME: This is for debug and demo only
-			m_sensorData.m_sensorHWData = sensorHWData;
-			IncrementValue(m_sensorData.GetValue());
-            GetData()->AddSource(&m_sensorData);
-		} // else: no triggering of neuron
-	} // else: no new data
+	bool found = false;
+	VisitNewSensorHWData(SensorHWTriggerFinder(triggerLevel, &sensorHWData,
+											   &found));
+	if (found) {
+		// We have HW data that triggers the neuron, set P and store HW data
+	    //m_sensorData.SetValue(sensorHWData.vector.magnitude);
+	    m_sensorData.SetValue(1); //FIXME: This is for debug and demo only
+		m_sensorData.m_sensorHWData = sensorHWData;
+		IncrementValue(m_sensorData.GetValue());
+        GetData()->AddSource(&m_sensorData);
+	} // else: no new data, or none that triggers the neuron
 
 	return Neuron::OnPollAction();
 }
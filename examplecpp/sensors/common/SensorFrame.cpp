@@ -0,0 +1,58 @@
+#include "common/b2bassert.h"
+#include "log/B2BLog.h"
+
+#include "drivers/common/sensor/SensorHW.h"
+
+#include "SensorFrame.h"
+
+SensorFrame::SensorFrame() :
+	m_tick(0)
+{
+}
+
+SensorFrame::SensorId SensorFrame::AddSensor(SensorHW *sensorHW,
+											 const char *name, bool raw)
+{
+	b2bassert(name);
+	if (!sensorHW) {
+		B2BLog::Err(LogFilt::LM_SENSOR, "SensorFrame::AddSensor(%s): no SensorHW",
+					name);
+		return SENSOR_INVALID; // FAIL
+	}
+
+	SensorId id = m_sensorHWs.size();
+	m_sensorHWs.push_back(sensorHW);
+	m_names.push_back(name);
+	m_raw.push_back(raw);
+
+	m_magnitudes.push_back(0);
+	m_angles.push_back(0);
+	m_azimuths.push_back(0);
+	m_levels.push_back(B2BLogic::LEVEL_TOTAL);
+	m_timestamps.push_back(0); // no data until Fill
+
+	return id;
+}
+
+uint32_t SensorFrame::Fill()
+{
+	uint32_t withData = 0;
+	SensorHWData data; // one on the stack, reused for every sensor
+	const uint32_t numSensors = m_sensorHWs.size();
+	for (SensorId id = 0; id < numSensors; ++id) {
+		if (!m_sensorHWs[id]->SensorHWGetLatest(&data, NULL, m_raw[id])) {
+			m_timestamps[id] = 0; // no data
+			continue;
+		}
+
+		m_magnitudes[id] = data.vector.magnitude;
+		m_angles[id] = data.vector.angle;
+		m_azimuths[id] = data.vector.azimuth;
+		m_levels[id] = data.level;
+		m_timestamps[id] = data.timestamp;
+		++withData;
+	}
+
+	++m_tick;
+	return withData;
+}
@@ -0,0 +1,87 @@
+#pragma once
+//
+// SensorFrame: every sensor's latest sample for one tick, in one place.
+//		Fill reads each SensorHW once and stores the sample's fields in
+//		arrays, one array per field (structure of arrays): all headings
+//		together, all magnitudes together, and so on.  A consumer that
+//		looks at one field across all sensors (nearest object say) walks
+//		one small array instead of a SensorHWData per sensor, each with a
+//		vtable pointer it doesn't need.
+//
+//		Arrays are sized by AddSensor, so Fill allocates nothing.
+//
+//		Fill once per tick, then hand consumers a const SensorFrame &.  Not
+//		thread safe: don't Fill while consumers read.  For example, Fill
+//		before SensorPollScheduler::Poll and let engines read it in their
+//		OnPollAction.
+//
+//		For example:
+//			SensorFrame::SensorId front = frame.AddSensor(frontHW, "front");
+//			...
+//			frame.Fill();	// each tick
+//			if (frame.HasData(front) && (frame.Magnitudes()[front] < 0.3))
+//				...
+//
+#include <stdint.h>
+#include <vector>
+
+#include "common/b2btypes.h"
+#include "common/B2BLogic.h"
+
+class SensorHW;
+
+class SensorFrame {
+  public:
+	typedef uint32_t SensorId;	// index into each array, from AddSensor
+	static const SensorId SENSOR_INVALID = 0xffffffff;
+
+	SensorFrame();
+
+	// Add sensorHW to the frame.  Not while consumers read.
+	// name: for logging, not copied (use a static string)
+	// raw: passed to SensorHWGetLatest
+	// RETURNS: SensorId for the arrays, SENSOR_INVALID if sensorHW is NULL
+	SensorId AddSensor(SensorHW *sensorHW, const char *name, bool raw=false);
+
+	// Read each sensor's latest sample into the arrays, in one pass.
+	// A sensor with no data gets timestamp 0, its other fields are left
+	// from before.
+	// RETURNS: number of sensors with data
+	uint32_t Fill();
+
+	uint32_t NumSensors() const { return m_sensorHWs.size(); }
+	// RETURNS: number of Fill calls so far
+	uint64_t Tick() const { return m_tick; }
+
+	// Arrays, NumSensors() long, indexed by SensorId.  Valid until next
+	// AddSensor.  See SensorHWData for what each field means.
+	const b2b::Magnitude *Magnitudes() const { return Data(m_magnitudes); }
+	const b2b::Angle *Angles() const { return Data(m_angles); }
+	const b2b::Angle *Azimuths() const { return Data(m_azimuths); }
+	const B2BLogic::Level *Levels() const { return Data(m_levels); }
+	// 0 if sensor had no data at last Fill
+	const b2b::Timestamp *Timestamps() const { return Data(m_timestamps); }
+
+	bool HasData(SensorId id) const
+		{ return (id < m_timestamps.size()) && m_timestamps[id]; }
+	// RETURNS: name from AddSensor, NULL if id is not valid
+	const char *Name(SensorId id) const
+		{ return (id < m_names.size()) ? m_names[id] : NULL; }
+
+  private:
+	template <typename T>
+	static const T *Data(const std::vector<T> &array)
+		{ return array.empty() ? NULL : &array[0]; }
+
+	std::vector<SensorHW *> m_sensorHWs;
+	std::vector<const char *> m_names;
+	std::vector<uint8_t> m_raw;	// not vector<bool>, Fill reads it each tick
+
+	std::vector<b2b::Magnitude> m_magnitudes;
+	std::vector<b2b::Angle> m_angles;
+	std::vector<b2b::Angle> m_azimuths;
+	std::vector<B2BLogic::Level> m_levels;
+	std::vector<b2b::Timestamp> m_timestamps;
+
+	uint64_t m_tick;
+};
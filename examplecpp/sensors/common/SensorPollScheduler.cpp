@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <utility>
+
+#include "common/b2bassert.h"
+#include "common/B2BTime.h"
+#include "log/B2BLog.h"
+
+#include "SensorEngine.h"
+#include "SensorPollScheduler.h"
+
+SensorPollScheduler::SensorPollScheduler(const char *name,
+										 uint32_t numThreads) :
+	B2BModule(name),
+	m_split(numThreads ? numThreads : 1),
+	m_seenTicks(m_split.size() - 1, 0),
+	m_tick(0),
+	m_ticksToRebalance(0),
+	m_polling(0),
+	m_started(false),
+	m_pool(name, m_split.size() - 1,
+		   WorkerPool::Work(this, &SensorPollScheduler::RunThread),
+		   &m_lock, &m_tickCond)
+{
+	pthread_mutex_init(&m_lock, NULL);
+	pthread_cond_init(&m_tickCond, NULL);
+	pthread_cond_init(&m_doneCond, NULL);
+}
+
+SensorPollScheduler::~SensorPollScheduler()
+{
+	Stop(NULL); // Stop our threads
+
+	pthread_cond_destroy(&m_doneCond);
+	pthread_cond_destroy(&m_tickCond);
+	pthread_mutex_destroy(&m_lock);
+}
+
+bool SensorPollScheduler::Start(void *arg)
+{
+	pthread_mutex_lock(&m_lock);
+	for (size_t i = 0; i < m_seenTicks.size(); ++i)
+		m_seenTicks[i] = m_tick;
+	pthread_mutex_unlock(&m_lock);
+
+	if (!m_pool.Start(arg))
+		return false; // FAIL
+
+	pthread_mutex_lock(&m_lock);
+	m_started = true;
+	pthread_mutex_unlock(&m_lock);
+
+	return true; // SUCCESS
+}
+
+bool SensorPollScheduler::Stop(void **returnVal)
+{
+	// No more ticks.  A tick Poll already started is polled first, and
+	// we wait for it: a thread stopped before it polled its share would
+	// leave Poll waiting forever.
+	pthread_mutex_lock(&m_lock);
+	m_started = false;
+	while (m_polling)
+		pthread_cond_wait(&m_doneCond, &m_lock);
+	pthread_mutex_unlock(&m_lock);
+
+	bool success = m_pool.Stop();
+	if (success && returnVal)
+		*returnVal = NULL;
+
+	return success;
+}
+
+bool SensorPollScheduler::AddEngine(SensorEngine *engine)
+{
+	b2bassert(engine);
+
+	pthread_mutex_lock(&m_lock);
+	for (size_t i = 0; i < m_engines.size(); ++i) {
+		if (m_engines[i].engine == engine) {
+			pthread_mutex_unlock(&m_lock);
+			B2BLog::Err(LogFilt::LM_SENSOR, "%s::AddEngine(%s): already added",
+						Name(), engine->Name());
+			return false; // FAIL
+		}
+	}
+
+	Engine newEngine;
+	newEngine.engine = engine;
+	newEngine.stats.count = 0;
+	newEngine.stats.lastNS = 0;
+	newEngine.stats.avgNS = 0;
+	newEngine.stats.maxNS = 0;
+	newEngine.stats.thread = 0;
+	newEngine.result = true;
+	m_engines.push_back(newEngine);
+	m_ticksToRebalance = 0; // split it in on next Poll
+	pthread_mutex_unlock(&m_lock);
+
+	return true; // SUCCESS
+}
+
+// Longest first, for Rebalance
+static bool LongerPoll(const std::pair<uint64_t, size_t> &a,
+					   const std::pair<uint64_t, size_t> &b)
+{
+	if (a.first != b.first)
+		return a.first > b.first;
+	return a.second < b.second; // same split every time for equal times
+}
+
+void SensorPollScheduler::Rebalance()
+{
+	std::vector< std::pair<uint64_t, size_t> > byTime;
+	for (size_t i = 0; i < m_engines.size(); ++i)
+		byTime.push_back(std::make_pair(m_engines[i].stats.avgNS, i));
+	std::sort(byTime.begin(), byTime.end(), LongerPoll);
+
+	std::vector<uint64_t> threadNS(m_split.size(), 0);
+	for (size_t thread = 0; thread < m_split.size(); ++thread)
+		m_split[thread].clear();
+	for (size_t i = 0; i < byTime.size(); ++i) {
+		size_t least = 0;
+		for (size_t thread = 1; thread < threadNS.size(); ++thread) {
+			if (threadNS[thread] < threadNS[least])
+				least = thread;
+		}
+		m_split[least].push_back(byTime[i].second);
+		// Never polled yet: count it as 1ns so new engines spread out
+		threadNS[least] += byTime[i].first ? byTime[i].first : 1;
+	}
+
+	m_ticksToRebalance = REBALANCE_TICKS;
+}
+
+void SensorPollScheduler::PollThreadEngines(uint32_t split, uint32_t thread)
+{
+	const std::vector<size_t> &engines = m_split[split];
+	for (size_t i = 0; i < engines.size(); ++i) {
+		Engine &engine = m_engines[engines[i]];
+
+		uint64_t startNS = B2BTime::GetCurrTimeMonotonicNS();
+		engine.engine->PrePoll();
+		engine.result = engine.engine->OnPollAction();
+		uint64_t pollNS = B2BTime::GetCurrTimeMonotonicNS() - startNS;
+
+		EnginePollStats &stats = engine.stats;
+		if (stats.count)
+			stats.avgNS = stats.avgNS - (stats.avgNS / 8) + (pollNS / 8);
+		else
+			stats.avgNS = pollNS;
+		++stats.count;
+		stats.lastNS = pollNS;
+		if (pollNS > stats.maxNS)
+			stats.maxNS = pollNS;
+		stats.thread = thread;
+	}
+}
+
+void SensorPollScheduler::RunThread(uint32_t poolThread)
+{
+	pthread_mutex_lock(&m_lock);
+	while ((m_seenTicks[poolThread] == m_tick) && !m_pool.IsQuitting())
+		pthread_cond_wait(&m_tickCond, &m_lock);
+	if (m_seenTicks[poolThread] == m_tick) {
+		// Quit, no tick to poll.  A tick started before Stop is polled
+		// even so, Poll is waiting for it.
+		pthread_mutex_unlock(&m_lock);
+		return;
+	}
+	m_seenTicks[poolThread] = m_tick;
+	pthread_mutex_unlock(&m_lock);
+
+	PollThreadEngines(poolThread + 1, poolThread + 1);
+
+	pthread_mutex_lock(&m_lock);
+	if (--m_polling == 0)
+		pthread_cond_broadcast(&m_doneCond); // Poll, and Stop if it waits
+	pthread_mutex_unlock(&m_lock);
+}
+
+bool SensorPollScheduler::Poll()
+{
+	pthread_mutex_lock(&m_lock);
+	if (m_ticksToRebalance == 0)
+		Rebalance();
+	--m_ticksToRebalance;
+
+	bool started = m_started;
+	if (started) {
+		// Start our threads on this tick
+		m_polling = m_pool.NumThreads();
+		++m_tick;
+		pthread_cond_broadcast(&m_tickCond);
+	}
+	pthread_mutex_unlock(&m_lock);
+
+	if (started) {
+		PollThreadEngines(0, 0);
+
+		// Barrier: wait for our threads to finish theirs
+		pthread_mutex_lock(&m_lock);
+		while (m_polling)
+			pthread_cond_wait(&m_doneCond, &m_lock);
+		pthread_mutex_unlock(&m_lock);
+	} else {
+		// No threads, poll it all here, on thread 0
+		for (uint32_t split = 0; split < m_split.size(); ++split)
+			PollThreadEngines(split, 0);
+	}
+
+	bool result = true;
+	for (size_t i = 0; i < m_engines.size(); ++i) {
+		if (!m_engines[i].result)
+			result = false;
+	}
+	return result;
+}
+
+bool SensorPollScheduler::GetEnginePollStats(size_t index,
+											 EnginePollStats *pStats) const
+{
+	b2bassert(pStats);
+
+	pthread_mutex_lock(&m_lock);
+	if (index >= m_engines.size()) {
+		pthread_mutex_unlock(&m_lock);
+		return false; // FAIL: index out of range
+	}
+	*pStats = m_engines[index].stats;
+	pthread_mutex_unlock(&m_lock);
+
+	return true; // SUCCESS
+}
+
+void SensorPollScheduler::LogPollStats() const
+{
+	pthread_mutex_lock(&m_lock);
+	for (size_t i = 0; i < m_engines.size(); ++i) {
+		const EnginePollStats &stats = m_engines[i].stats;
+		B2BLog::Info(LogFilt::LM_SENSOR,
+			"%s: %-20s thread %u n=%llu last=%.1fus avg=%.1fus max=%.1fus",
+			Name(), m_engines[i].engine->Name(), stats.thread,
+			(unsigned long long)stats.count, stats.lastNS / 1000.0,
+			stats.avgNS / 1000.0, stats.maxNS / 1000.0);
+	}
+	pthread_mutex_unlock(&m_lock);
+}
@@ -0,0 +1,109 @@
+#pragma once
+//
+// SensorPollScheduler: polls SensorEngines on several threads each tick,
+//		instead of one after the other on the clock's thread.  One slow
+//		SensorHW (a bus read say) then delays only the engines that share
+//		its thread.
+//		WARNING: Client must call Init() and Start() to enable this class.
+//
+//		Each Poll call is one tick.  Engines are split among our threads
+//		and the caller's thread, each engine is polled (PrePoll then
+//		OnPollAction, as the clock does) and Poll returns only when all
+//		are done: a barrier, so fusion that runs after Poll sees every
+//		engine's result.
+//
+//		Engines are split by how long their polls take: each thread gets
+//		about the same total.  Longest first, each engine goes to the
+//		thread with the least so far (LPT).  Poll times are averaged and
+//		the split redone every REBALANCE_TICKS ticks.
+//
+//		Engines polled at the same time must not share anything that isn't
+//		thread safe.  Two engines on one SensorHW are fine if that
+//		SensorHW's SensorHWGetLatest is (see SensorHW).
+//
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include "apps/common/B2BModule.h"
+#include "apps/common/WorkerPool.h"
+
+class SensorEngine;
+
+class SensorPollScheduler : public B2BModule {
+  public:
+	// name: module name, also used for our threads
+	// numThreads: threads that poll each tick, counting the thread that
+	//		calls Poll.  0 is treated as 1.  1 polls in Poll's caller only.
+	SensorPollScheduler(const char *name, uint32_t numThreads);
+	virtual ~SensorPollScheduler();
+
+	// START: B2BModule virtuals.  See B2BModule for documentation
+	bool Init() { return true; } // nothing to do
+	// Start creates our threads
+	bool Start(void *arg);
+	bool Stop(void **returnVal);
+	// END: B2BModule virtuals
+
+	// Add engine to poll.  Not while Poll is running.
+	// RETURNS: true on success, false if already added
+	bool AddEngine(SensorEngine *engine);
+
+	// Poll every engine once and wait for all of them.  Call from one
+	// thread only (the clock's).  Before Start, polls them all in caller.
+	// RETURNS: true if every OnPollAction returned true
+	bool Poll();
+
+	// Poll times of one engine
+	// count: polls
+	// lastNS, avgNS, maxNS: PrePoll plus OnPollAction time.  avgNS is a
+	//		running average that favors recent polls.
+	// thread: thread it was last polled on, 0 is Poll's caller
+	struct EnginePollStats {
+		uint64_t count;
+		uint64_t lastNS;
+		uint64_t avgNS;
+		uint64_t maxNS;
+		uint32_t thread;
+	};
+	// Not while Poll is running: call from Poll's thread.
+	// index: 0 to NumEngines()-1, in order added
+	// RETURNS: true on success, false if index is out of range
+	bool GetEnginePollStats(size_t index, EnginePollStats *pStats) const;
+	// B2BLog::Info a line per engine
+	void LogPollStats() const;
+
+	size_t NumEngines() const { return m_engines.size(); }
+	uint32_t NumThreads() const { return m_pool.NumThreads() + 1; }
+
+	// Split engines again after this many ticks
+	static const uint32_t REBALANCE_TICKS = 16;
+
+  private:
+	struct Engine {
+		SensorEngine *engine;
+		EnginePollStats stats;
+		bool result;			// last OnPollAction
+	};
+
+	// WorkerPool::Work: wait for next tick and poll pool thread's engines
+	// poolThread: m_pool's thread, that is our thread poolThread+1
+	void RunThread(uint32_t poolThread);
+	// Poll engines split to split, on thread (for their stats).  Not the
+	// same when Poll's caller polls every split, before Start.
+	void PollThreadEngines(uint32_t split, uint32_t thread);
+	// Split m_engines among threads, into m_split.  Called with m_lock held.
+	void Rebalance();
+
+	std::vector<Engine> m_engines;
+	std::vector< std::vector<size_t> > m_split;	// m_engines index per thread
+	std::vector<uint32_t> m_seenTicks;	// last tick each m_pool thread polled
+	uint32_t m_tick;			// bumped by Poll to start our threads
+	uint32_t m_ticksToRebalance;
+	uint32_t m_polling;			// our threads not done with this tick
+	bool m_started;
+	mutable pthread_mutex_t m_lock;	// for all of the above, and m_pool's quit
+	pthread_cond_t m_tickCond;	// signalled when m_tick changes, or by m_pool.Stop
+	pthread_cond_t m_doneCond;	// broadcast when m_polling gets to 0
+	WorkerPool m_pool;			// threads 1 and up, 0 is Poll's caller
+};